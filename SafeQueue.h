@@ -18,8 +18,13 @@ public:
     void enqueue(const T &t )
     {
         unique_lock<mutex> lock(m);
-        cond_not_full.wait(lock, [this]{return q.size() < maxSize;});
-        
+        cond_not_full.wait(lock, [this]{return q.size() < maxSize || stop_flag;});
+        if(stop_flag)
+        {
+            // 已停止，不再接收新元素
+            return;
+        }
+
         q.push(t);
         cond_not_empty.notify_one();
     }
@@ -28,7 +33,7 @@ public:
     bool dequeue(T &t)
     {
         unique_lock<mutex> lock(m);
-        cond_not_empty.wait(lock,[this] { return !q.empty(); });
+        cond_not_empty.wait(lock,[this] { return !q.empty() || stop_flag; });
         if(stop_flag && q.empty()) {
             // 若收到停止信号且队列也空了，就返回 false
             return false;
@@ -40,6 +45,49 @@ public:
         cond_not_full.notify_one();
         return true;
     }
+    // 非阻塞插入：队列已满时直接返回 false（丢弃最新帧）
+    bool try_enqueue(const T &t)
+    {
+        unique_lock<mutex> lock(m);
+        if(q.size() >= maxSize)
+        {
+            return false;
+        }
+        q.push(t);
+        cond_not_empty.notify_one();
+        return true;
+    }
+
+    // 插入队列，队列已满时挤掉最旧的元素（丢弃最旧帧），被挤掉的元素通过 dropped 返回
+    bool enqueue_drop_oldest(const T &t, T &dropped)
+    {
+        unique_lock<mutex> lock(m);
+        bool has_dropped = false;
+        if(q.size() >= maxSize && !q.empty())
+        {
+            dropped = q.front();
+            q.pop();
+            has_dropped = true;
+        }
+        q.push(t);
+        cond_not_empty.notify_one();
+        return has_dropped;
+    }
+
+    // 非阻塞弹出：队列为空时直接返回 false
+    bool try_dequeue(T &t)
+    {
+        unique_lock<mutex> lock(m);
+        if(q.empty())
+        {
+            return false;
+        }
+        t = q.front();
+        q.pop();
+        cond_not_full.notify_one();
+        return true;
+    }
+
     // 调用此函数让所有阻塞线程退出
     void stop() {
         std::unique_lock<std::mutex> lock(m);
@@ -61,6 +109,12 @@ public:
         unique_lock<mutex> lock(m);
         return q.size();
     }
+
+    // 返回队列容量上限
+    size_t capacity() const
+    {
+        return maxSize;
+    }
     private:
     bool stop_flag = false;
     queue<T> q;
@@ -0,0 +1,95 @@
+#include "admission.h"
+
+#include <iostream>
+
+AdmissionController::AdmissionController(const AdmissionConfig &cfg)
+    : config(cfg), load_counter(0),
+      admitted(0), dropped_newest(0), dropped_oldest(0), dropped_skip(0), dropped_stale(0)
+{
+}
+
+bool AdmissionController::overloaded(size_t depth, size_t capacity) const
+{
+    size_t watermark = config.high_watermark > 0 ? config.high_watermark : capacity;
+    if(watermark == 0)
+    {
+        // 没有容量也没有水位，视为永不过载
+        return false;
+    }
+    return depth >= watermark;
+}
+
+bool AdmissionController::admit_under_load()
+{
+    if(config.policy == ADMIT_DROP_NEWEST)
+    {
+        count_dropped_newest();
+        return false;
+    }
+    if(config.policy == ADMIT_KEEP_EVERY_N)
+    {
+        int n = config.keep_every_n > 1 ? config.keep_every_n : 1;
+        if((load_counter++ % n) == 0)
+        {
+            return true;
+        }
+        count_dropped_skip();
+        return false;
+    }
+    return true;
+}
+
+bool AdmissionController::is_stale(std::chrono::steady_clock::time_point t) const
+{
+    if(config.max_frame_age_ms <= 0)
+    {
+        return false;
+    }
+    auto age = std::chrono::steady_clock::now() - t;
+    return age > std::chrono::milliseconds(config.max_frame_age_ms);
+}
+
+AdmissionStats AdmissionController::stats() const
+{
+    AdmissionStats s;
+    s.admitted       = admitted.load();
+    s.dropped_newest = dropped_newest.load();
+    s.dropped_oldest = dropped_oldest.load();
+    s.dropped_skip   = dropped_skip.load();
+    s.dropped_stale  = dropped_stale.load();
+    return s;
+}
+
+void AdmissionController::print_stats(const char *name) const
+{
+    AdmissionStats s = stats();
+    std::cout << "[" << name << "] 策略=" << admission_policy_name(config.policy)
+              << " 放行=" << s.admitted
+              << " 丢弃总数=" << s.dropped_total()
+              << " (最新=" << s.dropped_newest
+              << ", 最旧=" << s.dropped_oldest
+              << ", 抽帧=" << s.dropped_skip
+              << ", 超龄=" << s.dropped_stale << ")" << std::endl;
+}
+
+bool parse_admission_policy(const std::string &name, AdmissionPolicy &policy)
+{
+    if(name == "block")            { policy = ADMIT_BLOCK; }
+    else if(name == "drop_newest") { policy = ADMIT_DROP_NEWEST; }
+    else if(name == "drop_oldest") { policy = ADMIT_DROP_OLDEST; }
+    else if(name == "every_n")     { policy = ADMIT_KEEP_EVERY_N; }
+    else                           { return false; }
+    return true;
+}
+
+const char *admission_policy_name(AdmissionPolicy policy)
+{
+    switch(policy)
+    {
+        case ADMIT_BLOCK:        return "block";
+        case ADMIT_DROP_NEWEST:  return "drop_newest";
+        case ADMIT_DROP_OLDEST:  return "drop_oldest";
+        case ADMIT_KEEP_EVERY_N: return "every_n";
+    }
+    return "unknown";
+}
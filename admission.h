@@ -0,0 +1,122 @@
+#ifndef ADMISSION_H
+#define ADMISSION_H
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <stdint.h>
+
+#include "SafeQueue.h"
+
+// 准入策略：队列过载时如何处理新到达的帧
+enum AdmissionPolicy
+{
+    ADMIT_BLOCK = 0,        // 阻塞等待（离线处理，不丢帧）
+    ADMIT_DROP_NEWEST,      // 丢弃最新到达的帧
+    ADMIT_DROP_OLDEST,      // 挤掉队列里最旧的帧
+    ADMIT_KEEP_EVERY_N      // 过载时每 N 帧只保留 1 帧
+};
+
+struct AdmissionConfig
+{
+    AdmissionPolicy policy;
+    size_t high_watermark;  // 队列深度 >= 该值视为过载，0 表示使用队列容量
+    int keep_every_n;       // ADMIT_KEEP_EVERY_N 模式下的抽帧间隔
+    int max_frame_age_ms;   // 帧龄上限（毫秒），超过即丢弃，<=0 表示不限制
+
+    AdmissionConfig()
+        : policy(ADMIT_BLOCK), high_watermark(0), keep_every_n(2), max_frame_age_ms(0) {}
+};
+
+// 丢帧统计快照
+struct AdmissionStats
+{
+    uint64_t admitted;
+    uint64_t dropped_newest;
+    uint64_t dropped_oldest;
+    uint64_t dropped_skip;
+    uint64_t dropped_stale;
+
+    uint64_t dropped_total() const
+    {
+        return dropped_newest + dropped_oldest + dropped_skip + dropped_stale;
+    }
+};
+
+// 准入控制器：根据实测队列深度和帧龄决定帧的去留，并统计丢帧数
+class AdmissionController
+{
+public:
+    explicit AdmissionController(const AdmissionConfig &cfg = AdmissionConfig());
+
+    void set_config(const AdmissionConfig &cfg) { config = cfg; }
+    const AdmissionConfig &get_config() const { return config; }
+
+    // 队列当前深度是否已达到过载水位
+    bool overloaded(size_t depth, size_t capacity) const;
+
+    // 过载时是否放行新帧（DROP_NEWEST 一律拒绝，KEEP_EVERY_N 每 N 帧放行 1 帧）
+    bool admit_under_load();
+
+    // 帧龄是否已超过上限
+    bool is_stale(std::chrono::steady_clock::time_point t) const;
+
+    // 按策略把元素放入 SafeQueue，返回该元素是否被接收
+    template<typename T>
+    bool offer(SafeQueue<T> &q, const T &item)
+    {
+        if(config.policy == ADMIT_BLOCK)
+        {
+            q.enqueue(item);
+            count_admitted();
+            return true;
+        }
+        if(config.policy == ADMIT_DROP_OLDEST)
+        {
+            T dropped;
+            if(q.enqueue_drop_oldest(item, dropped))
+            {
+                count_dropped_oldest();
+            }
+            count_admitted();
+            return true;
+        }
+        if(overloaded(q.size(), q.capacity()) && !admit_under_load())
+        {
+            return false;
+        }
+        if(!q.try_enqueue(item))
+        {
+            // 水位判断之后队列被填满，只能丢弃最新帧
+            count_dropped_newest();
+            return false;
+        }
+        count_admitted();
+        return true;
+    }
+
+    void count_admitted()       { admitted++; }
+    void count_dropped_newest() { dropped_newest++; }
+    void count_dropped_oldest() { dropped_oldest++; }
+    void count_dropped_skip()   { dropped_skip++; }
+    void count_dropped_stale()  { dropped_stale++; }
+
+    AdmissionStats stats() const;
+    void print_stats(const char *name) const;
+
+private:
+    AdmissionConfig config;
+    uint64_t load_counter;  // 过载期间到达的帧计数，用于 KEEP_EVERY_N
+
+    std::atomic<uint64_t> admitted;
+    std::atomic<uint64_t> dropped_newest;
+    std::atomic<uint64_t> dropped_oldest;
+    std::atomic<uint64_t> dropped_skip;
+    std::atomic<uint64_t> dropped_stale;
+};
+
+// 字符串与策略互转："block" / "drop_newest" / "drop_oldest" / "every_n"
+bool parse_admission_policy(const std::string &name, AdmissionPolicy &policy);
+const char *admission_policy_name(AdmissionPolicy policy);
+
+#endif
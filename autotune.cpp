@@ -0,0 +1,252 @@
+#include "autotune.h"
+
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <stdio.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <vector>
+
+#include "frame_sink.h"
+#include "stream_pipeline.h"
+
+// 模型只在 3 个 NPU 核上跑，worker 数按核数的倍数搜索
+#define AUTOTUNE_NPU_CORES 3
+
+static double cpu_seconds()
+{
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6 + ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+}
+
+//-----------------------------------
+// 试运行
+//-----------------------------------
+bool run_pipeline_trial(const PipelineConfig &cfg, const EngineFactory &engines, const SourceFactory &source_factory,
+                        TrialResult &out)
+{
+    ThreadPoll npu_pool(engines, cfg.num_threads);
+    npu_pool.set_admission(cfg.pool_admission);
+    npu_pool.set_deadline_action(cfg.deadline_action);
+    npu_pool.set_tiling(cfg.tiling);
+    for(int p = 0; p < PRIORITY_NUM; p++)
+    {
+        npu_pool.set_priority_weight((TaskPriority)p, cfg.lane_weights[p]);
+    }
+
+    std::vector<std::unique_ptr<FrameSource>> sources;
+    std::vector<std::unique_ptr<NullFrameSink>> sinks;
+    std::vector<std::unique_ptr<StreamPipeline>> pipelines;
+    for(size_t i = 0; i < cfg.streams.size(); i++)
+    {
+        sources.emplace_back(source_factory((int)i));
+        sinks.emplace_back(new NullFrameSink());
+        pipelines.emplace_back(new StreamPipeline((int)i, sources[i].get(), sinks[i].get(), npu_pool, cfg,
+                                                  cfg.streams[i].priority));
+        if(!pipelines.back()->open())
+        {
+            return false;
+        }
+    }
+
+    double cpu_begin = cpu_seconds();
+    auto t0 = std::chrono::steady_clock::now();
+    for(auto &pipeline : pipelines)
+    {
+        pipeline->start();
+    }
+    for(auto &pipeline : pipelines)
+    {
+        pipeline->join();
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    double cpu = cpu_seconds() - cpu_begin;
+
+    StageHistograms all_stages;
+    out = TrialResult();
+    for(auto &pipeline : pipelines)
+    {
+        StreamStats s = pipeline->stats();
+        out.frames_read += s.frames_read;
+        out.frames_written += s.frames_written;
+        out.frames_dropped += s.pool_dropped + s.read_admission.dropped_total();
+        all_stages.add(pipeline->stage_histograms());
+    }
+    const LatencyHistogram &total = all_stages.stage(STAGE_TOTAL);
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    out.elapsed_s = elapsed;
+    out.fps = elapsed > 0 ? out.frames_written / elapsed : 0;
+    out.p50_ms = total.percentile(50) / 1000.0;
+    out.p90_ms = total.percentile(90) / 1000.0;
+    out.p99_ms = total.percentile(99) / 1000.0;
+    out.max_ms = total.max() / 1000.0;
+    out.cpu_pct = elapsed > 0 ? 100.0 * cpu / elapsed : 0;
+    out.cpu_total_pct = cores > 0 ? out.cpu_pct / cores : out.cpu_pct;
+    out.npu_duty = npu_pool.npu_duty_cycle();
+    return true;
+}
+
+//-----------------------------------
+// 自动调参
+//-----------------------------------
+// 一个候选组合；读写队列取同一深度
+struct TuneCandidate
+{
+    int workers;
+    int inflight;
+    int queue;
+
+    bool operator<(const TuneCandidate &o) const
+    {
+        if(workers != o.workers) return workers < o.workers;
+        if(inflight != o.inflight) return inflight < o.inflight;
+        return queue < o.queue;
+    }
+};
+
+// 只读前 limit 帧的来源包装，把完整视频截成一个试运行窗口
+class FrameLimitSource : public FrameSource
+{
+public:
+    FrameLimitSource(FrameSource *inner_in, int limit_in) : inner(inner_in), limit(limit_in), count(0) {}
+
+    bool open() { return inner->open(); }
+    bool read(cv::Mat &frame) { return count++ < limit && inner->read(frame); }
+    double last_pts_ms() const { return inner->last_pts_ms(); }
+    bool frames_persistent() const { return inner->frames_persistent(); }
+    int width() const { return inner->width(); }
+    int height() const { return inner->height(); }
+    double fps() const { return inner->fps(); }
+    std::string name() const { return inner->name(); }
+
+private:
+    std::unique_ptr<FrameSource> inner;
+    int limit;
+    int count;
+};
+
+// a 是否优于 b：满足延迟约束的优先，都满足时比吞吐，都不满足时比 p99
+static bool better_trial(const TrialResult &a, const TrialResult &b, double max_p99_ms)
+{
+    bool a_ok = max_p99_ms <= 0 || a.p99_ms <= max_p99_ms;
+    bool b_ok = max_p99_ms <= 0 || b.p99_ms <= max_p99_ms;
+    if(a_ok != b_ok)
+    {
+        return a_ok;
+    }
+    if(a_ok)
+    {
+        // 吞吐相差不到 2% 时视为持平，取延迟低的，避免被测量抖动牵着走
+        if(a.fps > b.fps * 1.02) return true;
+        if(b.fps > a.fps * 1.02) return false;
+        return a.p99_ms < b.p99_ms;
+    }
+    return a.p99_ms < b.p99_ms;
+}
+
+bool autotune_pipeline(PipelineConfig &cfg, const AutotuneConfig &tune, const EngineFactory &engines,
+                       const SourceFactory &sources)
+{
+    std::vector<int> worker_choices;
+    for(int k = 1; k <= 4; k++)
+    {
+        worker_choices.push_back(k * AUTOTUNE_NPU_CORES);
+    }
+    const int inflight_list[] = {4, 8, 16, 32};
+    const int queue_list[] = {8, 16, 32, 64};
+    std::vector<int> inflight_choices(inflight_list, inflight_list + 4);
+    std::vector<int> queue_choices(queue_list, queue_list + 4);
+
+    // 试运行期间不写视频、不打印周期统计；截断来源到试运行窗口
+    PipelineConfig trial_cfg = cfg;
+    trial_cfg.report_interval_s = 0;
+    int limit = tune.trial_frames > 0 ? tune.trial_frames : 200;
+    SourceFactory limited = [&sources, limit](int stream_id) -> FrameSource * {
+        return new FrameLimitSource(sources(stream_id), limit);
+    };
+
+    std::map<TuneCandidate, TrialResult> tried;
+    auto evaluate = [&](const TuneCandidate &c, TrialResult &r) -> bool
+    {
+        std::map<TuneCandidate, TrialResult>::const_iterator it = tried.find(c);
+        if(it != tried.end())
+        {
+            r = it->second;
+            return true;
+        }
+        trial_cfg.num_threads = c.workers;
+        trial_cfg.max_inflight = c.inflight;
+        trial_cfg.read_queue_size = c.queue;
+        trial_cfg.write_queue_size = c.queue;
+        if(!run_pipeline_trial(trial_cfg, engines, limited, r))
+        {
+            return false;
+        }
+        tried[c] = r;
+        printf("[Autotune] workers=%-3d inflight=%-3d queue=%-3d fps=%7.2f p50=%7.2f p99=%7.2f ms cpu=%5.1f%%\n",
+               c.workers, c.inflight, c.queue, r.fps, r.p50_ms, r.p99_ms, r.cpu_pct);
+        fflush(stdout);
+        return true;
+    };
+
+    // 从当前配置出发，逐维搜索：固定其余两维，试遍这一维的候选取最优
+    TuneCandidate best = {cfg.num_threads, cfg.max_inflight, (int)cfg.read_queue_size};
+    TrialResult best_result;
+    if(!evaluate(best, best_result))
+    {
+        return false;
+    }
+    for(int pass = 0; pass < tune.max_passes; pass++)
+    {
+        bool changed = false;
+        for(int dim = 0; dim < 3; dim++)
+        {
+            const std::vector<int> &choices = dim == 0 ? worker_choices : (dim == 1 ? inflight_choices : queue_choices);
+            for(size_t i = 0; i < choices.size(); i++)
+            {
+                TuneCandidate c = best;
+                int &v = dim == 0 ? c.workers : (dim == 1 ? c.inflight : c.queue);
+                if(v == choices[i])
+                {
+                    continue;
+                }
+                v = choices[i];
+                TrialResult r;
+                if(!evaluate(c, r))
+                {
+                    return false;
+                }
+                if(better_trial(r, best_result, tune.max_p99_ms))
+                {
+                    best = c;
+                    best_result = r;
+                    changed = true;
+                }
+            }
+        }
+        if(!changed)
+        {
+            break;
+        }
+    }
+
+    cfg.num_threads = best.workers;
+    cfg.max_inflight = best.inflight;
+    cfg.read_queue_size = best.queue;
+    cfg.write_queue_size = best.queue;
+
+    bool feasible = tune.max_p99_ms <= 0 || best_result.p99_ms <= tune.max_p99_ms;
+    char comment[256];
+    snprintf(comment, sizeof(comment), "fps=%.2f p99_ms=%.2f trials=%d frames=%d p99_bound_ms=%.1f%s", best_result.fps,
+             best_result.p99_ms, (int)tried.size(), limit, tune.max_p99_ms, feasible ? "" : " (bound not met)");
+    std::cout << "[Autotune] 最优: workers=" << best.workers << " inflight=" << best.inflight << " queue=" << best.queue
+              << " " << comment << std::endl;
+    if(!feasible)
+    {
+        std::cerr << "[Autotune] 没有组合满足 p99 <= " << tune.max_p99_ms << " ms，取 p99 最低的组合\n";
+    }
+    return save_pipeline_profile(tune.out_path, cfg, comment);
+}
@@ -0,0 +1,55 @@
+#ifndef AUTOTUNE_H
+#define AUTOTUNE_H
+
+#include <functional>
+#include <stdint.h>
+#include <string>
+
+#include "pipeline_config.h"
+#include "thread_poll.h"
+#include "frame_source.h"
+
+// 为第 stream_id 路流创建一次试运行用的来源
+typedef std::function<FrameSource *(int stream_id)> SourceFactory;
+
+// 一次试运行的结果
+struct TrialResult
+{
+    uint64_t frames_read = 0;
+    uint64_t frames_written = 0;
+    uint64_t frames_dropped = 0;
+    double elapsed_s = 0;
+    double fps = 0;                 // 所有流合计的写出帧率
+    double p50_ms = 0, p90_ms = 0, p99_ms = 0, max_ms = 0;  // 端到端延迟
+    double cpu_pct = 0;             // 进程 CPU 时间 / 墙钟时间，100% 表示占满一个核
+    double cpu_total_pct = 0;       // 按核数归一化
+    double npu_duty = 0;
+};
+
+//-----------------------------------
+// 按 cfg 搭建与 main.cpp 相同的拓扑（每路 StreamPipeline + 共享 ThreadPoll），
+// 输出到空 sink，跑到所有来源读完为止
+//-----------------------------------
+bool run_pipeline_trial(const PipelineConfig &cfg, const EngineFactory &engines, const SourceFactory &sources,
+                        TrialResult &out);
+
+// 自动调参参数
+struct AutotuneConfig
+{
+    int trial_frames;       // 每次试运行每路流的帧数
+    double max_p99_ms;      // 延迟约束：端到端 p99 不超过该值，<=0 不约束
+    int max_passes;         // 逐维搜索的最大轮数
+    std::string out_path;   // 调参结果保存的 profile
+
+    AutotuneConfig() : trial_frames(200), max_p99_ms(0), max_passes(3), out_path("pipeline.profile") {}
+};
+
+//-----------------------------------
+// 自动调参：在 worker 数（每个 NPU 核 1~4 个）、在线帧窗口、队列深度上逐维搜索，
+// 每个候选跑一个短的试运行窗口，取满足延迟约束时吞吐最高的组合写入 cfg 并保存为 profile（见 save_pipeline_profile）。
+// 一轮中没有任何维度变化时视为收敛
+//-----------------------------------
+bool autotune_pipeline(PipelineConfig &cfg, const AutotuneConfig &tune, const EngineFactory &engines,
+                       const SourceFactory &sources);
+
+#endif
@@ -0,0 +1,283 @@
+// bench_pipeline.cpp
+// 流水线吞吐压测：合成帧 -> 与 main.cpp 相同的拓扑（每路 StreamPipeline + 共享 ThreadPoll）-> 空输出，
+// 扫描 worker 数与队列容量的组合，输出 FPS、端到端延迟分位数与 CPU 占用（JSON）
+#include <opencv2/opencv.hpp>
+#include <iostream>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "thread_poll.h"
+#include "pipeline_config.h"
+#include "frame_source.h"
+#include "mock_engine.h"
+#include "raw_frame_cache.h"
+#include "autotune.h"
+
+// 压测参数
+struct BenchConfig
+{
+    bool mock;                  // 模拟引擎还是真实 RKNN
+    std::string model_path;
+    MockEngineConfig mock_cfg;
+    int width;
+    int height;
+    double fps;                 // >0 时按帧率放帧（模拟摄像头），否则尽快产出
+    int objects;                // 合成帧中的目标数（模拟引擎同样返回这么多框）
+    int frames;                 // 每路流的帧数
+    int streams;
+    bool render;                // 画框（走视频输出路径），否则只输出检测结果
+    std::vector<int> workers;   // 扫描的 worker 数
+    std::vector<int> queues;    // 扫描的读/写队列容量
+    std::string json_path;      // 为空时只打印到标准输出
+    std::string raw_path;       // 非空时从预解码的原始帧缓存重放，代替合成帧
+    int raw_loops;              // 原始帧缓存循环重放的次数
+
+    BenchConfig() : mock(true), model_path("/home/orangepi/Desktop/model/yolov5s.rknn"), width(1920), height(1080),
+                    fps(0), objects(5), frames(300), streams(1), render(false), raw_loops(1) {}
+};
+
+// 一次运行的结果：试运行的各项指标加上本次的扫描参数
+struct BenchResult : public TrialResult
+{
+    int workers;
+    int queue_size;
+};
+
+static void print_bench_usage(const char *prog)
+{
+    std::cout << "用法: " << prog << " [选项]\n"
+              << "  --engine E          mock(默认，固定延迟模拟引擎)|rknn(真实 NPU)\n"
+              << "  --model PATH        rknn 引擎使用的模型\n"
+              << "  --mock-latency-ms N 模拟引擎每次推理的延迟（默认 20）\n"
+              << "  --mock-cores N      模拟的 NPU 核数（默认 3）\n"
+              << "  --size WxH          合成帧分辨率（默认 1920x1080）\n"
+              << "  --fps N             按帧率放帧，0 为尽快产出（默认 0）\n"
+              << "  --objects N         每帧目标数（默认 5）\n"
+              << "  --frames N          每路流帧数（默认 300）\n"
+              << "  --streams N         流数（默认 1）\n"
+              << "  --render            画框（走视频输出路径）\n"
+              << "  --workers LIST      扫描的 worker 数，逗号分隔（默认 1,2,3,6）\n"
+              << "  --queues LIST       扫描的读/写队列容量，逗号分隔（默认 16）\n"
+              << "  --json PATH         结果另写一份到文件\n"
+              << "  --raw PATH          从 frame_cache 生成的 .rkframes 重放真实帧，代替合成帧\n"
+              << "  --raw-loops N       循环重放 N 遍（默认 1）\n";
+}
+
+static bool parse_int_list(const char *s, std::vector<int> &out)
+{
+    out.clear();
+    std::stringstream ss(s);
+    std::string item;
+    while(std::getline(ss, item, ','))
+    {
+        int v = atoi(item.c_str());
+        if(v <= 0)
+        {
+            return false;
+        }
+        out.push_back(v);
+    }
+    return !out.empty();
+}
+
+static int parse_bench_args(int argc, char **argv, BenchConfig &cfg)
+{
+    for(int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        if(strcmp(arg, "-h") == 0 || strcmp(arg, "--help") == 0)
+        {
+            print_bench_usage(argv[0]);
+            return -1;
+        }
+        if(strcmp(arg, "--render") == 0)
+        {
+            cfg.render = true;
+            continue;
+        }
+        if(i + 1 >= argc)
+        {
+            std::cerr << "选项缺少取值: " << arg << "\n";
+            return -1;
+        }
+        const char *val = argv[++i];
+        if(strcmp(arg, "--engine") == 0)
+        {
+            if(strcmp(val, "mock") == 0)      { cfg.mock = true; }
+            else if(strcmp(val, "rknn") == 0) { cfg.mock = false; }
+            else
+            {
+                std::cerr << "未知的推理引擎: " << val << "\n";
+                return -1;
+            }
+        }
+        else if(strcmp(arg, "--model") == 0)           { cfg.model_path = val; }
+        else if(strcmp(arg, "--mock-latency-ms") == 0) { cfg.mock_cfg.latency_us = (int)(atof(val) * 1000); }
+        else if(strcmp(arg, "--mock-cores") == 0)      { cfg.mock_cfg.cores = atoi(val); }
+        else if(strcmp(arg, "--size") == 0)
+        {
+            if(sscanf(val, "%dx%d", &cfg.width, &cfg.height) != 2)
+            {
+                std::cerr << "分辨率格式应为 WxH: " << val << "\n";
+                return -1;
+            }
+        }
+        else if(strcmp(arg, "--fps") == 0)     { cfg.fps = atof(val); }
+        else if(strcmp(arg, "--objects") == 0) { cfg.objects = atoi(val); }
+        else if(strcmp(arg, "--frames") == 0)  { cfg.frames = atoi(val); }
+        else if(strcmp(arg, "--streams") == 0) { cfg.streams = atoi(val); }
+        else if(strcmp(arg, "--json") == 0)    { cfg.json_path = val; }
+        else if(strcmp(arg, "--raw") == 0)       { cfg.raw_path = val; }
+        else if(strcmp(arg, "--raw-loops") == 0) { cfg.raw_loops = atoi(val); }
+        else if(strcmp(arg, "--workers") == 0 || strcmp(arg, "--queues") == 0)
+        {
+            std::vector<int> &list = (arg[2] == 'w') ? cfg.workers : cfg.queues;
+            if(!parse_int_list(val, list))
+            {
+                std::cerr << "列表格式应为逗号分隔的正整数: " << val << "\n";
+                return -1;
+            }
+        }
+        else
+        {
+            std::cerr << "未知选项: " << arg << "\n";
+            print_bench_usage(argv[0]);
+            return -1;
+        }
+    }
+    if(cfg.workers.empty())
+    {
+        cfg.workers = {1, 2, 3, 6};
+    }
+    if(cfg.queues.empty())
+    {
+        cfg.queues = {16};
+    }
+    if(cfg.streams < 1)
+    {
+        cfg.streams = 1;
+    }
+    cfg.mock_cfg.objects = cfg.objects;
+    return 0;
+}
+
+//-----------------------------------
+// 按给定 worker 数与队列容量跑一次，拓扑与 main.cpp 相同
+//-----------------------------------
+static bool run_once(const BenchConfig &bench, int workers, int queue_size, BenchResult &out)
+{
+    PipelineConfig config;
+    config.num_threads = workers;
+    config.read_queue_size = queue_size;
+    config.write_queue_size = queue_size;
+    config.output_mode = bench.render ? OUTPUT_VIDEO : OUTPUT_SIDECAR;
+    config.report_interval_s = 0;
+    config.streams.resize(bench.streams);
+    for(int i = 0; i < bench.streams; i++)
+    {
+        config.streams[i].path = bench.raw_path.empty() ? "synthetic" : bench.raw_path;
+        config.streams[i].priority = PRIORITY_NORMAL;
+    }
+
+    EngineFactory factory;
+    if(bench.mock)
+    {
+        MockEngineConfig mock_cfg = bench.mock_cfg;
+        factory = [mock_cfg](int worker_id) -> InferenceEngine * { return new MockInferenceEngine(mock_cfg, worker_id); };
+    }
+    else
+    {
+        std::string path = bench.model_path;
+        factory = [path](int worker_id) -> InferenceEngine * { return new Yolov5s(path.c_str(), worker_id % 3); };
+    }
+
+    SourceFactory sources = [&bench](int) -> FrameSource * {
+        if(!bench.raw_path.empty())
+        {
+            return new MmapFrameSource(bench.raw_path, bench.fps > 0, bench.raw_loops);
+        }
+        return new SyntheticFrameSource(bench.width, bench.height, bench.fps, bench.objects, bench.frames, bench.fps > 0);
+    };
+
+    out = BenchResult();
+    if(!run_pipeline_trial(config, factory, sources, out))
+    {
+        return false;
+    }
+    out.workers = workers;
+    out.queue_size = queue_size;
+    return true;
+}
+
+static std::string to_json(const BenchConfig &bench, const std::vector<BenchResult> &results)
+{
+    std::ostringstream js;
+    char buf[1024];
+    snprintf(buf, sizeof(buf),
+             "{\n  \"config\": {\"engine\": \"%s\", \"mock_latency_ms\": %.3f, \"width\": %d, \"height\": %d, "
+             "\"fps\": %.2f, \"objects\": %d, \"frames\": %d, \"streams\": %d, \"render\": %s, \"raw\": \"%s\"},\n  \"runs\": [",
+             bench.mock ? "mock" : "rknn", bench.mock_cfg.latency_us / 1000.0, bench.width, bench.height, bench.fps,
+             bench.objects, bench.frames, bench.streams, bench.render ? "true" : "false", bench.raw_path.c_str());
+    js << buf;
+    for(size_t i = 0; i < results.size(); i++)
+    {
+        const BenchResult &r = results[i];
+        snprintf(buf, sizeof(buf),
+                 "%s\n    {\"workers\": %d, \"queue_size\": %d, \"frames_read\": %llu, \"frames_written\": %llu, "
+                 "\"frames_dropped\": %llu, \"elapsed_s\": %.3f, \"fps\": %.2f, "
+                 "\"latency_ms\": {\"p50\": %.2f, \"p90\": %.2f, \"p99\": %.2f, \"max\": %.2f}, "
+                 "\"cpu_pct\": %.1f, \"cpu_total_pct\": %.1f, \"npu_duty\": %.3f}",
+                 i == 0 ? "" : ",", r.workers, r.queue_size, (unsigned long long)r.frames_read,
+                 (unsigned long long)r.frames_written, (unsigned long long)r.frames_dropped, r.elapsed_s, r.fps,
+                 r.p50_ms, r.p90_ms, r.p99_ms, r.max_ms, r.cpu_pct, r.cpu_total_pct, r.npu_duty);
+        js << buf;
+    }
+    js << "\n  ]\n}\n";
+    return js.str();
+}
+
+int main(int argc, char **argv)
+{
+    BenchConfig bench;
+    if(parse_bench_args(argc, argv, bench) != 0)
+    {
+        return -1;
+    }
+
+    std::vector<BenchResult> results;
+    for(size_t w = 0; w < bench.workers.size(); w++)
+    {
+        for(size_t q = 0; q < bench.queues.size(); q++)
+        {
+            BenchResult r;
+            if(!run_once(bench, bench.workers[w], bench.queues[q], r))
+            {
+                std::cerr << "[Bench] workers=" << bench.workers[w] << " queue=" << bench.queues[q] << " 启动失败\n";
+                return -1;
+            }
+            std::cerr << "[Bench] workers=" << r.workers << " queue=" << r.queue_size << " fps=" << r.fps
+                      << " p99=" << r.p99_ms << " ms cpu=" << r.cpu_pct << "%\n";
+            results.push_back(r);
+        }
+    }
+
+    std::string json = to_json(bench, results);
+    std::cout << json;
+    if(!bench.json_path.empty())
+    {
+        FILE *fp = fopen(bench.json_path.c_str(), "w");
+        if(fp == NULL)
+        {
+            std::cerr << "Fail to create " << bench.json_path << "\n";
+            return -1;
+        }
+        fwrite(json.data(), 1, json.size(), fp);
+        fclose(fp);
+    }
+    return 0;
+}
@@ -0,0 +1,429 @@
+#include "cascade.h"
+#include "trace.h"
+#include "cpu_affinity.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "RgaUtils.h"
+#include "im2d.h"
+#include "im2d_task.h"
+#include "rga.h"
+
+static unsigned char *load_model_file(const char *path, unsigned int &size)
+{
+    FILE *fp = fopen(path, "rb");
+    if(fp == NULL)
+    {
+        printf("open model failed: %s\n", path);
+        return NULL;
+    }
+    fseek(fp, 0, SEEK_END);
+    size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    unsigned char *data = (unsigned char *)malloc(size);
+    if(data != NULL && fread(data, 1, size, fp) != size)
+    {
+        printf("read model failed: %s\n", path);
+        free(data);
+        data = NULL;
+    }
+    fclose(fp);
+    return data;
+}
+
+// 模型输出可能是 logits 也可能已经过 softmax：和为 1 且都在 [0,1] 时直接当概率用
+static void to_probabilities(const float *in, float *out, int n)
+{
+    float sum = 0.f;
+    bool is_prob = true;
+    for(int i = 0; i < n; i++)
+    {
+        sum += in[i];
+        is_prob = is_prob && in[i] >= 0.f && in[i] <= 1.f;
+    }
+    if(is_prob && fabsf(sum - 1.f) < 1e-2f)
+    {
+        memcpy(out, in, n * sizeof(float));
+        return;
+    }
+    float max_v = *std::max_element(in, in + n);
+    sum = 0.f;
+    for(int i = 0; i < n; i++)
+    {
+        out[i] = expf(in[i] - max_v);
+        sum += out[i];
+    }
+    for(int i = 0; i < n; i++)
+    {
+        out[i] /= sum;
+    }
+}
+
+CascadeClassifier::CascadeClassifier(const CascadeConfig &cfg)
+    : config(cfg), context(0), model_data(NULL), batch(1), model_width(0), model_height(0), model_channel(3),
+      num_attrs(0), stopping(false), frames_submitted(0), crops_classified(0), batches_run(0)
+{
+    memset(&num_tensors, 0, sizeof(num_tensors));
+}
+
+CascadeClassifier::~CascadeClassifier()
+{
+    stop();
+    if(context)
+    {
+        rknn_destroy(context);
+    }
+    free(model_data);
+}
+
+bool CascadeClassifier::open()
+{
+    unsigned int model_size = 0;
+    model_data = load_model_file(config.model_path.c_str(), model_size);
+    if(model_data == NULL)
+    {
+        return false;
+    }
+    int ret = rknn_init(&context, model_data, model_size, 0, NULL);
+    if(ret != 0)
+    {
+        printf("cascade rknn init failed! error code: %d\n", ret);
+        return false;
+    }
+
+    // 二级分类固定在一个核上，不和检测 worker 抢核（检测 worker 按编号轮流使用 0/1/2 核）
+    rknn_core_mask mask = RKNN_NPU_CORE_AUTO;
+    if(config.npu_core == 0)      { mask = RKNN_NPU_CORE_0; }
+    else if(config.npu_core == 1) { mask = RKNN_NPU_CORE_1; }
+    else if(config.npu_core == 2) { mask = RKNN_NPU_CORE_2; }
+    ret = rknn_set_core_mask(context, mask);
+    if(ret != 0)
+    {
+        printf("cascade npu set failed! error code: %d\n", ret);
+    }
+
+    ret = rknn_query(context, RKNN_QUERY_IN_OUT_NUM, &num_tensors, sizeof(num_tensors));
+    if(ret != 0 || num_tensors.n_input < 1 || num_tensors.n_output < 1)
+    {
+        printf("cascade rknn_query failed! error code: %d\n", ret);
+        return false;
+    }
+    rknn_tensor_attr input_attr;
+    memset(&input_attr, 0, sizeof(input_attr));
+    input_attr.index = 0;
+    rknn_query(context, RKNN_QUERY_INPUT_ATTR, &input_attr, sizeof(input_attr));
+    batch = std::max(1, (int)input_attr.dims[0]);
+    if(input_attr.fmt == RKNN_TENSOR_NCHW)
+    {
+        model_channel = input_attr.dims[1];
+        model_height = input_attr.dims[2];
+        model_width = input_attr.dims[3];
+    }
+    else
+    {
+        model_height = input_attr.dims[1];
+        model_width = input_attr.dims[2];
+        model_channel = input_attr.dims[3];
+    }
+
+    output_attrs.resize(num_tensors.n_output);
+    for(uint32_t i = 0; i < num_tensors.n_output; i++)
+    {
+        memset(&output_attrs[i], 0, sizeof(output_attrs[i]));
+        output_attrs[i].index = i;
+        rknn_query(context, RKNN_QUERY_OUTPUT_ATTR, &output_attrs[i], sizeof(output_attrs[i]));
+    }
+    num_attrs = output_attrs[0].n_elems / batch;
+    if(num_attrs <= 0)
+    {
+        printf("cascade model has empty output\n");
+        return false;
+    }
+
+    if(!config.labels_path.empty() && load_attribute_labels(config.labels_path.c_str()) != num_attrs)
+    {
+        std::cerr << "[Cascade] 属性标签数与模型输出 " << num_attrs << " 不一致: " << config.labels_path << "\n";
+    }
+
+    input_buf.assign((size_t)batch * model_height * model_width * model_channel, 0);
+    printf("cascade 初始化成功：batch=%d 输入=%dx%d 属性数=%d NPU核=%d\n",
+           batch, model_width, model_height, num_attrs, config.npu_core);
+
+    worker = std::thread(&CascadeClassifier::worker_loop, this);
+    return true;
+}
+
+bool CascadeClassifier::wants_class(int class_id) const
+{
+    return config.classes.empty() ||
+           std::find(config.classes.begin(), config.classes.end(), class_id) != config.classes.end();
+}
+
+std::future<detect_result_group_t> CascadeClassifier::submit(const cv::Mat &frame, const detect_result_group_t &detections)
+{
+    std::shared_ptr<CascadeFrame> cf = std::make_shared<CascadeFrame>();
+    cf->frame = frame;
+    cf->detections = detections;
+    std::future<detect_result_group_t> fut = cf->promise.get_future();
+    frames_submitted++;
+
+    std::vector<int> eligible;
+    for(size_t i = 0; i < detections.size(); i++)
+    {
+        const detect_result_t &det = detections[i];
+        int w = det.box.xmax - det.box.xmin;
+        int h = det.box.ymax - det.box.ymin;
+        if(wants_class(det.class_id) && w >= config.min_box_side && h >= config.min_box_side)
+        {
+            eligible.push_back((int)i);
+        }
+    }
+    cf->remaining = (int)eligible.size();
+    if(eligible.empty() || frame.empty())
+    {
+        cf->promise.set_value(cf->detections);
+        return fut;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        for(size_t i = 0; i < eligible.size(); i++)
+        {
+            CropJob job;
+            job.owner = cf;
+            job.det_index = eligible[i];
+            pending.push_back(job);
+        }
+    }
+    pending_cv.notify_one();
+    return fut;
+}
+
+void CascadeClassifier::stop()
+{
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        stopping = true;
+    }
+    pending_cv.notify_all();
+    if(worker.joinable())
+    {
+        worker.join();
+    }
+}
+
+//-----------------------------------
+// 分类线程：第一个框到达后最多再等 max_wait_ms 凑满一批，期间多帧的框合进同一批
+//-----------------------------------
+void CascadeClassifier::worker_loop()
+{
+    trace_set_thread_name("cascade (core " + std::to_string(config.npu_core) + ")");
+    pin_current_thread(THREAD_ROLE_WORKER);
+    std::vector<CropJob> jobs;
+    jobs.reserve(batch);
+    while(true)
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        pending_cv.wait(lock, [this] { return stopping || !pending.empty(); });
+        if(pending.empty())
+        {
+            break;
+        }
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(config.max_wait_ms);
+        pending_cv.wait_until(lock, deadline, [this] { return stopping || (int)pending.size() >= batch; });
+
+        jobs.clear();
+        while(!pending.empty() && (int)jobs.size() < batch)
+        {
+            jobs.push_back(pending.front());
+            pending.pop_front();
+        }
+        lock.unlock();
+
+        run_batch(jobs);
+    }
+}
+
+void CascadeClassifier::run_batch(std::vector<CropJob> &jobs)
+{
+    const size_t slot = (size_t)model_height * model_width * model_channel;
+    int64_t trace_mark = trace_enabled() ? trace_now_us() : 0;
+
+    // 1) 裁剪：整批放进一个 RGA 任务，每个框裁剪 + BGR 转 RGB + 缩放到输入缓冲中自己的位置
+    rga_buffer_handle_t dst_handle = importbuffer_virtualaddr(input_buf.data(), input_buf.size());
+    rga_buffer_t dst = wrapbuffer_handle(dst_handle, model_width, model_height * batch, RK_FORMAT_RGB_888);
+    rga_buffer_t pat;
+    memset(&pat, 0, sizeof(pat));
+    im_rect pat_rect = {0, 0, 0, 0};
+
+    std::map<CascadeFrame *, rga_buffer_handle_t> src_handles;
+    // 各槽位是否已填入本批的裁剪图；没填好的槽位里还是上一批的像素，推理结果不能用
+    std::vector<char> slot_ready(jobs.size(), 0);
+    std::vector<size_t> rga_slots;
+    im_job_handle_t job_handle = imbeginJob();
+    int rga_tasks = 0;
+    for(size_t i = 0; i < jobs.size(); i++)
+    {
+        CascadeFrame *cf = jobs[i].owner.get();
+        const cv::Mat &img = cf->frame;
+        const box_p &b = cf->detections[jobs[i].det_index].box;
+        cv::Rect crop = cv::Rect(b.xmin, b.ymin, b.xmax - b.xmin, b.ymax - b.ymin) & cv::Rect(0, 0, img.cols, img.rows);
+        if(crop.width < 2 || crop.height < 2)
+        {
+            crop = cv::Rect(0, 0, img.cols, img.rows);
+        }
+
+        // RGA 要求源图行宽 16 对齐；不满足时这个框用 CPU 裁剪缩放，避免为了对齐拷贝整帧
+        if(img.cols % 16 != 0 || !img.isContinuous() || dst_handle == 0)
+        {
+            cv::Mat slot_img(model_height, model_width, CV_8UC3, input_buf.data() + i * slot);
+            cv::Mat resized;
+            cv::resize(img(crop), resized, cv::Size(model_width, model_height));
+            cv::cvtColor(resized, slot_img, cv::COLOR_BGR2RGB);
+            slot_ready[i] = 1;
+            continue;
+        }
+        std::map<CascadeFrame *, rga_buffer_handle_t>::iterator it = src_handles.find(cf);
+        if(it == src_handles.end())
+        {
+            rga_buffer_handle_t h = importbuffer_virtualaddr(img.data, img.total() * img.elemSize());
+            it = src_handles.insert(std::make_pair(cf, h)).first;
+        }
+        rga_buffer_t src = wrapbuffer_handle(it->second, img.cols, img.rows, RK_FORMAT_BGR_888);
+        im_rect src_rect = {crop.x, crop.y, crop.width, crop.height};
+        im_rect dst_rect = {0, (int)i * model_height, model_width, model_height};
+        int ret = improcessTask(job_handle, src, dst, pat, src_rect, dst_rect, pat_rect, NULL, 0);
+        if(ret != IM_STATUS_SUCCESS)
+        {
+            printf("%d, cascade crop task error! %s\n", __LINE__, imStrError((IM_STATUS)ret));
+            continue;
+        }
+        rga_slots.push_back(i);
+        rga_tasks++;
+    }
+    if(rga_tasks > 0)
+    {
+        int ret = imendJob(job_handle, IM_SYNC);
+        if(ret != IM_STATUS_SUCCESS)
+        {
+            // 整个 RGA 任务失败：这一批由 RGA 裁剪的槽位都没有填好
+            printf("%d, cascade crop job error! %s\n", __LINE__, imStrError((IM_STATUS)ret));
+        }
+        else
+        {
+            for(size_t k = 0; k < rga_slots.size(); k++)
+            {
+                slot_ready[rga_slots[k]] = 1;
+            }
+        }
+    }
+    else
+    {
+        imcancelJob(job_handle);
+    }
+    for(std::map<CascadeFrame *, rga_buffer_handle_t>::iterator it = src_handles.begin(); it != src_handles.end(); ++it)
+    {
+        if(it->second)
+        {
+            releasebuffer_handle(it->second);
+        }
+    }
+    if(dst_handle)
+    {
+        releasebuffer_handle(dst_handle);
+    }
+
+    if(trace_mark)
+    {
+        int64_t now = trace_now_us();
+        trace_complete("cascade_rga", trace_mark, now, (int64_t)jobs.size());
+        trace_mark = now;
+    }
+
+    // 2) 整批推理（没凑满的位置保留上一批的内容，结果不使用）
+    rknn_input inputs[1];
+    memset(inputs, 0, sizeof(inputs));
+    inputs[0].index = 0;
+    inputs[0].type = RKNN_TENSOR_UINT8;
+    inputs[0].size = input_buf.size();
+    inputs[0].fmt = RKNN_TENSOR_NHWC;
+    inputs[0].buf = input_buf.data();
+    rknn_inputs_set(context, 1, inputs);
+
+    std::vector<rknn_output> outputs(num_tensors.n_output);
+    memset(outputs.data(), 0, outputs.size() * sizeof(rknn_output));
+    for(size_t i = 0; i < outputs.size(); i++)
+    {
+        outputs[i].want_float = 1;
+    }
+    int ret = rknn_run(context, NULL);
+    if(ret == 0)
+    {
+        ret = rknn_outputs_get(context, num_tensors.n_output, outputs.data(), NULL);
+    }
+    if(ret != 0)
+    {
+        printf("cascade rknn_run failed! error code: %d\n", ret);
+    }
+    batches_run++;
+    crops_classified += jobs.size();
+    if(trace_mark)
+    {
+        trace_complete("cascade_rknn", trace_mark, trace_now_us(), (int64_t)jobs.size());
+    }
+
+    // 3) 属性写回各框；一帧的最后一个框分完时兑现该帧
+    std::vector<float> prob(num_attrs);
+    for(size_t i = 0; i < jobs.size(); i++)
+    {
+        CascadeFrame *cf = jobs[i].owner.get();
+        detect_result_t &det = cf->detections[jobs[i].det_index];
+        // 裁剪失败的框不写属性，attr_id 保持 0（未分类）
+        if(ret == 0 && slot_ready[i])
+        {
+            to_probabilities((const float *)outputs[0].buf + i * num_attrs, prob.data(), num_attrs);
+            int best = (int)(std::max_element(prob.begin(), prob.end()) - prob.begin());
+            det.attr_id = (uint16_t)(best + 1);
+            det.attr_conf = (uint16_t)(prob[best] * 10000.f + 0.5f);
+        }
+        else
+        {
+            det.attr_id = 0;
+            det.attr_conf = 0;
+        }
+        if(--cf->remaining == 0)
+        {
+            cf->promise.set_value(cf->detections);
+        }
+    }
+    if(ret == 0)
+    {
+        rknn_outputs_release(context, num_tensors.n_output, outputs.data());
+    }
+}
+
+CascadeStats CascadeClassifier::stats() const
+{
+    CascadeStats s;
+    s.frames = frames_submitted.load();
+    s.crops = crops_classified.load();
+    s.batches = batches_run.load();
+    if(s.batches > 0)
+    {
+        s.occupancy = (double)s.crops / (s.batches * batch);
+    }
+    return s;
+}
+
+void CascadeClassifier::print_stats() const
+{
+    CascadeStats s = stats();
+    std::cout << "[Cascade] 帧=" << s.frames << " 框=" << s.crops << " 批次=" << s.batches
+              << " batch=" << batch << " 平均占用率=" << s.occupancy * 100 << "%" << std::endl;
+}
@@ -0,0 +1,103 @@
+#ifndef CASCADE_H
+#define CASCADE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#include "rknn_api.h"
+#include "post_process.h"
+
+// 二级分类（属性识别）参数
+struct CascadeConfig
+{
+    bool enabled;
+    std::string model_path;    // 二级分类 RKNN 模型，输入 NHWC uint8 RGB，输出 [batch, 类别数]
+    std::string labels_path;   // 属性标签文件，每行一个
+    int npu_core;              // 运行在哪个 NPU 核上：0/1/2，-1 由驱动自动选择
+    int max_wait_ms;           // 凑批最多等待的时间，到时即使没凑满也运行
+    int min_box_side;          // 边长小于该值的框不分类
+    std::vector<int> classes;  // 只对这些检测类别分类，为空表示全部
+
+    CascadeConfig() : enabled(false), npu_core(2), max_wait_ms(10), min_box_side(16) {}
+};
+
+// 运行统计
+struct CascadeStats {
+    uint64_t frames = 0;     // 提交的帧数
+    uint64_t crops = 0;      // 分类的框数
+    uint64_t batches = 0;    // 模型运行次数
+    double occupancy = 0;    // 平均每批占用率（crops / (batches * batch_size)）
+};
+
+//-----------------------------------
+// 检测框二级分类：聚合线程按帧提交检测结果，分类线程把多帧的框攒成一批，
+// 用 RGA 批处理任务把各框从原图裁剪、转 RGB、缩放到模型输入的对应位置，一次推理整批，
+// 属性写回各框的 attr_id/attr_conf；一帧的框全部分完后兑现该帧的 future
+//-----------------------------------
+class CascadeClassifier
+{
+public:
+    explicit CascadeClassifier(const CascadeConfig &cfg);
+    ~CascadeClassifier();
+
+    // 加载模型并启动分类线程，成功返回 true
+    bool open();
+    // 提交一帧：frame 在 future 兑现前不能被改写（只读共享即可）
+    std::future<detect_result_group_t> submit(const cv::Mat &frame, const detect_result_group_t &detections);
+    // 处理完已提交的框后退出分类线程
+    void stop();
+
+    int batch_size() const { return batch; }
+    CascadeStats stats() const;
+    void print_stats() const;
+
+private:
+    // 一帧的分类状态，多个框共享
+    struct CascadeFrame {
+        cv::Mat frame;
+        detect_result_group_t detections;
+        std::promise<detect_result_group_t> promise;
+        int remaining;  // 还没分完的框数，只在分类线程中访问
+    };
+    // 一个待分类的框
+    struct CropJob {
+        std::shared_ptr<CascadeFrame> owner;
+        int det_index;
+    };
+
+    void worker_loop();
+    void run_batch(std::vector<CropJob> &jobs);
+    bool wants_class(int class_id) const;
+
+    CascadeConfig config;
+    rknn_context context;
+    unsigned char *model_data;
+    rknn_input_output_num num_tensors;
+    std::vector<rknn_tensor_attr> output_attrs;
+    int batch;          // 模型一次推理的框数（模型输入的 batch 维）
+    int model_width;
+    int model_height;
+    int model_channel;
+    int num_attrs;      // 每个框的输出类别数
+    std::vector<unsigned char> input_buf;
+
+    std::mutex mtx;
+    std::condition_variable pending_cv;
+    std::deque<CropJob> pending;
+    bool stopping;
+    std::thread worker;
+
+    std::atomic<uint64_t> frames_submitted;
+    std::atomic<uint64_t> crops_classified;
+    std::atomic<uint64_t> batches_run;
+};
+
+#endif
@@ -0,0 +1,312 @@
+#include "cpu_affinity.h"
+
+#include <algorithm>
+#include <atomic>
+#include <errno.h>
+#include <iostream>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// 启动线程前由 set_cpu_placement 填好，之后只读
+static bool g_pin_enabled = false;
+static std::vector<int> g_role_cpus[THREAD_ROLE_NUM];
+static std::atomic<bool> g_pin_warned(false);
+
+static const char *g_role_names[THREAD_ROLE_NUM] = {"read", "aggregate", "worker", "write", "log", "io"};
+
+CpuPlacementConfig::CpuPlacementConfig() : enabled(false)
+{
+    spec[THREAD_ROLE_READ]      = "big";
+    spec[THREAD_ROLE_AGGREGATE] = "big";
+    spec[THREAD_ROLE_WORKER]    = "big";
+    spec[THREAD_ROLE_WRITE]     = "big";
+    spec[THREAD_ROLE_LOG]       = "little";
+    spec[THREAD_ROLE_IO]        = "little";
+}
+
+bool parse_thread_role(const std::string &name, ThreadRole &role)
+{
+    for(int r = 0; r < THREAD_ROLE_NUM; r++)
+    {
+        if(name == g_role_names[r])
+        {
+            role = (ThreadRole)r;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *thread_role_name(ThreadRole role)
+{
+    return (role >= 0 && role < THREAD_ROLE_NUM) ? g_role_names[role] : "unknown";
+}
+
+bool parse_cpu_placement(const std::string &arg, CpuPlacementConfig &cfg)
+{
+    size_t eq = arg.find('=');
+    ThreadRole role;
+    if(eq == std::string::npos || eq + 1 >= arg.size() || !parse_thread_role(arg.substr(0, eq), role))
+    {
+        return false;
+    }
+    cfg.spec[role] = arg.substr(eq + 1);
+    return true;
+}
+
+//-----------------------------------
+// 拓扑识别
+//-----------------------------------
+// 读 sysfs 中的一个整数，文件不存在或内容有误返回 -1
+static long read_sysfs_long(int cpu, const char *name)
+{
+    char path[128];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/%s", cpu, name);
+    FILE *fp = fopen(path, "r");
+    if(fp == NULL)
+    {
+        return -1;
+    }
+    long v = -1;
+    if(fscanf(fp, "%ld", &v) != 1)
+    {
+        v = -1;
+    }
+    fclose(fp);
+    return v;
+}
+
+// 进程当前允许运行的核（容器、taskset 可能已经限制过）
+static std::vector<int> allowed_cpus()
+{
+    std::vector<int> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if(sched_getaffinity(0, sizeof(set), &set) == 0)
+    {
+        for(int c = 0; c < CPU_SETSIZE; c++)
+        {
+            if(CPU_ISSET(c, &set))
+            {
+                cpus.push_back(c);
+            }
+        }
+    }
+    if(cpus.empty())
+    {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        for(int c = 0; c < n; c++)
+        {
+            cpus.push_back(c);
+        }
+    }
+    return cpus;
+}
+
+void detect_cpu_topology(CpuTopology &topo)
+{
+    std::vector<int> cpus = allowed_cpus();
+    topo.big = cpus;
+    topo.little = cpus;
+    topo.source = "none";
+
+    // 依次尝试两种依据，所有核都读得到才采用
+    const char *sources[] = {"cpu_capacity", "cpufreq/cpuinfo_max_freq"};
+    for(int s = 0; s < 2; s++)
+    {
+        std::vector<long> values;
+        for(size_t i = 0; i < cpus.size(); i++)
+        {
+            long v = read_sysfs_long(cpus[i], sources[s]);
+            if(v <= 0)
+            {
+                break;
+            }
+            values.push_back(v);
+        }
+        if(values.size() != cpus.size() || cpus.empty())
+        {
+            continue;
+        }
+        long max_v = *std::max_element(values.begin(), values.end());
+        topo.big.clear();
+        topo.little.clear();
+        for(size_t i = 0; i < cpus.size(); i++)
+        {
+            (values[i] == max_v ? topo.big : topo.little).push_back(cpus[i]);
+        }
+        topo.source = sources[s];
+        if(topo.little.empty())
+        {
+            // 同构：小核也用全部核
+            topo.little = topo.big;
+        }
+        return;
+    }
+}
+
+//-----------------------------------
+// 绑核
+//-----------------------------------
+// 解析核列表 "0-3,6"，失败返回 false
+static bool parse_cpu_list(const std::string &s, std::vector<int> &cpus)
+{
+    cpus.clear();
+    const char *p = s.c_str();
+    while(*p)
+    {
+        char *end = NULL;
+        long first = strtol(p, &end, 10);
+        if(end == p || first < 0)
+        {
+            return false;
+        }
+        long last = first;
+        p = end;
+        if(*p == '-')
+        {
+            last = strtol(p + 1, &end, 10);
+            if(end == p + 1 || last < first)
+            {
+                return false;
+            }
+            p = end;
+        }
+        for(long c = first; c <= last && c < CPU_SETSIZE; c++)
+        {
+            cpus.push_back((int)c);
+        }
+        if(*p == ',')
+        {
+            p++;
+        }
+        else if(*p != '\0')
+        {
+            return false;
+        }
+    }
+    return !cpus.empty();
+}
+
+static std::string format_cpu_list(const std::vector<int> &cpus)
+{
+    std::string out;
+    for(size_t i = 0; i < cpus.size(); i++)
+    {
+        size_t j = i;
+        while(j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1)
+        {
+            j++;
+        }
+        if(!out.empty())
+        {
+            out += ",";
+        }
+        out += std::to_string(cpus[i]);
+        if(j > i)
+        {
+            out += "-" + std::to_string(cpus[j]);
+        }
+        i = j;
+    }
+    return out.empty() ? "any" : out;
+}
+
+bool set_cpu_placement(const CpuPlacementConfig &cfg)
+{
+    g_pin_enabled = false;
+    for(int r = 0; r < THREAD_ROLE_NUM; r++)
+    {
+        g_role_cpus[r].clear();
+    }
+    if(!cfg.enabled)
+    {
+        return true;
+    }
+
+    CpuTopology topo;
+    detect_cpu_topology(topo);
+    std::vector<int> allowed = allowed_cpus();
+    if(topo.heterogeneous())
+    {
+        std::cout << "[CpuPin] 大核 " << format_cpu_list(topo.big) << "，小核 " << format_cpu_list(topo.little)
+                  << "（依据 " << topo.source << "）" << std::endl;
+    }
+    else
+    {
+        std::cout << "[CpuPin] 未识别出大小核，big/little 按全部可用核 " << format_cpu_list(allowed) << " 处理" << std::endl;
+    }
+
+    std::vector<int> resolved[THREAD_ROLE_NUM];
+    for(int r = 0; r < THREAD_ROLE_NUM; r++)
+    {
+        const std::string &spec = cfg.spec[r];
+        if(spec == "any")
+        {
+            continue;
+        }
+        if(spec == "big")
+        {
+            resolved[r] = topo.big;
+        }
+        else if(spec == "little")
+        {
+            resolved[r] = topo.little;
+        }
+        else if(!parse_cpu_list(spec, resolved[r]))
+        {
+            std::cerr << "[CpuPin] " << g_role_names[r] << " 的绑核描述有误: " << spec << "，不绑核\n";
+            return false;
+        }
+        else
+        {
+            for(size_t i = 0; i < resolved[r].size(); i++)
+            {
+                if(std::find(allowed.begin(), allowed.end(), resolved[r][i]) == allowed.end())
+                {
+                    std::cerr << "[CpuPin] " << g_role_names[r] << " 指定的核 " << resolved[r][i]
+                              << " 不存在或不允许使用（可用 " << format_cpu_list(allowed) << "），不绑核\n";
+                    return false;
+                }
+            }
+        }
+        // 覆盖了全部可用核等于不绑，省掉系统调用
+        if(resolved[r].size() == allowed.size())
+        {
+            resolved[r].clear();
+        }
+    }
+
+    std::cout << "[CpuPin]";
+    for(int r = 0; r < THREAD_ROLE_NUM; r++)
+    {
+        g_role_cpus[r] = resolved[r];
+        std::cout << " " << g_role_names[r] << "=" << format_cpu_list(resolved[r]);
+    }
+    std::cout << std::endl;
+    g_pin_enabled = true;
+    return true;
+}
+
+void pin_current_thread(ThreadRole role)
+{
+    if(!g_pin_enabled || role < 0 || role >= THREAD_ROLE_NUM || g_role_cpus[role].empty())
+    {
+        return;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    const std::vector<int> &cpus = g_role_cpus[role];
+    for(size_t i = 0; i < cpus.size(); i++)
+    {
+        CPU_SET(cpus[i], &set);
+    }
+    // pid 0 即调用线程本身；失败（如 seccomp 限制）只提示一次，线程照常运行
+    if(sched_setaffinity(0, sizeof(set), &set) != 0 && !g_pin_warned.exchange(true))
+    {
+        std::cerr << "[CpuPin] sched_setaffinity 失败: " << strerror(errno) << "，线程不绑核\n";
+    }
+}
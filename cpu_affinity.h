@@ -0,0 +1,61 @@
+#ifndef CPU_AFFINITY_H
+#define CPU_AFFINITY_H
+
+#include <string>
+#include <vector>
+
+//-----------------------------------
+// CPU 绑核
+//   RK3588 是 4 个 A76 大核 + 4 个 A55 小核，线程随调度器漂移时延迟抖动很大。
+//   按线程职责绑核：解码、后处理、编码放大核，日志和文件 I/O 放小核。
+//   大小核从 sysfs 的 cpu_capacity（没有时用 cpuinfo_max_freq）识别；
+//   识别不出大小核的机器上 big / little 都等于全部可用核，相当于不绑
+//-----------------------------------
+
+// 线程职责，每个线程启动时调用 pin_current_thread 绑到对应的核上
+enum ThreadRole {
+    THREAD_ROLE_READ = 0,   // 读线程 / 分段解码线程
+    THREAD_ROLE_AGGREGATE,  // 聚合线程（运动门控、跟踪）
+    THREAD_ROLE_WORKER,     // NPU worker（前处理、后处理）与二级分类线程
+    THREAD_ROLE_WRITE,      // 写线程 / 分段编码线程
+    THREAD_ROLE_LOG,        // 日志后台线程
+    THREAD_ROLE_IO,         // 调试转储、流拷贝等文件 I/O
+    THREAD_ROLE_NUM
+};
+
+struct CpuTopology
+{
+    std::vector<int> big;     // 最高算力的核
+    std::vector<int> little;  // 其余的核；同构机器上与 big 相同
+    std::string source;       // 识别依据：cpu_capacity / cpuinfo_max_freq / none
+
+    bool heterogeneous() const { return big != little; }
+};
+
+// 绑核策略：每种职责一个描述 big|little|any|核列表（如 4-7 或 0,2），any 表示不绑
+struct CpuPlacementConfig
+{
+    bool enabled;
+    std::string spec[THREAD_ROLE_NUM];
+
+    // 默认：解码、聚合、worker、编码放大核，日志与 I/O 放小核；未开启时不绑
+    CpuPlacementConfig();
+};
+
+// 从 sysfs 读取大小核划分，只保留进程当前允许运行的核
+void detect_cpu_topology(CpuTopology &topo);
+
+// 字符串与职责互转："read" / "aggregate" / "worker" / "write" / "log" / "io"
+bool parse_thread_role(const std::string &name, ThreadRole &role);
+const char *thread_role_name(ThreadRole role);
+
+// 解析 ROLE=SPEC，如 worker=big、log=0-3
+bool parse_cpu_placement(const std::string &arg, CpuPlacementConfig &cfg);
+
+// 识别拓扑并按策略算出每种职责的核集合，在启动任何线程之前调用
+// 描述有误（如核号不存在）时打印并退回不绑，返回 false
+bool set_cpu_placement(const CpuPlacementConfig &cfg);
+// 把当前线程绑到 role 对应的核上；未开启或该职责为 any 时什么也不做
+void pin_current_thread(ThreadRole role);
+
+#endif
@@ -0,0 +1,135 @@
+#include "debug_dump.h"
+#include "cpu_affinity.h"
+
+#include <iostream>
+#include <stdio.h>
+
+DebugDumper &DebugDumper::instance()
+{
+    static DebugDumper dumper;
+    return dumper;
+}
+
+void DebugDumper::start(const DebugDumpConfig &config_in)
+{
+    if(running || !config_in.enabled)
+    {
+        return;
+    }
+    cfg = config_in;
+    queue.reset(new SafeQueue<DumpJob>(cfg.queue_size > 0 ? cfg.queue_size : 1));
+    running = true;
+    io_thread = std::thread(&DebugDumper::io_loop, this);
+    std::cout << "[DebugDump] 转储到 " << cfg.dir << "/：every_n=" << cfg.every_n << " slow_ms=" << cfg.slow_ms
+              << " on_empty=" << cfg.on_empty << std::endl;
+}
+
+void DebugDumper::stop()
+{
+    if(!running)
+    {
+        return;
+    }
+    running = false;
+    // stop 之后 dequeue 仍会取完剩余的元素才返回 false
+    queue->stop();
+    if(io_thread.joinable())
+    {
+        io_thread.join();
+    }
+}
+
+bool DebugDumper::want_sample(int frame_index) const
+{
+    return enabled() && cfg.every_n > 0 && frame_index % cfg.every_n == 0;
+}
+
+const char *DebugDumper::anomaly(int64_t infer_us, size_t detections) const
+{
+    if(!enabled())
+    {
+        return NULL;
+    }
+    if(cfg.slow_ms > 0 && infer_us > (int64_t)cfg.slow_ms * 1000)
+    {
+        return "slow";
+    }
+    if(cfg.on_empty && detections == 0)
+    {
+        return "empty";
+    }
+    return NULL;
+}
+
+bool DebugDumper::submit(int stream_id, int frame_index, const char *tag, const cv::Mat &img, bool rgb)
+{
+    if(!enabled() || img.empty())
+    {
+        return false;
+    }
+    // 先判断再拷贝：队列满或到了文件数上限时不做无用的深拷贝
+    if(queue->size() >= queue->capacity())
+    {
+        dropped++;
+        return false;
+    }
+    // 先占一个文件名额，多个 worker 同时提交也不会超过上限；入队失败再退还
+    if(cfg.max_files > 0 && submitted.fetch_add(1) >= (uint64_t)cfg.max_files)
+    {
+        submitted--;
+        dropped++;
+        return false;
+    }
+
+    char name[64];
+    snprintf(name, sizeof(name), "/s%d_f%06d_%s.jpg", stream_id, frame_index, tag);
+    DumpJob job;
+    job.path = cfg.dir + name;
+    job.img = img.clone();
+    job.rgb = rgb;
+    if(!queue->try_enqueue(job))
+    {
+        if(cfg.max_files > 0)
+        {
+            submitted--;
+        }
+        dropped++;
+        return false;
+    }
+    if(cfg.max_files <= 0)
+    {
+        submitted++;
+    }
+    return true;
+}
+
+void DebugDumper::io_loop()
+{
+    pin_current_thread(THREAD_ROLE_IO);
+    DumpJob job;
+    while(queue->dequeue(job))
+    {
+        cv::Mat out = job.img;
+        if(job.rgb)
+        {
+            cv::cvtColor(job.img, out, cv::COLOR_RGB2BGR);
+        }
+        if(cv::imwrite(job.path, out))
+        {
+            written++;
+        }
+        else
+        {
+            std::cerr << "[DebugDump] 写入失败: " << job.path << "\n";
+        }
+    }
+}
+
+void DebugDumper::print_stats() const
+{
+    if(submitted == 0 && dropped == 0)
+    {
+        return;
+    }
+    std::cout << "[DebugDump] 入队=" << submitted << " 写出=" << written << " 丢弃=" << dropped << std::endl;
+}
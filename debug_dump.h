@@ -0,0 +1,75 @@
+#ifndef DEBUG_DUMP_H
+#define DEBUG_DUMP_H
+
+#include <atomic>
+#include <memory>
+#include <opencv2/opencv.hpp>
+#include <stdint.h>
+#include <string>
+#include <thread>
+
+#include "SafeQueue.h"
+
+// 调试图片转储参数，默认关闭
+struct DebugDumpConfig
+{
+    bool enabled;
+    std::string dir;     // 输出目录（需已存在）
+    int every_n;         // 每路流每 N 帧采样一帧（原图 + RGA 处理后的模型输入），<=0 不按间隔采样
+    int slow_ms;         // 异常：单帧推理（取出任务到后处理完成）超过该毫秒数时转储原图，<=0 不检查
+    bool on_empty;       // 异常：没有任何检测框的帧转储原图
+    int queue_size;      // 后台 I/O 队列容量，满了丢弃
+    int max_files;       // 最多写出的文件数，防止写满磁盘，<=0 不限
+
+    DebugDumpConfig() : enabled(false), dir("dump"), every_n(0), slow_ms(0), on_empty(false),
+                        queue_size(8), max_files(1000) {}
+};
+
+//-----------------------------------
+// 调试图片转储：推理线程只做一次深拷贝放入有界队列，JPEG 编码与写文件交给后台 I/O 线程，
+// 文件按 流编号 / 帧号 / 标签 命名，多个 worker 之间不会互相覆盖
+//-----------------------------------
+class DebugDumper
+{
+public:
+    static DebugDumper &instance();
+
+    void start(const DebugDumpConfig &cfg);
+    // 写完队列中剩余的图片后停止
+    void stop();
+
+    bool enabled() const { return running.load(std::memory_order_relaxed); }
+    const DebugDumpConfig &config() const { return cfg; }
+
+    // 这一帧是否按间隔采样（采样帧还会保存模型输入）
+    bool want_sample(int frame_index) const;
+    // 按推理结果判断是否异常，返回异常标签（"slow" / "empty"），正常返回 NULL
+    const char *anomaly(int64_t infer_us, size_t detections) const;
+
+    // 放入 I/O 队列（内部深拷贝）；rgb 为 true 时写文件前转成 BGR。队列满或超过文件数上限时丢弃
+    bool submit(int stream_id, int frame_index, const char *tag, const cv::Mat &img, bool rgb = false);
+
+    void print_stats() const;
+
+private:
+    struct DumpJob {
+        std::string path;
+        cv::Mat img;
+        bool rgb;
+    };
+
+    DebugDumper() : running(false), submitted(0), written(0), dropped(0) {}
+    // main 提前返回时没有人调用 stop()，静态对象析构时收尾，避免析构仍可 join 的线程
+    ~DebugDumper() { stop(); }
+    void io_loop();
+
+    DebugDumpConfig cfg;
+    std::unique_ptr<SafeQueue<DumpJob> > queue;
+    std::thread io_thread;
+    std::atomic<bool> running;
+    std::atomic<uint64_t> submitted;
+    std::atomic<uint64_t> written;
+    std::atomic<uint64_t> dropped;
+};
+
+#endif
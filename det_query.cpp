@@ -0,0 +1,171 @@
+// det_query.cpp：在列式检测结果库上做查询，不依赖 OpenCV
+//   例：时间段 [60s, 3600s] 内出现至少 3 个 person 的帧
+//       det_query out.rkds --class person --min-count 3 --from 60 --to 3600
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "detection_store.h"
+
+static void print_usage(const char *prog)
+{
+    std::cout << "用法: " << prog << " STORE [选项]\n"
+              << "  --class C       只统计该类别（名字或编号）\n"
+              << "  --min-count N   输出匹配框数 >= N 的帧（默认 1）\n"
+              << "  --from SEC      起始时间（秒）\n"
+              << "  --to SEC        结束时间（秒）\n"
+              << "  --min-conf C    置信度下限\n"
+              << "  --summary       只输出各类别的框数统计\n";
+}
+
+int main(int argc, char **argv)
+{
+    if(argc < 2 || strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0)
+    {
+        print_usage(argv[0]);
+        return -1;
+    }
+    std::string path = argv[1];
+    std::string class_arg;
+    int min_count = 1;
+    double from_ms = -1e300;
+    double to_ms = 1e300;
+    float min_conf = 0.0f;
+    bool summary = false;
+
+    for(int i = 2; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        if(strcmp(arg, "--summary") == 0)
+        {
+            summary = true;
+            continue;
+        }
+        if(i + 1 >= argc)
+        {
+            std::cerr << "参数缺少取值: " << arg << "\n";
+            return -1;
+        }
+        const char *val = argv[++i];
+        if(strcmp(arg, "--class") == 0)          { class_arg = val; }
+        else if(strcmp(arg, "--min-count") == 0) { min_count = atoi(val); }
+        else if(strcmp(arg, "--from") == 0)      { from_ms = atof(val) * 1000.0; }
+        else if(strcmp(arg, "--to") == 0)        { to_ms = atof(val) * 1000.0; }
+        else if(strcmp(arg, "--min-conf") == 0)  { min_conf = (float)atof(val); }
+        else
+        {
+            std::cerr << "未知参数: " << arg << "\n";
+            print_usage(argv[0]);
+            return -1;
+        }
+    }
+
+    DetectionStoreReader store;
+    if(!store.open(path))
+    {
+        return -1;
+    }
+
+    int class_id = -1;
+    if(!class_arg.empty())
+    {
+        char *end = NULL;
+        long id = strtol(class_arg.c_str(), &end, 10);
+        class_id = (*end == '\0') ? (int)id : store.class_id_of(class_arg);
+        if(class_id < 0)
+        {
+            std::cerr << "库中没有类别: " << class_arg << "\n";
+            return -1;
+        }
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    size_t scanned_blocks = 0;
+    uint64_t scanned_rows = 0;
+    uint64_t matched_frames = 0;
+    std::vector<uint64_t> class_counts;
+
+    // 检测框按帧序存放，同一帧的框连续出现：遇到新帧号时结算上一帧
+    int32_t cur_frame = -1;
+    double cur_pts = 0;
+    int cur_count = 0;
+
+    for(size_t b = 0; b < store.block_count(); b++)
+    {
+        const StoreBlockView &blk = store.block(b);
+        const StoreBlockHeader &h = *blk.header;
+        // 用块头的 min/max 与类别位图跳过整块
+        if(h.max_pts < from_ms || h.min_pts > to_ms || h.max_conf < min_conf)
+        {
+            continue;
+        }
+        if(class_id >= 0 && !store_block_has_class(h, class_id))
+        {
+            continue;
+        }
+        scanned_blocks++;
+        scanned_rows += h.rows;
+
+        for(uint32_t i = 0; i < h.rows; i++)
+        {
+            if(blk.pts_ms[i] < from_ms || blk.pts_ms[i] > to_ms || blk.conf[i] < min_conf)
+            {
+                continue;
+            }
+            if(class_id >= 0 && blk.class_id[i] != class_id)
+            {
+                continue;
+            }
+            if(summary)
+            {
+                if(blk.class_id[i] >= class_counts.size())
+                {
+                    class_counts.resize(blk.class_id[i] + 1, 0);
+                }
+                class_counts[blk.class_id[i]]++;
+                continue;
+            }
+            if(blk.frame[i] != cur_frame)
+            {
+                if(cur_count >= min_count && cur_frame >= 0)
+                {
+                    printf("%d\t%.3f\t%d\n", cur_frame, cur_pts / 1000.0, cur_count);
+                    matched_frames++;
+                }
+                cur_frame = blk.frame[i];
+                cur_pts = blk.pts_ms[i];
+                cur_count = 0;
+            }
+            cur_count++;
+        }
+    }
+    if(!summary && cur_count >= min_count && cur_frame >= 0)
+    {
+        printf("%d\t%.3f\t%d\n", cur_frame, cur_pts / 1000.0, cur_count);
+        matched_frames++;
+    }
+
+    if(summary)
+    {
+        for(size_t c = 0; c < class_counts.size(); c++)
+        {
+            if(class_counts[c] > 0)
+            {
+                printf("%s\t%llu\n", store.label_of((int)c).c_str(), (unsigned long long)class_counts[c]);
+            }
+        }
+    }
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    std::cerr << "扫描 " << scanned_blocks << "/" << store.block_count() << " 块，" << scanned_rows << " 个框";
+    if(!summary)
+    {
+        std::cerr << "，匹配 " << matched_frames << " 帧";
+    }
+    std::cerr << "，用时 " << ms << " ms\n";
+    return 0;
+}
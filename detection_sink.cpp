@@ -0,0 +1,173 @@
+#include "detection_sink.h"
+#include "cpu_affinity.h"
+
+#include <iostream>
+#include <stdlib.h>
+#include <string.h>
+
+// 扩展名（含点）在路径中的位置，没有扩展名时返回 npos
+static size_t extension_pos(const std::string &path)
+{
+    size_t dot = path.find_last_of('.');
+    size_t slash = path.find_last_of('/');
+    if(dot != std::string::npos && (slash == std::string::npos || dot > slash))
+    {
+        return dot;
+    }
+    return std::string::npos;
+}
+
+std::string sidecar_path_for(const std::string &output_path, SidecarFormat format)
+{
+    std::string base = output_path.substr(0, extension_pos(output_path));
+    return base + (format == SIDECAR_BINARY ? ".rkdt" : ".jsonl");
+}
+
+std::string remux_path_for(const std::string &output_path, const std::string &input_path)
+{
+    size_t in_dot = extension_pos(input_path);
+    if(in_dot == std::string::npos)
+    {
+        return output_path;
+    }
+    return output_path.substr(0, extension_pos(output_path)) + input_path.substr(in_dot);
+}
+
+DetectionSidecarSink::DetectionSidecarSink(const std::string &sidecar_path_in, SidecarFormat format_in,
+                                           const std::string &remux_in, const std::string &remux_out)
+    : sidecar_path(sidecar_path_in), format(format_in), remux_input(remux_in), remux_output(remux_out),
+      fp(NULL), remux_ret(0), frames_written(0)
+{
+}
+
+DetectionSidecarSink::~DetectionSidecarSink()
+{
+    close();
+}
+
+bool DetectionSidecarSink::open(int width, int height, double fps)
+{
+    fp = fopen(sidecar_path.c_str(), format == SIDECAR_BINARY ? "wb" : "w");
+    if(fp == NULL)
+    {
+        std::cerr << "Fail to create sidecar file: " << sidecar_path << "\n";
+        return false;
+    }
+    // 每帧只有几十到几百字节，用大缓冲合并成少量 write 调用
+    setvbuf(fp, NULL, _IOFBF, 1 << 20);
+
+    if(format == SIDECAR_BINARY)
+    {
+        SidecarHeader header;
+        memcpy(header.magic, SIDECAR_MAGIC, 4);
+        header.version = SIDECAR_VERSION;
+        header.width = width;
+        header.height = height;
+        header.fps = (float)fps;
+        fwrite(&header, sizeof(header), 1, fp);
+    }
+
+    // 重新封装与推理互不依赖，开始时就在后台进行
+    if(!remux_input.empty() && !remux_output.empty())
+    {
+        remux_thread = std::thread(&DetectionSidecarSink::remux_thread_func, this);
+    }
+    return true;
+}
+
+void DetectionSidecarSink::remux_thread_func()
+{
+    // 流拷贝：原始码流原样写入新容器，不解码也不重编码；ffmpeg 子进程继承本线程的绑核
+    pin_current_thread(THREAD_ROLE_IO);
+    // 只拷贝视频和（如果有的）音频：-map 0 会带上数据轨、时间元数据轨，很多容器装不下
+    std::string cmd = "ffmpeg -y -loglevel error -i " + shell_quote(remux_input) + " -map 0:v -map 0:a? -c copy " +
+                      shell_quote(remux_output);
+    remux_ret = system(cmd.c_str());
+}
+
+void DetectionSidecarSink::write(const FrameData &fd)
+{
+    if(fp == NULL)
+    {
+        return;
+    }
+    if(format == SIDECAR_BINARY)
+    {
+        write_binary(fd);
+    }
+    else
+    {
+        write_jsonl(fd);
+    }
+    frames_written++;
+}
+
+void DetectionSidecarSink::write_jsonl(const FrameData &fd)
+{
+    const detect_result_group_t &group = fd.detections;
+    fprintf(fp, "{\"frame\":%d,\"pts_ms\":%.3f,\"boxes\":[", fd.index, fd.pts_ms);
+    for(size_t i = 0; i < group.size(); i++)
+    {
+        const detect_result_t &det = group[i];
+        fprintf(fp, "%s{\"cls\":%d,\"label\":\"%s\",\"id\":%d,\"conf\":%.4f,\"box\":[%d,%d,%d,%d]",
+                i > 0 ? "," : "", det.class_id, class_label(det.class_id), det.track_id, det.box_conf,
+                det.box.xmin, det.box.ymin, det.box.xmax, det.box.ymax);
+        if(det.attr_id != 0)
+        {
+            fprintf(fp, ",\"attr\":\"%s\",\"attr_conf\":%.4f", attribute_label(det.attr_id), det.attr_conf / 10000.0);
+        }
+        fputc('}', fp);
+    }
+    fputs("]}\n", fp);
+}
+
+void DetectionSidecarSink::write_binary(const FrameData &fd)
+{
+    const detect_result_group_t &group = fd.detections;
+    SidecarFrameRecord rec;
+    rec.frame = fd.index;
+    rec.pts_ms = fd.pts_ms;
+    rec.count = (uint16_t)(group.size() < OBJ_NUM_MAX_SIZE ? group.size() : OBJ_NUM_MAX_SIZE);
+    fwrite(&rec, sizeof(rec), 1, fp);
+
+    SidecarBoxRecord boxes[OBJ_NUM_MAX_SIZE];
+    for(int i = 0; i < rec.count; i++)
+    {
+        const detect_result_t &det = group[i];
+        boxes[i].class_id = det.class_id;
+        boxes[i].conf = det.box_conf;
+        boxes[i].xmin = det.box.xmin;
+        boxes[i].ymin = det.box.ymin;
+        boxes[i].xmax = det.box.xmax;
+        boxes[i].ymax = det.box.ymax;
+        boxes[i].track_id = det.track_id;
+        boxes[i].attr_id = det.attr_id;
+        boxes[i].attr_conf = det.attr_conf;
+    }
+    if(rec.count > 0)
+    {
+        fwrite(boxes, sizeof(SidecarBoxRecord), rec.count, fp);
+    }
+}
+
+void DetectionSidecarSink::close()
+{
+    if(fp != NULL)
+    {
+        fclose(fp);
+        fp = NULL;
+        std::cout << "[DetectionSidecarSink] 已写出 " << frames_written << " 帧检测结果到 " << sidecar_path << "\n";
+    }
+    if(remux_thread.joinable())
+    {
+        remux_thread.join();
+        if(remux_ret != 0)
+        {
+            std::cerr << "[DetectionSidecarSink] ffmpeg 重新封装失败(" << remux_ret << "): " << remux_input << "\n";
+        }
+        else
+        {
+            std::cout << "[DetectionSidecarSink] 原视频已流拷贝到 " << remux_output << "\n";
+        }
+    }
+}
@@ -0,0 +1,100 @@
+#ifndef DETECTION_SINK_H
+#define DETECTION_SINK_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <thread>
+
+#include "frame_sink.h"
+
+// 输出内容
+enum OutputMode {
+    OUTPUT_VIDEO = 0,  // 画框后重新编码成视频（原有方式）
+    OUTPUT_SIDECAR,    // 只写检测结果文件，不输出视频
+    OUTPUT_REMUX       // 检测结果文件 + 原视频流拷贝重新封装（不解码、不重编码）
+};
+
+// 检测结果文件格式
+enum SidecarFormat {
+    SIDECAR_JSONL = 0,  // 每帧一行 JSON，便于脚本处理
+    SIDECAR_BINARY      // 紧凑的定长二进制记录
+};
+
+//-----------------------------------
+// 二进制检测结果文件格式（小端）
+//   文件头: magic "RKDT" | uint32 version | uint32 width | uint32 height | float fps
+//   每帧:   int32 frame | double pts_ms | uint16 count | count 个框
+//   每框:   uint16 class_id | float conf | int16 xmin | int16 ymin | int16 xmax | int16 ymax
+//           | uint16 track_id（0 表示未跟踪）| uint16 attr_id（0 表示未分类）| uint16 attr_conf（置信度 * 10000）
+// 版本 2 起每框带 track_id 与二级分类结果，与 JSONL 的 "id"、"attr"、"attr_conf" 字段一致
+//-----------------------------------
+#define SIDECAR_MAGIC   "RKDT"
+#define SIDECAR_VERSION 2
+
+#pragma pack(push, 1)
+struct SidecarHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    float fps;
+};
+
+struct SidecarFrameRecord {
+    int32_t frame;
+    double pts_ms;
+    uint16_t count;
+};
+
+struct SidecarBoxRecord {
+    uint16_t class_id;
+    float conf;
+    int16_t xmin;
+    int16_t ymin;
+    int16_t xmax;
+    int16_t ymax;
+    uint16_t track_id;
+    uint16_t attr_id;
+    uint16_t attr_conf;
+};
+#pragma pack(pop)
+
+//-----------------------------------
+// 只输出检测元数据：把每帧的 detect_result_group_t 按帧号与 PTS 写入检测结果文件，
+// 写线程不做画框与编码；需要视频时用 ffmpeg 流拷贝把原视频重新封装一份
+//-----------------------------------
+class DetectionSidecarSink : public FrameSink
+{
+public:
+    // remux_input 非空时把该输入流拷贝封装到 remux_output
+    DetectionSidecarSink(const std::string &sidecar_path, SidecarFormat format,
+                         const std::string &remux_input = "", const std::string &remux_output = "");
+    ~DetectionSidecarSink();
+
+    bool open(int width, int height, double fps);
+    void write(const FrameData &fd);
+    void close();
+
+private:
+    void write_jsonl(const FrameData &fd);
+    void write_binary(const FrameData &fd);
+    void remux_thread_func();
+
+    std::string sidecar_path;
+    SidecarFormat format;
+    std::string remux_input;
+    std::string remux_output;
+
+    FILE *fp;
+    std::thread remux_thread;
+    int remux_ret;
+    uint64_t frames_written;
+};
+
+// 检测结果文件路径：输出路径换成 .jsonl / .rkdt 扩展名
+std::string sidecar_path_for(const std::string &output_path, SidecarFormat format);
+// 流拷贝的输出路径：输出路径换成输入的扩展名，原容器一定装得下原来的码流（默认的 .avi 装不下 MP4 的数据轨）
+std::string remux_path_for(const std::string &output_path, const std::string &input_path);
+
+#endif
@@ -0,0 +1,337 @@
+#include "detection_store.h"
+
+#include <fcntl.h>
+#include <float.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <iostream>
+
+size_t store_block_bytes(uint32_t rows)
+{
+    size_t bytes = sizeof(StoreBlockHeader)
+                 + rows * (sizeof(double) + sizeof(int32_t) + sizeof(float) + sizeof(uint16_t) + 4 * sizeof(int16_t));
+    return (bytes + 7) & ~(size_t)7;
+}
+
+//-----------------------------------
+// DetectionStoreWriter
+//-----------------------------------
+DetectionStoreWriter::DetectionStoreWriter() : fp(NULL), file_offset(0), total_rows(0)
+{
+}
+
+DetectionStoreWriter::~DetectionStoreWriter()
+{
+    close();
+}
+
+bool DetectionStoreWriter::open(const std::string &path_in)
+{
+    path = path_in;
+    fp = fopen(path.c_str(), "wb");
+    if(fp == NULL)
+    {
+        std::cerr << "Fail to create detection store: " << path << "\n";
+        return false;
+    }
+    StoreFileHeader header;
+    memcpy(header.magic, STORE_FILE_MAGIC, 4);
+    header.version = STORE_VERSION;
+    header.block_rows = STORE_BLOCK_ROWS;
+    header.reserved = 0;
+    fwrite(&header, sizeof(header), 1, fp);
+    file_offset = sizeof(header);
+    pending.reserve(STORE_BLOCK_ROWS);
+    return true;
+}
+
+void DetectionStoreWriter::append(const StoreRow &row, const char *label)
+{
+    if(fp == NULL)
+    {
+        return;
+    }
+    if(label != NULL && labels.find(row.class_id) == labels.end())
+    {
+        labels[row.class_id] = label;
+    }
+    pending.push_back(row);
+    if(pending.size() >= STORE_BLOCK_ROWS)
+    {
+        flush_block();
+    }
+}
+
+void DetectionStoreWriter::flush_block()
+{
+    if(pending.empty())
+    {
+        return;
+    }
+    uint32_t rows = (uint32_t)pending.size();
+
+    StoreIndexEntry entry;
+    StoreBlockHeader &h = entry.header;
+    memset(&entry, 0, sizeof(entry));
+    memcpy(h.magic, STORE_BLOCK_MAGIC, 4);
+    h.rows = rows;
+    h.min_frame = pending.front().frame;
+    h.max_frame = pending.front().frame;
+    h.min_pts = DBL_MAX;
+    h.max_pts = -DBL_MAX;
+    h.min_conf = FLT_MAX;
+    h.max_conf = -FLT_MAX;
+
+    // 行转列
+    std::vector<uint8_t> buf(store_block_bytes(rows), 0);
+    double   *pts   = (double *)(&buf[0] + sizeof(StoreBlockHeader));
+    int32_t  *frame = (int32_t *)(pts + rows);
+    float    *conf  = (float *)(frame + rows);
+    uint16_t *cls   = (uint16_t *)(conf + rows);
+    int16_t  *xmin  = (int16_t *)(cls + rows);
+    int16_t  *ymin  = xmin + rows;
+    int16_t  *xmax  = ymin + rows;
+    int16_t  *ymax  = xmax + rows;
+    for(uint32_t i = 0; i < rows; i++)
+    {
+        const StoreRow &r = pending[i];
+        pts[i] = r.pts_ms;
+        frame[i] = r.frame;
+        conf[i] = r.conf;
+        cls[i] = r.class_id;
+        xmin[i] = r.xmin;
+        ymin[i] = r.ymin;
+        xmax[i] = r.xmax;
+        ymax[i] = r.ymax;
+
+        if(r.frame < h.min_frame) h.min_frame = r.frame;
+        if(r.frame > h.max_frame) h.max_frame = r.frame;
+        if(r.pts_ms < h.min_pts)  h.min_pts = r.pts_ms;
+        if(r.pts_ms > h.max_pts)  h.max_pts = r.pts_ms;
+        if(r.conf < h.min_conf)   h.min_conf = r.conf;
+        if(r.conf > h.max_conf)   h.max_conf = r.conf;
+        h.class_mask[(r.class_id >> 6) & 1] |= (uint64_t)1 << (r.class_id & 63);
+    }
+    memcpy(&buf[0], &h, sizeof(h));
+    fwrite(&buf[0], buf.size(), 1, fp);
+
+    entry.offset = file_offset;
+    index.push_back(entry);
+    file_offset += buf.size();
+    total_rows += rows;
+    pending.clear();
+}
+
+void DetectionStoreWriter::close()
+{
+    if(fp == NULL)
+    {
+        return;
+    }
+    flush_block();
+
+    StoreTrailer trailer;
+    memcpy(trailer.magic, STORE_END_MAGIC, 4);
+    trailer.block_count = (uint32_t)index.size();
+
+    // 标签表
+    trailer.labels_offset = file_offset;
+    uint32_t label_count = (uint32_t)labels.size();
+    fwrite(&label_count, sizeof(label_count), 1, fp);
+    file_offset += sizeof(label_count);
+    for(std::map<uint16_t, std::string>::const_iterator it = labels.begin(); it != labels.end(); ++it)
+    {
+        uint8_t len = (uint8_t)(it->second.size() > 255 ? 255 : it->second.size());
+        fwrite(&it->first, sizeof(uint16_t), 1, fp);
+        fwrite(&len, 1, 1, fp);
+        fwrite(it->second.data(), 1, len, fp);
+        file_offset += sizeof(uint16_t) + 1 + len;
+    }
+
+    // 块索引 + 文件尾
+    trailer.index_offset = file_offset;
+    if(!index.empty())
+    {
+        fwrite(&index[0], sizeof(StoreIndexEntry), index.size(), fp);
+    }
+    fwrite(&trailer, sizeof(trailer), 1, fp);
+    fclose(fp);
+    fp = NULL;
+    std::cout << "[DetectionStore] 已写出 " << total_rows << " 个检测框（" << index.size() << " 块）到 " << path << "\n";
+}
+
+//-----------------------------------
+// DetectionStoreReader
+//-----------------------------------
+DetectionStoreReader::DetectionStoreReader() : fd(-1), base(NULL), file_size(0)
+{
+}
+
+DetectionStoreReader::~DetectionStoreReader()
+{
+    close();
+}
+
+bool DetectionStoreReader::open(const std::string &path)
+{
+    fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+    {
+        std::cerr << "Fail to open detection store: " << path << "\n";
+        return false;
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(StoreFileHeader))
+    {
+        std::cerr << "Invalid detection store: " << path << "\n";
+        close();
+        return false;
+    }
+    file_size = st.st_size;
+    void *p = mmap(NULL, file_size, PROT_READ, MAP_SHARED, fd, 0);
+    if(p == MAP_FAILED)
+    {
+        std::cerr << "Fail to mmap detection store: " << path << "\n";
+        close();
+        return false;
+    }
+    base = (const uint8_t *)p;
+    // 查询基本是顺序扫描，让内核积极预读
+    madvise(p, file_size, MADV_SEQUENTIAL);
+
+    StoreFileHeader header;
+    memcpy(&header, base, sizeof(header));
+    if(memcmp(header.magic, STORE_FILE_MAGIC, 4) != 0 || header.version != STORE_VERSION)
+    {
+        std::cerr << "Unsupported detection store: " << path << "\n";
+        close();
+        return false;
+    }
+
+    if(!load_index())
+    {
+        // 没有正常关闭，顺序遍历块头恢复（标签表丢失）
+        std::cerr << "[DetectionStore] 文件尾缺失，按块头恢复: " << path << "\n";
+        return scan_blocks();
+    }
+    return true;
+}
+
+void DetectionStoreReader::close()
+{
+    if(base != NULL)
+    {
+        munmap((void *)base, file_size);
+        base = NULL;
+    }
+    if(fd >= 0)
+    {
+        ::close(fd);
+        fd = -1;
+    }
+    blocks.clear();
+    labels.clear();
+}
+
+bool DetectionStoreReader::add_block(uint64_t offset)
+{
+    if(offset + sizeof(StoreBlockHeader) > file_size)
+    {
+        return false;
+    }
+    const StoreBlockHeader *h = (const StoreBlockHeader *)(base + offset);
+    if(memcmp(h->magic, STORE_BLOCK_MAGIC, 4) != 0 || offset + store_block_bytes(h->rows) > file_size)
+    {
+        return false;
+    }
+    uint32_t rows = h->rows;
+    StoreBlockView v;
+    v.header   = h;
+    v.pts_ms   = (const double *)(base + offset + sizeof(StoreBlockHeader));
+    v.frame    = (const int32_t *)(v.pts_ms + rows);
+    v.conf     = (const float *)(v.frame + rows);
+    v.class_id = (const uint16_t *)(v.conf + rows);
+    v.xmin     = (const int16_t *)(v.class_id + rows);
+    v.ymin     = v.xmin + rows;
+    v.xmax     = v.ymin + rows;
+    v.ymax     = v.xmax + rows;
+    blocks.push_back(v);
+    return true;
+}
+
+bool DetectionStoreReader::load_index()
+{
+    if(file_size < sizeof(StoreFileHeader) + sizeof(StoreTrailer))
+    {
+        return false;
+    }
+    StoreTrailer trailer;
+    memcpy(&trailer, base + file_size - sizeof(trailer), sizeof(trailer));
+    if(memcmp(trailer.magic, STORE_END_MAGIC, 4) != 0
+       || trailer.index_offset + (uint64_t)trailer.block_count * sizeof(StoreIndexEntry) > file_size
+       || trailer.labels_offset + sizeof(uint32_t) > file_size)
+    {
+        return false;
+    }
+
+    for(uint32_t i = 0; i < trailer.block_count; i++)
+    {
+        StoreIndexEntry entry;
+        memcpy(&entry, base + trailer.index_offset + i * sizeof(StoreIndexEntry), sizeof(entry));
+        if(!add_block(entry.offset))
+        {
+            blocks.clear();
+            return false;
+        }
+    }
+
+    const uint8_t *p = base + trailer.labels_offset;
+    const uint8_t *end = base + trailer.index_offset;
+    uint32_t count;
+    memcpy(&count, p, sizeof(count));
+    p += sizeof(count);
+    for(uint32_t i = 0; i < count && p + 3 <= end; i++)
+    {
+        uint16_t id;
+        memcpy(&id, p, sizeof(id));
+        uint8_t len = p[2];
+        p += 3;
+        if(p + len > end)
+        {
+            break;
+        }
+        labels[id] = std::string((const char *)p, len);
+        p += len;
+    }
+    return true;
+}
+
+bool DetectionStoreReader::scan_blocks()
+{
+    uint64_t offset = sizeof(StoreFileHeader);
+    while(add_block(offset))
+    {
+        offset += store_block_bytes(blocks.back().header->rows);
+    }
+    return true;
+}
+
+int DetectionStoreReader::class_id_of(const std::string &label) const
+{
+    for(std::map<uint16_t, std::string>::const_iterator it = labels.begin(); it != labels.end(); ++it)
+    {
+        if(it->second == label)
+        {
+            return it->first;
+        }
+    }
+    return -1;
+}
+
+std::string DetectionStoreReader::label_of(int class_id) const
+{
+    std::map<uint16_t, std::string>::const_iterator it = labels.find((uint16_t)class_id);
+    return it != labels.end() ? it->second : std::to_string(class_id);
+}
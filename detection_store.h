@@ -0,0 +1,153 @@
+#ifndef DETECTION_STORE_H
+#define DETECTION_STORE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <map>
+#include <string>
+#include <vector>
+
+//-----------------------------------
+// 列式检测结果库（小端，可直接 mmap 扫描）
+//   文件头  StoreFileHeader
+//   数据块  StoreBlockHeader + 各列连续存放：
+//           pts_ms  double[rows] | frame int32[rows] | conf float[rows] |
+//           class_id uint16[rows] | xmin/ymin/xmax/ymax int16[rows] 各一列，块尾补齐到 8 字节
+//   标签表  uint32 数量 + 每项 { uint16 class_id | uint8 长度 | 名字 }
+//   块索引  StoreIndexEntry[block_count]（块头的副本 + 块偏移）
+//   文件尾  StoreTrailer
+// 每个块头带 帧号/时间戳/置信度 的 min/max 与类别位图，查询时整块跳过不相关的数据；
+// 文件尾缺失（进程异常退出）时可顺序遍历块头恢复。
+// 本文件不依赖 OpenCV，查询工具可单独编译。
+//-----------------------------------
+#define STORE_FILE_MAGIC  "RKDS"
+#define STORE_BLOCK_MAGIC "RKDB"
+#define STORE_END_MAGIC   "RKDE"
+#define STORE_VERSION     1
+#define STORE_BLOCK_ROWS  8192  // 每块最多的检测框数
+
+#pragma pack(push, 1)
+struct StoreFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t block_rows;
+    uint32_t reserved;
+};
+
+struct StoreBlockHeader {
+    char magic[4];
+    uint32_t rows;
+    int32_t min_frame;
+    int32_t max_frame;
+    double min_pts;
+    double max_pts;
+    float min_conf;
+    float max_conf;
+    uint64_t class_mask[2];  // 第 (class_id & 127) 位表示块内出现过该类别
+};
+
+struct StoreIndexEntry {
+    uint64_t offset;  // 块头在文件中的偏移
+    StoreBlockHeader header;
+};
+
+struct StoreTrailer {
+    uint64_t index_offset;
+    uint64_t labels_offset;
+    uint32_t block_count;
+    char magic[4];
+};
+#pragma pack(pop)
+
+// 一个检测框
+struct StoreRow {
+    int32_t frame;
+    double pts_ms;
+    uint16_t class_id;
+    float conf;
+    int16_t xmin, ymin, xmax, ymax;
+};
+
+// 块内各列在文件中的字节数
+size_t store_block_bytes(uint32_t rows);
+
+inline bool store_block_has_class(const StoreBlockHeader &h, int class_id)
+{
+    return (h.class_mask[(class_id >> 6) & 1] >> (class_id & 63)) & 1;
+}
+
+//-----------------------------------
+// 追加写：按帧序追加检测框，攒满一块写一次；close 时写标签表、块索引和文件尾
+//-----------------------------------
+class DetectionStoreWriter
+{
+public:
+    DetectionStoreWriter();
+    ~DetectionStoreWriter();
+
+    bool open(const std::string &path);
+    // 追加一个检测框，label 非空时记入标签表
+    void append(const StoreRow &row, const char *label = NULL);
+    void close();
+
+    uint64_t rows_written() const { return total_rows; }
+
+private:
+    void flush_block();
+
+    FILE *fp;
+    std::string path;
+    uint64_t file_offset;
+    uint64_t total_rows;
+
+    std::vector<StoreRow> pending;          // 当前块
+    std::vector<StoreIndexEntry> index;     // 已写出的块
+    std::map<uint16_t, std::string> labels; // 类别编号 -> 名字
+};
+
+//-----------------------------------
+// 只读访问：mmap 整个文件，按块头的 min/max 与类别位图跳过无关块，
+// 列直接指向映射内存，不拷贝、不整体读入
+//-----------------------------------
+struct StoreBlockView {
+    const StoreBlockHeader *header;
+    const double *pts_ms;
+    const int32_t *frame;
+    const float *conf;
+    const uint16_t *class_id;
+    const int16_t *xmin;
+    const int16_t *ymin;
+    const int16_t *xmax;
+    const int16_t *ymax;
+};
+
+class DetectionStoreReader
+{
+public:
+    DetectionStoreReader();
+    ~DetectionStoreReader();
+
+    bool open(const std::string &path);
+    void close();
+
+    size_t block_count() const { return blocks.size(); }
+    const StoreBlockView &block(size_t i) const { return blocks[i]; }
+
+    // 按名字查类别编号，找不到返回 -1
+    int class_id_of(const std::string &label) const;
+    std::string label_of(int class_id) const;
+
+private:
+    bool load_index();
+    bool scan_blocks();
+    bool add_block(uint64_t offset);
+
+    int fd;
+    const uint8_t *base;
+    size_t file_size;
+    std::vector<StoreBlockView> blocks;
+    std::map<uint16_t, std::string> labels;
+};
+
+#endif
@@ -0,0 +1,162 @@
+#ifndef FAIR_QUEUE_H
+#define FAIR_QUEUE_H
+
+#include <deque>
+#include <map>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+// 多优先级 + 多提交者的加权公平队列
+//  - 不同优先级之间按权重做 stride 调度：权重越大被选中越频繁，但低优先级不会被饿死
+//  - 同一优先级内按提交者（stream_id）轮转，一个提交者的积压不会挤占其他提交者
+// 注意：本类自身不加锁，由使用者（如 ThreadPoll 的 queue_mutex）负责互斥
+template<typename T>
+class FairQueue
+{
+public:
+    explicit FairQueue(int num_classes = 1) : lanes(num_classes > 0 ? num_classes : 1), total(0), vtime(0) {}
+
+    int num_classes() const { return (int)lanes.size(); }
+
+    // 设置某个优先级的权重（>=1）
+    void set_weight(int cls, unsigned weight)
+    {
+        Lane &lane = lane_of(cls);
+        lane.weight = weight > 0 ? weight : 1;
+    }
+
+    void push(int cls, int stream_id, T &&item)
+    {
+        Lane &lane = lane_of(cls);
+        if(lane.count == 0)
+        {
+            // 空闲后重新变为活跃的优先级从当前虚拟时间开始，不能攒积分插队
+            if(lane.pass < vtime) lane.pass = vtime;
+        }
+        std::deque<T> &q = lane.streams[stream_id];
+        if(q.empty())
+        {
+            lane.rr.push_back(stream_id);
+        }
+        q.push_back(std::move(item));
+        lane.count++;
+        total++;
+    }
+
+    // 按加权公平顺序取出一个元素，队列为空返回 false
+    bool pop(T &out)
+    {
+        int cls = pick_lane();
+        if(cls < 0)
+        {
+            return false;
+        }
+        Lane &lane = lanes[cls];
+        vtime = lane.pass;
+        lane.pass += STRIDE / lane.weight;
+        take_front(lane, lane.rr.front(), out);
+        return true;
+    }
+
+    // 过载时丢弃：从最低优先级的非空 lane 中积压最深的提交者处取出最旧的元素
+    bool pop_oldest(T &out)
+    {
+        for(int cls = (int)lanes.size() - 1; cls >= 0; cls--)
+        {
+            Lane &lane = lanes[cls];
+            if(lane.count == 0)
+            {
+                continue;
+            }
+            int victim = lane.rr.front();
+            size_t deepest = 0;
+            for(typename std::map<int, std::deque<T> >::iterator it = lane.streams.begin(); it != lane.streams.end(); ++it)
+            {
+                if(it->second.size() > deepest)
+                {
+                    deepest = it->second.size();
+                    victim = it->first;
+                }
+            }
+            take_front(lane, victim, out);
+            return true;
+        }
+        return false;
+    }
+
+    size_t size() const { return total; }
+    bool empty() const { return total == 0; }
+    size_t size_of(int cls) const { return lanes[clamp_class(cls)].count; }
+
+private:
+    static const uint64_t STRIDE = 1 << 20;
+
+    struct Lane
+    {
+        unsigned weight;
+        uint64_t pass;                          // stride 调度的通行值，越小越先被选中
+        size_t count;
+        std::map<int, std::deque<T> > streams;  // stream_id -> 该提交者的任务
+        std::deque<int> rr;                     // 有积压的提交者轮转顺序
+
+        Lane() : weight(1), pass(0), count(0) {}
+    };
+
+    int clamp_class(int cls) const
+    {
+        if(cls < 0) return 0;
+        if(cls >= (int)lanes.size()) return (int)lanes.size() - 1;
+        return cls;
+    }
+
+    Lane &lane_of(int cls) { return lanes[clamp_class(cls)]; }
+
+    // 非空 lane 中通行值最小的；相同时优先级高（编号小）的优先
+    int pick_lane() const
+    {
+        int best = -1;
+        for(int cls = 0; cls < (int)lanes.size(); cls++)
+        {
+            if(lanes[cls].count == 0) continue;
+            if(best < 0 || lanes[cls].pass < lanes[best].pass)
+            {
+                best = cls;
+            }
+        }
+        return best;
+    }
+
+    void take_front(Lane &lane, int stream_id, T &out)
+    {
+        std::deque<T> &q = lane.streams[stream_id];
+        out = std::move(q.front());
+        q.pop_front();
+        lane.count--;
+        total--;
+
+        // 从轮转表中摘下该提交者；还有积压就排到队尾
+        for(std::deque<int>::iterator it = lane.rr.begin(); it != lane.rr.end(); ++it)
+        {
+            if(*it == stream_id)
+            {
+                lane.rr.erase(it);
+                break;
+            }
+        }
+        if(!q.empty())
+        {
+            lane.rr.push_back(stream_id);
+        }
+        else
+        {
+            lane.streams.erase(stream_id);
+        }
+    }
+
+    std::vector<Lane> lanes;
+    size_t total;
+    uint64_t vtime;  // 最近一次被选中 lane 的通行值，作为虚拟时间
+};
+
+#endif
@@ -0,0 +1,42 @@
+// frame_cache.cpp
+// 原始帧缓存工具：把视频解码一次存成可 mmap 的 .rkframes 文件，压测时用 --input xxx.rkframes 按内存速度重放
+#include <iostream>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#include "raw_frame_cache.h"
+
+static void print_usage(const char *prog)
+{
+    std::cout << "用法:\n"
+              << "  " << prog << " build <输入视频> <输出.rkframes> [最多帧数]   解码并生成缓存（1080p 每帧约 6 MB）\n"
+              << "  " << prog << " info <文件.rkframes>                          查看缓存信息\n";
+}
+
+int main(int argc, char **argv)
+{
+    if(argc >= 4 && strcmp(argv[1], "build") == 0)
+    {
+        std::string out = argv[3];
+        if(!is_raw_frame_cache_path(out))
+        {
+            std::cerr << "输出文件扩展名应为 .rkframes: " << out << "\n";
+            return -1;
+        }
+        int max_frames = argc >= 5 ? atoi(argv[4]) : 0;
+        int n = build_raw_frame_cache(argv[2], out, max_frames);
+        if(n < 0)
+        {
+            return -1;
+        }
+        std::cout << "写入 " << n << " 帧" << std::endl;
+        return print_raw_frame_cache_info(out) ? 0 : -1;
+    }
+    if(argc >= 3 && strcmp(argv[1], "info") == 0)
+    {
+        return print_raw_frame_cache_info(argv[2]) ? 0 : -1;
+    }
+    print_usage(argv[0]);
+    return -1;
+}
@@ -0,0 +1,33 @@
+#include "frame_sink.h"
+
+#include <iostream>
+
+VideoFileSink::VideoFileSink(const std::string &path_in) : path(path_in)
+{
+}
+
+bool VideoFileSink::open(int width, int height, double fps)
+{
+    int fourcc = cv::VideoWriter::fourcc('H','2','6','4');
+
+    // 打开输出视频
+    if(!writer.open(path, fourcc, fps, cv::Size(width, height)))
+    {
+        std::cerr << "Fail to create output video: " << path << "\n";
+        return false;
+    }
+    return true;
+}
+
+void VideoFileSink::write(const FrameData &fd)
+{
+    if(!fd.frame.empty())
+    {
+        writer.write(fd.frame);
+    }
+}
+
+void VideoFileSink::close()
+{
+    writer.release();
+}
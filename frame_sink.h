@@ -0,0 +1,60 @@
+#ifndef FRAME_SINK_H
+#define FRAME_SINK_H
+
+#include <string>
+#include <opencv2/opencv.hpp>
+
+#include "frame_source.h"
+
+//-----------------------------------
+// 帧输出接口：写线程按帧序把处理结果交给它
+//-----------------------------------
+class FrameSink
+{
+public:
+    virtual ~FrameSink() {}
+
+    // 按输入视频的尺寸与帧率打开输出，成功返回 true
+    virtual bool open(int width, int height, double fps) = 0;
+    virtual void write(const FrameData &fd) = 0;
+    virtual void close() = 0;
+};
+
+//-----------------------------------
+// 基于 cv::VideoWriter 的视频文件输出
+//-----------------------------------
+class VideoFileSink : public FrameSink
+{
+public:
+    explicit VideoFileSink(const std::string &path);
+
+    bool open(int width, int height, double fps);
+    void write(const FrameData &fd);
+    void close();
+
+private:
+    std::string path;
+    cv::VideoWriter writer;
+};
+
+//-----------------------------------
+// 丢弃所有帧，只计数；压测时排除编码与磁盘的影响
+//-----------------------------------
+class NullFrameSink : public FrameSink
+{
+public:
+    NullFrameSink() : frames(0), detections(0) {}
+
+    bool open(int width, int height, double fps) { (void)width; (void)height; (void)fps; return true; }
+    void write(const FrameData &fd) { frames++; detections += fd.detections.size(); }
+    void close() {}
+
+    uint64_t frames_written() const { return frames; }
+    uint64_t detections_written() const { return detections; }
+
+private:
+    uint64_t frames;       // 只由写线程访问
+    uint64_t detections;
+};
+
+#endif
@@ -0,0 +1,127 @@
+#include "frame_source.h"
+
+#include <algorithm>
+#include <iostream>
+#include <thread>
+
+VideoFileSource::VideoFileSource(const std::string &path_in, bool pace)
+    : path(path_in), pace_realtime(pace), frame_width(0), frame_height(0), frame_fps(25.0), pts_ms(-1.0)
+{
+}
+
+bool VideoFileSource::open()
+{
+    if(!cap.open(path))
+    {
+        std::cerr << "Fail to open input video: " << path << "\n";
+        return false;
+    }
+
+    // 获取视频属性
+    frame_width  = static_cast<int>(cap.get(cv::CAP_PROP_FRAME_WIDTH));
+    frame_height = static_cast<int>(cap.get(cv::CAP_PROP_FRAME_HEIGHT));
+    frame_fps    = cap.get(cv::CAP_PROP_FPS);
+    if(frame_fps < 1.0)  // 避免某些视频元数据不完整
+        frame_fps = 25.0;
+
+    next_frame_time = std::chrono::steady_clock::now();
+    return true;
+}
+
+bool VideoFileSource::read(cv::Mat &frame)
+{
+    if(pace_realtime)
+    {
+        // 模拟摄像头：按帧率等待下一帧的到达时刻
+        std::this_thread::sleep_until(next_frame_time);
+        next_frame_time += std::chrono::microseconds(static_cast<int64_t>(1e6 / frame_fps));
+    }
+    if(!cap.read(frame))
+    {
+        return false;
+    }
+    pts_ms = cap.get(cv::CAP_PROP_POS_MSEC);
+    return true;
+}
+
+//-----------------------------------
+// 合成帧
+//-----------------------------------
+SyntheticFrameSource::SyntheticFrameSource(int width, int height, double fps, int objects_in, int total, bool pace)
+    : frame_width(width), frame_height(height), frame_fps(fps >= 1.0 ? fps : 25.0), objects(objects_in),
+      total_frames(total), pace_realtime(pace), next_index(0), pts_ms(-1.0)
+{
+}
+
+bool SyntheticFrameSource::open()
+{
+    if(frame_width <= 0 || frame_height <= 0)
+    {
+        std::cerr << "Invalid synthetic frame size: " << frame_width << "x" << frame_height << "\n";
+        return false;
+    }
+    // 背景只生成一次，每帧拷贝后再画色块
+    background = cv::Mat(frame_height, frame_width, CV_8UC3);
+    for(int r = 0; r < frame_height; r++)
+    {
+        uchar *p = background.ptr<uchar>(r);
+        for(int x = 0; x < frame_width; x++)
+        {
+            p[3 * x + 0] = (uchar)(x * 255 / frame_width);
+            p[3 * x + 1] = (uchar)(r * 255 / frame_height);
+            p[3 * x + 2] = 96;
+        }
+    }
+    next_index = 0;
+    next_frame_time = std::chrono::steady_clock::now();
+    return true;
+}
+
+bool SyntheticFrameSource::read(cv::Mat &frame)
+{
+    if(total_frames > 0 && next_index >= total_frames)
+    {
+        return false;
+    }
+    if(pace_realtime)
+    {
+        std::this_thread::sleep_until(next_frame_time);
+        next_frame_time += std::chrono::microseconds(static_cast<int64_t>(1e6 / frame_fps));
+    }
+
+    frame = background.clone();
+    int box_w = std::max(frame_width / 12, 8), box_h = std::max(frame_height / 8, 8);
+    int range_x = std::max(frame_width - box_w, 1), range_y = std::max(frame_height - box_h, 1);
+    for(int i = 0; i < objects; i++)
+    {
+        // 每个色块的起点与速度由编号决定，位置按三角波往返，结果可复现
+        int px = (i * 997 + next_index * (3 + i % 5)) % (2 * range_x);
+        int py = (i * 571 + next_index * (2 + i % 3)) % (2 * range_y);
+        int x = px < range_x ? px : 2 * range_x - px;
+        int y = py < range_y ? py : 2 * range_y - py;
+        cv::rectangle(frame, cv::Rect(x, y, box_w, box_h),
+                      cv::Scalar((i * 67) % 256, (i * 131) % 256, 255 - (i * 29) % 256), cv::FILLED);
+    }
+    pts_ms = next_index * 1000.0 / frame_fps;
+    next_index++;
+    return true;
+}
+
+std::string shell_quote(const std::string &s)
+{
+    // 单引号内除 ' 外没有特殊字符：" $ ` 空格都原样传给程序
+    std::string out = "'";
+    for(size_t i = 0; i < s.size(); i++)
+    {
+        if(s[i] == '\'')
+        {
+            out += "'\\''";
+        }
+        else
+        {
+            out += s[i];
+        }
+    }
+    out += "'";
+    return out;
+}
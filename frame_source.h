@@ -0,0 +1,113 @@
+#ifndef FRAME_SOURCE_H
+#define FRAME_SOURCE_H
+
+#include <chrono>
+#include <string>
+#include <opencv2/opencv.hpp>
+
+#include "post_process.h"
+#include "stage_timing.h"
+
+//-----------------------------------
+// 流水线中传递的帧
+//-----------------------------------
+struct FrameData {
+    cv::Mat frame;
+    int index;
+    std::chrono::steady_clock::time_point capture_time;  // 读取时刻，用于计算帧龄和端到端延迟
+    double pts_ms;                       // 帧在原视频中的时间戳（毫秒）
+    detect_result_group_t detections;    // 检测结果，聚合线程按序填入
+    FrameTimestamps timestamps;          // 各阶段时间戳，写出后汇总到各阶段延迟直方图
+};
+
+//-----------------------------------
+// 帧来源接口：视频文件、摄像头、RTSP 等都通过它接入流水线
+//-----------------------------------
+class FrameSource
+{
+public:
+    virtual ~FrameSource() {}
+
+    // 打开来源，成功返回 true
+    virtual bool open() = 0;
+    // 读取下一帧，到末尾或出错返回 false
+    virtual bool read(cv::Mat &frame) = 0;
+    // 最近一次 read 得到的帧的时间戳（毫秒），未知时返回负数
+    virtual double last_pts_ms() const { return -1.0; }
+    // read 返回的帧在之后的 read 中是否保持不变；为 true 时读线程不再深拷贝
+    //（VideoCapture 会复用解码缓冲，所以默认要拷贝）；持久的帧可以是只读的，开启画框时读线程照样拷贝
+    virtual bool frames_persistent() const { return false; }
+
+    virtual int width() const = 0;
+    virtual int height() const = 0;
+    virtual double fps() const = 0;
+    virtual std::string name() const = 0;
+};
+
+//-----------------------------------
+// 基于 cv::VideoCapture 的来源
+//   pace_realtime=true 时按视频自身帧率放帧，用本地文件模拟实时摄像头
+//-----------------------------------
+class VideoFileSource : public FrameSource
+{
+public:
+    explicit VideoFileSource(const std::string &path, bool pace_realtime = false);
+
+    bool open();
+    bool read(cv::Mat &frame);
+    double last_pts_ms() const { return pts_ms; }
+
+    int width() const { return frame_width; }
+    int height() const { return frame_height; }
+    double fps() const { return frame_fps; }
+    std::string name() const { return path; }
+
+private:
+    std::string path;
+    bool pace_realtime;
+    cv::VideoCapture cap;
+
+    int frame_width;
+    int frame_height;
+    double frame_fps;
+    double pts_ms;
+
+    std::chrono::steady_clock::time_point next_frame_time;
+};
+
+//-----------------------------------
+// 内存中生成的合成帧：渐变背景上有若干匀速移动、碰边反弹的色块，用于压测时排除解码的影响
+//   pace_realtime=true 时按 fps 放帧，否则尽快产出；读满 total_frames 帧后返回 false
+//-----------------------------------
+class SyntheticFrameSource : public FrameSource
+{
+public:
+    SyntheticFrameSource(int width, int height, double fps, int objects, int total_frames, bool pace_realtime);
+
+    bool open();
+    bool read(cv::Mat &frame);
+    double last_pts_ms() const { return pts_ms; }
+
+    int width() const { return frame_width; }
+    int height() const { return frame_height; }
+    double fps() const { return frame_fps; }
+    std::string name() const { return "synthetic"; }
+
+private:
+    int frame_width;
+    int frame_height;
+    double frame_fps;
+    int objects;
+    int total_frames;
+    bool pace_realtime;
+
+    int next_index;
+    double pts_ms;
+    cv::Mat background;
+    std::chrono::steady_clock::time_point next_frame_time;
+};
+
+// 把路径转成 shell 单引号参数（内部的 ' 转义），用 popen/system 调 ffmpeg、ffprobe 时拼命令行用
+std::string shell_quote(const std::string &s);
+
+#endif
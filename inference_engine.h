@@ -0,0 +1,36 @@
+#ifndef INFERENCE_ENGINE_H
+#define INFERENCE_ENGINE_H
+
+#include <opencv2/core.hpp>
+
+#include "post_process.h"
+#include "roi.h"
+#include "stage_timing.h"
+
+//-----------------------------------
+// 推理引擎接口：线程池每个 worker 持有一个实例（不要求线程安全）
+//   真实实现是 Yolov5s（RKNN + RGA），压测时可换成固定延迟的模拟引擎
+//-----------------------------------
+class InferenceEngine
+{
+public:
+    virtual ~InferenceEngine() {}
+
+    // 只对原图中 region 区域推理，结果坐标映射回原图；语义见 Yolov5s::inference_region
+    virtual int inference_region(const cv::Mat &origin_img, const cv::Rect &region, detect_result_group_t &result_group,
+                                 const RoiMask *roi = NULL, FrameTimestamps *timestamps = NULL) = 0;
+
+    // 模型输入尺寸（切块推理按它决定块大小）
+    virtual int input_width() const = 0;
+    virtual int input_height() const = 0;
+
+    // 调试转储：保留下一次推理的模型输入；不支持的引擎返回空图
+    virtual void set_keep_input(bool keep) { (void)keep; }
+    virtual const cv::Mat &last_input() const
+    {
+        static const cv::Mat empty;
+        return empty;
+    }
+};
+
+#endif
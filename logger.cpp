@@ -0,0 +1,252 @@
+#include "logger.h"
+#include "cpu_affinity.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <strings.h>
+#include <thread>
+#include <vector>
+
+#define LOG_RING_SLOTS 512   // 每个线程缓冲的日志条数
+#define LOG_MSG_BYTES  232   // 单条日志最长字节数，超出截断
+#define LOG_DRAIN_MS   20    // 后台线程取日志的间隔
+
+struct LogRecord {
+    int64_t ts_us;
+    int level;
+    char msg[LOG_MSG_BYTES];
+};
+
+// 单生产者（所属线程）单消费者（后台线程）环形缓冲：head 只由生产者推进，tail 只由消费者推进
+struct LogRing {
+    char thread_name[32];
+    LogRecord slots[LOG_RING_SLOTS];
+    std::atomic<uint64_t> head;
+    std::atomic<uint64_t> tail;
+    std::atomic<uint64_t> dropped;
+
+    LogRing() : head(0), tail(0), dropped(0) { thread_name[0] = '\0'; }
+};
+
+struct DrainedRecord {
+    int64_t ts_us;
+    int level;
+    const char *thread_name;
+    std::string msg;
+};
+
+static std::atomic<int> g_level(LOG_LEVEL_INFO);
+static std::atomic<bool> g_running(false);
+static std::mutex g_mutex;                 // 保护 g_rings 与后台线程的启停
+static std::condition_variable g_cv;
+static std::vector<LogRing *> g_rings;     // 线程退出后缓冲保留，后台线程仍能取完
+static std::thread g_drain_thread;
+static thread_local LogRing *t_ring = NULL;
+
+static int64_t log_now_us()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static const int64_t g_epoch_us = log_now_us();
+
+static const char *level_name(int level)
+{
+    static const char *names[] = {"DEBUG", "INFO ", "WARN ", "ERROR"};
+    return (level >= 0 && level < LOG_LEVEL_OFF) ? names[level] : "?    ";
+}
+
+void log_set_level(LogLevel level)
+{
+    g_level = level;
+}
+
+LogLevel log_level()
+{
+    return (LogLevel)g_level.load(std::memory_order_relaxed);
+}
+
+bool log_enabled(LogLevel level)
+{
+    return level >= g_level.load(std::memory_order_relaxed);
+}
+
+bool log_parse_level(const char *name, LogLevel &level)
+{
+    static const char *names[] = {"debug", "info", "warn", "error", "off"};
+    for(int i = 0; i <= LOG_LEVEL_OFF; i++)
+    {
+        if(strcasecmp(name, names[i]) == 0)
+        {
+            level = (LogLevel)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool log_rate_allow(int64_t &last_us, int interval_ms)
+{
+    int64_t now = log_now_us();
+    if(last_us != 0 && now - last_us < (int64_t)interval_ms * 1000)
+    {
+        return false;
+    }
+    last_us = now;
+    return true;
+}
+
+static LogRing *local_ring()
+{
+    if(t_ring == NULL)
+    {
+        LogRing *ring = new LogRing();
+        std::unique_lock<std::mutex> lock(g_mutex);
+        snprintf(ring->thread_name, sizeof(ring->thread_name), "T%d", (int)g_rings.size());
+        g_rings.push_back(ring);
+        t_ring = ring;
+    }
+    return t_ring;
+}
+
+void log_set_thread_name(const char *name)
+{
+    LogRing *ring = local_ring();
+    std::unique_lock<std::mutex> lock(g_mutex);
+    snprintf(ring->thread_name, sizeof(ring->thread_name), "%s", name);
+}
+
+static void print_line(int64_t ts_us, int level, const char *thread_name, const char *msg)
+{
+    fprintf(stderr, "[%10.3f][%s][%s] %s\n", (ts_us - g_epoch_us) / 1e6, level_name(level), thread_name, msg);
+}
+
+void log_write(LogLevel level, const char *fmt, ...)
+{
+    int64_t ts = log_now_us();
+    if(!g_running.load(std::memory_order_acquire))
+    {
+        // 后台线程未启动（启动前或退出后）：同步写
+        char msg[LOG_MSG_BYTES];
+        va_list ap;
+        va_start(ap, fmt);
+        vsnprintf(msg, sizeof(msg), fmt, ap);
+        va_end(ap);
+        print_line(ts, level, t_ring != NULL ? t_ring->thread_name : "-", msg);
+        return;
+    }
+
+    LogRing *ring = local_ring();
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+    if(head - ring->tail.load(std::memory_order_acquire) >= LOG_RING_SLOTS)
+    {
+        ring->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    LogRecord &rec = ring->slots[head % LOG_RING_SLOTS];
+    rec.ts_us = ts;
+    rec.level = level;
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(rec.msg, sizeof(rec.msg), fmt, ap);
+    va_end(ap);
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+// 取出所有缓冲中的日志，按时间排序后写出；调用方持有 g_mutex
+static void drain_locked()
+{
+    std::vector<DrainedRecord> batch;
+    for(size_t i = 0; i < g_rings.size(); i++)
+    {
+        LogRing *ring = g_rings[i];
+        uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+        for(; tail < head; tail++)
+        {
+            const LogRecord &rec = ring->slots[tail % LOG_RING_SLOTS];
+            DrainedRecord d;
+            d.ts_us = rec.ts_us;
+            d.level = rec.level;
+            d.thread_name = ring->thread_name;
+            d.msg = rec.msg;
+            batch.push_back(d);
+        }
+        ring->tail.store(tail, std::memory_order_release);
+    }
+    std::stable_sort(batch.begin(), batch.end(),
+                     [](const DrainedRecord &a, const DrainedRecord &b) { return a.ts_us < b.ts_us; });
+    for(size_t i = 0; i < batch.size(); i++)
+    {
+        print_line(batch[i].ts_us, batch[i].level, batch[i].thread_name, batch[i].msg.c_str());
+    }
+    if(!batch.empty())
+    {
+        fflush(stderr);
+    }
+}
+
+static void drain_loop()
+{
+    pin_current_thread(THREAD_ROLE_LOG);
+    std::unique_lock<std::mutex> lock(g_mutex);
+    while(g_running)
+    {
+        g_cv.wait_for(lock, std::chrono::milliseconds(LOG_DRAIN_MS));
+        drain_locked();
+    }
+}
+
+void log_start()
+{
+    std::unique_lock<std::mutex> lock(g_mutex);
+    if(g_running)
+    {
+        return;
+    }
+    g_running = true;
+    g_drain_thread = std::thread(drain_loop);
+    // main 中途 return 时也要收尾：否则后台线程未 join 就析构会直接终止进程，缓冲中的日志也会丢失
+    static bool registered = false;
+    if(!registered)
+    {
+        registered = true;
+        atexit(log_stop);
+    }
+}
+
+void log_stop()
+{
+    {
+        std::unique_lock<std::mutex> lock(g_mutex);
+        if(!g_running)
+        {
+            return;
+        }
+        g_running = false;
+        g_cv.notify_all();
+    }
+    g_drain_thread.join();
+
+    // 停止后仍可能有线程刚写进缓冲的日志，最后取一次
+    std::unique_lock<std::mutex> lock(g_mutex);
+    drain_locked();
+    uint64_t dropped = 0;
+    for(size_t i = 0; i < g_rings.size(); i++)
+    {
+        dropped += g_rings[i]->dropped.load(std::memory_order_relaxed);
+    }
+    if(dropped > 0)
+    {
+        fprintf(stderr, "[Logger] 缓冲已满丢弃 %llu 条日志\n", (unsigned long long)dropped);
+    }
+}
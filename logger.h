@@ -0,0 +1,71 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <stdint.h>
+
+//-----------------------------------
+// 异步分级日志
+//   每个线程一块定长环形缓冲，调用线程只做一次 vsnprintf 写入自己的缓冲（无锁），
+//   由后台线程定期取出、按时间排序后写到 stderr；缓冲写满时丢弃并计数。
+//   级别分两层：编译期 LOG_COMPILE_LEVEL 以下的调用整个被编译掉；
+//   运行期 log_set_level 以下的调用只多一次原子读，参数表达式（如队列 size()）不会被求值
+//-----------------------------------
+
+enum LogLevel {
+    LOG_LEVEL_DEBUG = 0,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_WARN,
+    LOG_LEVEL_ERROR,
+    LOG_LEVEL_OFF
+};
+
+// 编译期最低级别，例如 -DLOG_COMPILE_LEVEL=1 去掉全部 DEBUG 日志
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL LOG_LEVEL_DEBUG
+#endif
+
+void log_set_level(LogLevel level);
+LogLevel log_level();
+bool log_enabled(LogLevel level);
+// 解析 "debug" / "info" / "warn" / "error" / "off"，失败返回 false
+bool log_parse_level(const char *name, LogLevel &level);
+
+// 启动后台写日志线程；未启动时日志直接同步写 stderr
+void log_start();
+// 写完所有缓冲中的日志并停止后台线程
+void log_stop();
+// 给当前线程起名，显示在日志行里
+void log_set_thread_name(const char *name);
+
+void log_write(LogLevel level, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+// 同一调用点在同一线程里 interval_ms 内只放行一次
+bool log_rate_allow(int64_t &last_us, int interval_ms);
+
+#define LOG_AT(level, ...)                                                      \
+    do {                                                                        \
+        if((level) >= LOG_COMPILE_LEVEL && log_enabled(level))                  \
+        {                                                                       \
+            log_write(level, __VA_ARGS__);                                      \
+        }                                                                       \
+    } while(0)
+
+#define LOG_DEBUG(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define LOG_INFO(...)  LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_WARN(...)  LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+
+// 限频的 DEBUG 日志：热路径上每帧调用，每个线程每 interval_ms 最多输出一条
+#define LOG_DEBUG_EVERY_MS(interval_ms, ...)                                    \
+    do {                                                                        \
+        if(LOG_LEVEL_DEBUG >= LOG_COMPILE_LEVEL && log_enabled(LOG_LEVEL_DEBUG))\
+        {                                                                       \
+            static thread_local int64_t log_last_us_ = 0;                       \
+            if(log_rate_allow(log_last_us_, interval_ms))                       \
+            {                                                                   \
+                log_write(LOG_LEVEL_DEBUG, __VA_ARGS__);                        \
+            }                                                                   \
+        }                                                                       \
+    } while(0)
+
+#endif
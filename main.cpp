@@ -5,215 +5,264 @@
 #include <iostream>
 #include <string>
 #include <chrono>
-#include <mutex>
-#include <condition_variable>
-#include <queue>
-#include <chrono>
-#include <future>
-#include <map>
+#include <memory>
+#include <vector>
 
-#include "SafeQueue.h"
 #include "yolov5s.h"
 #include "thread_poll.h"
+#include "pipeline_config.h"
+#include "frame_source.h"
+#include "frame_sink.h"
+#include "stream_pipeline.h"
+#include "segment_reader.h"
+#include "segment_writer.h"
+#include "detection_sink.h"
+#include "detection_store.h"
+#include "similarity_engine.h"
+#include "cascade.h"
+#include "trace.h"
+#include "logger.h"
+#include "npu_profiler.h"
+#include "debug_dump.h"
+#include "raw_frame_cache.h"
+#include "autotune.h"
+#include "cpu_affinity.h"
 
 //-----------------------------------
-// 1) 定义一个存放帧和下标的结构
+// main 函数：每路输入一个 StreamPipeline（读/聚合/写线程），所有流共享一个 NPU 线程池
 //-----------------------------------
-struct FrameData {
-    cv::Mat frame;
-    int index;
-};
+int main(int argc, char **argv)
+{
+    PipelineConfig config;
+    if(parse_pipeline_args(argc, argv, config) != 0)
+    {
+        return -1;
+    }
 
-// 全局队列 & 全局标志
-SafeQueue<FrameData> g_readQueue(100);
-SafeQueue<FrameData> g_writeQueue(100);
-std::atomic<bool> g_readFinish(false);
-std::atomic<bool> g_processFinish(false);
+    if(config.bench_decode)
+    {
+        // 只测解码：单读线程 vs 分段并行解码
+        int readers = config.offline_readers > 1 ? config.offline_readers : 3;
+        benchmark_segment_decode(config.streams[0].path, readers, config.segment_frames);
+        return 0;
+    }
+    if(config.bench_similarity)
+    {
+        // 只测跨摄像头重识别用的特征相似度矩阵：CPU 与 NPU matmul 的分界点
+        benchmark_similarity_crossover(config.similarity_dim, 20);
+        return 0;
+    }
 
-//-----------------------------------
-// 2) 读线程：不断从视频文件读取放入 g_readQueue
-//-----------------------------------
-void readThreadFunc(cv::VideoCapture &cap) {
-    int idx = 0;
-    while(true)
+    auto start = std::chrono::high_resolution_clock::now();
+    set_overlay_backend(config.overlay);
+    // 绑核要在启动任何线程（包括日志线程）之前设置；描述有误时只是不绑，照常运行
+    set_cpu_placement(config.cpu_placement);
+    log_set_level(config.log_level);
+    log_set_thread_name("main");
+    log_start();
+    if(config.autotune)
     {
-        cv::Mat frame;
-        if(!cap.read(frame))
+        // 自动调参：用真实输入和模型做短时间试运行，结果保存为 profile，之后用 --profile 加载
+        AutotuneConfig tune;
+        tune.trial_frames = config.autotune_frames;
+        tune.max_p99_ms = config.autotune_p99_ms;
+        tune.out_path = config.autotune_out;
+        std::string model_path = config.model_path;
+        EngineFactory engines = [model_path](int worker_id) -> InferenceEngine * {
+            return new Yolov5s(model_path.c_str(), worker_id % 3);
+        };
+        const PipelineConfig &cfg = config;
+        SourceFactory source_factory = [&cfg](int stream_id) -> FrameSource * {
+            const std::string &path = cfg.streams[stream_id].path;
+            if(is_raw_frame_cache_path(path))
+            {
+                return new MmapFrameSource(path, cfg.pace_realtime);
+            }
+            return new VideoFileSource(path, cfg.pace_realtime);
+        };
+        if(!autotune_pipeline(config, tune, engines, source_factory))
         {
-            // 读不到帧了（到视频末尾或出错）
-            std::cerr << "[ReadThread] read failed or EOF.\n";
-            break;
+            return -1;
         }
-        FrameData data{ frame.clone(), idx++ };
-        g_readQueue.enqueue(data);
-        std::cout<<"读取队列中的图片数目目前是："<<g_readQueue.size()<<endl;
+        std::cout << "profile 已保存到 " << tune.out_path << "，用 --profile " << tune.out_path << " 加载" << std::endl;
+        return 0;
+    }
+    DebugDumper::instance().start(config.dump);
+    if(!config.trace_path.empty())
+    {
+        // 追踪：退出时写出，运行中 kill -USR1 <pid> 可随时写出一份
+        trace_enable(config.trace_path, config.trace_buffer);
+        trace_install_signal_handler();
+        trace_set_thread_name("main");
     }
-    // 通知后续不再有新帧
-    g_readFinish = true;
-    std::cerr << "[ReadThread] finished.\n";
-}
 
-//-----------------------------------
-// 3) 聚合线程：既提交多帧到线程池并行处理，也按顺序收集结果
-//-----------------------------------
-void aggregatorThreadFunc(ThreadPoll &npu_pool)
-{
-    // 用于按正确顺序写入的下标
-    int nextWriteIndex = 0;
+    // 为每路流创建来源、输出和流水线
+    std::vector<std::unique_ptr<FrameSource>> sources;
+    std::vector<std::unique_ptr<FrameSink>> sinks;
+    for(size_t i = 0; i < config.streams.size(); i++)
+    {
+        if(is_raw_frame_cache_path(config.streams[i].path))
+        {
+            // 预解码的原始帧缓存：按内存速度重放，只测推理与后处理
+            sources.emplace_back(new MmapFrameSource(config.streams[i].path, config.pace_realtime));
+        }
+        else
+        {
+            sources.emplace_back(new VideoFileSource(config.streams[i].path, config.pace_realtime));
+        }
+        std::string out_path = stream_output_path(config, (int)i);
+        if(config.output_mode != OUTPUT_VIDEO)
+        {
+            // 只要检测结果：写检测结果文件，视频要么不输出，要么原样流拷贝
+            std::string remux_out = (config.output_mode == OUTPUT_REMUX) ? remux_path_for(out_path, config.streams[i].path) : "";
+            sinks.emplace_back(new DetectionSidecarSink(sidecar_path_for(out_path, config.sidecar_format),
+                                                        config.sidecar_format, config.streams[i].path, remux_out));
+        }
+        else if(config.encoders > 1)
+        {
+            // 推理并行之后单线程 H.264 编码成为瓶颈：按 GOP 分块多线程编码
+            sinks.emplace_back(new SegmentedVideoSink(out_path, config.encoders, config.gop_frames, config.segment_output));
+        }
+        else
+        {
+            sinks.emplace_back(new VideoFileSink(out_path));
+        }
+    }
 
-    // 存储“帧下标 -> future”的映射，实现无阻塞并行提交与按序收集
-    std::map<int, std::future<ProcessResult>> tasks_inflight;
+    // 创建 thread pool，让它开足核数（例如 12 worker）；worker 数可用 --autotune 搜索后经 --profile 加载
+    // 逐层分析要在 rknn_init 之前打开
+    set_npu_profile_interval(config.npu_profile_every);
+    ThreadPoll npu_pool(config.model_path.c_str(), config.num_threads);
+    npu_pool.set_admission(config.pool_admission);
+    npu_pool.set_deadline_action(config.deadline_action);
+    npu_pool.set_tiling(config.tiling);
+    for(int p = 0; p < PRIORITY_NUM; p++)
+    {
+        npu_pool.set_priority_weight((TaskPriority)p, config.lane_weights[p]);
+    }
 
-    while(true)
+    // 二级分类器所有流共享，多路流的检测框合在一起凑批
+    std::unique_ptr<CascadeClassifier> cascade;
+    if(config.cascade.enabled)
     {
-        // 步骤A：批量尝试从 g_readQueue 获取新帧并提交到线程池
-        //       (如果想控制并行度，可在这里做判断 tasks_inflight.size() 是否过大。)
-        FrameData inputFD;
-        if(!g_readFinish)  // 每次循环能弹尽量多的帧
+        cascade.reset(new CascadeClassifier(config.cascade));
+        if(!cascade->open())
         {
-            g_readQueue.dequeue(inputFD);
-            // 提交异步推理任务
-            auto fut = npu_pool.submit_task_async(inputFD.index, inputFD.frame);
-            // 将 (index -> future) 存到映射
-            tasks_inflight[inputFD.index] = std::move(fut);
+            return -1;
         }
+    }
 
-        // 步骤B：检查是否有“下一个待写帧(nextWriteIndex)”已经推理完成
-        //        如果完成，就把其结果按顺序放到 g_writeQueue
-        auto it = tasks_inflight.find(nextWriteIndex);
-        while(it != tasks_inflight.end())
+    std::vector<std::unique_ptr<StreamPipeline>> pipelines;
+    std::vector<std::unique_ptr<SegmentedReader>> segmented_readers;
+    std::vector<std::unique_ptr<DetectionStoreWriter>> det_stores;
+    for(size_t i = 0; i < config.streams.size(); i++)
+    {
+        std::unique_ptr<StreamPipeline> pipeline(new StreamPipeline((int)i, sources[i].get(), sinks[i].get(),
+                                                                    npu_pool, config, config.streams[i].priority));
+        if(!pipeline->open())
         {
-            // 不阻塞，先检查这条 future 是否ready
-            auto status = it->second.wait_for(std::chrono::milliseconds(0));
-            if(status == std::future_status::ready)
+            return -1;
+        }
+        if(config.offline_readers > 1)
+        {
+            // 离线长视频：按关键帧分段，多个读线程并行解码喂给共享线程池
+            std::unique_ptr<SegmentedReader> reader(new SegmentedReader(config.streams[i].path, config.offline_readers,
+                                                                        config.segment_frames, 0));
+            if(reader->prepare() < 0)
             {
-                // 获取推理结果
-                ProcessResult result = it->second.get();
-
-                // 将推理后图像放到 g_writeQueue
-                FrameData outputFD;
-                outputFD.index = nextWriteIndex;
-                outputFD.frame = result.processed_img.clone();
-                g_writeQueue.enqueue(outputFD);
-
-                // 移除映射并递增下一个待写index
-                tasks_inflight.erase(it);
-                cout<<"当前已经处理完成了："<<nextWriteIndex<<"帧图片"<<endl;
-                nextWriteIndex++;
-
-                // 继续尝试下一个
-                it = tasks_inflight.find(nextWriteIndex);
+                return -1;
             }
-            else
+            pipeline->set_segmented_reader(reader.get());
+            segmented_readers.push_back(std::move(reader));
+        }
+        if(!config.det_store_path.empty())
+        {
+            std::unique_ptr<DetectionStoreWriter> store(new DetectionStoreWriter());
+            if(!store->open(stream_store_path(config, (int)i)))
             {
-                // 下一个还没完成，就先退出等待，后面再检测
-                break;
+                return -1;
             }
+            pipeline->set_detection_store(store.get());
+            det_stores.push_back(std::move(store));
         }
-
-        // 步骤C：判断退出条件
-        //   若读完了 && 读队列空了 && 当前映射也空了，就说明都处理完了
-        if(g_readFinish && g_readQueue.empty() && tasks_inflight.empty())
+        if(cascade)
         {
-            cout<<"处理线程已经结束"<<endl;
-            break;
+            pipeline->set_cascade(cascade.get());
         }
-
-        // 为避免CPU空转过高，可稍微睡一下
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        pipelines.push_back(std::move(pipeline));
     }
 
-    // 设置处理完成标志
-    g_processFinish = true;
-    std::cerr << "[AggregatorThread] finished.\n";
-}
+    for(auto &pipeline : pipelines)
+    {
+        pipeline->start();
+    }
 
-//-----------------------------------
-// 4) 写线程：从 g_writeQueue 中取出图像写到文件
-//-----------------------------------
-void writeThreadFunc(cv::VideoWriter &writer)
-{
+    // 运行期间定期打印各路 FPS 与延迟
+    auto last_report = std::chrono::steady_clock::now();
     while(true)
     {
-        if(g_processFinish && g_writeQueue.empty())
+        bool all_finished = true;
+        for(auto &pipeline : pipelines)
         {
-            // 没有更多帧了
-            break;
+            all_finished = all_finished && pipeline->finished();
         }
-
-        FrameData outputFD;
-        if(!g_writeQueue.dequeue(outputFD)) {
-            // 即使没取到，也要尝试继续，直到所有任务结束
-            continue;
+        if(all_finished)
+        {
+            break;
         }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        trace_poll_signal();
 
-        if(!outputFD.frame.empty())
+        auto now = std::chrono::steady_clock::now();
+        if(config.report_interval_s > 0 && now - last_report >= std::chrono::seconds(config.report_interval_s))
         {
-            writer.write(outputFD.frame);
+            for(auto &pipeline : pipelines)
+            {
+                pipeline->print_stats();
+            }
+            std::cout << "[ThreadPoll] NPU 占用率=" << npu_pool.npu_duty_cycle() * 100 << "%" << std::endl;
+            // 所有流合在一起的各阶段延迟分布
+            StageHistograms all_stages;
+            for(auto &pipeline : pipelines)
+            {
+                all_stages.add(pipeline->stage_histograms());
+            }
+            all_stages.print("[阶段]");
+            last_report = now;
         }
-        cout<<"写入队列帧数："<<g_writeQueue.size()<<endl;
     }
-    std::cerr << "[WriteThread] finished.\n";
-}
-
-//-----------------------------------
-// 5) main 函数，把上述线程和线程池串起来
-//-----------------------------------
-int main()
-{
-
-    auto start = std::chrono::high_resolution_clock::now();
-
-    std::string inPath  = "/home/orangepi/Desktop/video.mp4"; // 你的输入视频
-    std::string outPath = "output.avi";                       // 输出文件
 
-    // 打开输入视频
-    cv::VideoCapture cap(inPath);
-    if(!cap.isOpened())
+    for(auto &pipeline : pipelines)
     {
-        std::cerr << "Fail to open input video: " << inPath << "\n";
-        return -1;
+        pipeline->join();
     }
-
-    // 获取视频属性
-    int width  = static_cast<int>(cap.get(cv::CAP_PROP_FRAME_WIDTH));
-    int height = static_cast<int>(cap.get(cv::CAP_PROP_FRAME_HEIGHT));
-    double fps = cap.get(cv::CAP_PROP_FPS);
-    if(fps < 1.0)  // 避免某些视频元数据不完整
-        fps = 25.0;
-
-    int fourcc = cv::VideoWriter::fourcc('H','2','6','4');
-
-    // 打开输出视频
-    cv::VideoWriter writer(outPath, fourcc, fps, cv::Size(width, height));
-    if(!writer.isOpened())
+    if(cascade)
     {
-        std::cerr << "Fail to create output video: " << outPath << "\n";
-        return -1;
+        cascade->stop();
     }
 
-    // 创建 thread pool，让它开足核数（例如 12 worker）
-    ThreadPoll npu_pool("/home/orangepi/Desktop/model/yolov5s.rknn", 3);
-
-    // 启动：1) 读线程, 2) 聚合线程, 3) 写线程
-    std::thread tRead(readThreadFunc, std::ref(cap));
-    std::thread tAggregator(aggregatorThreadFunc, std::ref(npu_pool));
-    std::thread tWrite(writeThreadFunc, std::ref(writer));
-
-    // 等3个线程退出
-    tRead.join();
-    tAggregator.join();
-    tWrite.join();
-
-    // 给队列发 stop 信号（好习惯，但此时往往都空了）
-    g_readQueue.stop();
-    g_writeQueue.stop();
-
-    writer.release();
-
     auto end = std::chrono::high_resolution_clock::now();
     auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
     std::cout << "处理总用时：" << elapsed_ms.count() << " ms\n";
+    for(auto &pipeline : pipelines)
+    {
+        pipeline->print_stats();
+        pipeline->print_stage_stats();
+    }
+    npu_pool.print_stats();
+    if(cascade)
+    {
+        cascade->print_stats();
+    }
+    DebugDumper::instance().stop();
+    DebugDumper::instance().print_stats();
+    if(config.npu_profile_every > 0)
+    {
+        std::cout << NpuProfiler::instance().report(10);
+        NpuProfiler::instance().write_report(config.npu_profile_report, 0);
+    }
+    trace_flush();
+    log_stop();
     std::cerr << "[Main] All done.\n";
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,69 @@
+#include "mock_engine.h"
+
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <mutex>
+#include <string.h>
+#include <thread>
+
+#define MOCK_MAX_CORES 16
+
+// 每个模拟核一把锁：同一核上的推理串行执行
+static std::mutex g_mock_cores[MOCK_MAX_CORES];
+
+MockInferenceEngine::MockInferenceEngine(const MockEngineConfig &cfg, int worker_id)
+    : config(cfg)
+{
+    int cores = std::min(std::max(cfg.cores, 1), MOCK_MAX_CORES);
+    core = worker_id % cores;
+}
+
+int MockInferenceEngine::inference_region(const cv::Mat &origin_img, const cv::Rect &region_in,
+                                          detect_result_group_t &result_group, const RoiMask *roi,
+                                          FrameTimestamps *timestamps)
+{
+    result_group.clear();
+    if(origin_img.empty())
+    {
+        return -1;
+    }
+    cv::Rect region = region_in & cv::Rect(0, 0, origin_img.cols, origin_img.rows);
+    if(region.width <= 0 || region.height <= 0)
+    {
+        return -1;
+    }
+    if(timestamps) timestamps->mark(TS_PREPROCESS_END);
+
+    {
+        std::unique_lock<std::mutex> lock(g_mock_cores[core]);
+        std::this_thread::sleep_for(std::chrono::microseconds(config.latency_us));
+    }
+    if(timestamps) timestamps->mark(TS_NPU_END);
+
+    // 检测框排成近似方形的网格，每格中间放一个占格子一半大小的框
+    int n = std::max(config.objects, 0);
+    int cols = std::max(1, (int)ceil(sqrt((double)n)));
+    int rows = std::max(1, (n + cols - 1) / cols);
+    int cell_w = region.width / cols, cell_h = region.height / rows;
+    for(int i = 0; i < n; i++)
+    {
+        detect_result_t det;
+        memset(&det, 0, sizeof(det));
+        int cx = region.x + (i % cols) * cell_w + cell_w / 2;
+        int cy = region.y + (i / cols) * cell_h + cell_h / 2;
+        if(roi != NULL && !roi->empty() && !roi->contains((float)cx, (float)cy))
+        {
+            continue;
+        }
+        det.class_id = 0;
+        det.box_conf = 0.9f;
+        det.box.xmin = (int16_t)(cx - cell_w / 4);
+        det.box.ymin = (int16_t)(cy - cell_h / 4);
+        det.box.xmax = (int16_t)(cx + cell_w / 4);
+        det.box.ymax = (int16_t)(cy + cell_h / 4);
+        result_group.push_back(det);
+    }
+    if(timestamps) timestamps->mark(TS_POSTPROCESS_END);
+    return 0;
+}
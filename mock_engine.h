@@ -0,0 +1,38 @@
+#ifndef MOCK_ENGINE_H
+#define MOCK_ENGINE_H
+
+#include "inference_engine.h"
+
+// 模拟引擎参数
+struct MockEngineConfig
+{
+    int latency_us;      // 每次推理在"NPU 核"上占用的时间
+    int cores;           // 模拟的 NPU 核数：同一核上的推理串行，worker 多于核数时排队
+    int objects;         // 每次推理返回的检测框数
+    int input_width;     // 模型输入尺寸
+    int input_height;
+
+    MockEngineConfig() : latency_us(20000), cores(3), objects(5), input_width(640), input_height(640) {}
+};
+
+//-----------------------------------
+// 固定延迟的模拟推理引擎：不依赖 NPU，用于在任意机器上压测流水线本身的开销
+//   worker i 绑定模拟核 i % cores，与 Yolov5s 的核分配一致；
+//   检测框按区域内固定网格给出，数目由 objects 决定，后续的跟踪、画框、写出照常工作
+//-----------------------------------
+class MockInferenceEngine : public InferenceEngine
+{
+public:
+    MockInferenceEngine(const MockEngineConfig &cfg, int worker_id);
+
+    int inference_region(const cv::Mat &origin_img, const cv::Rect &region, detect_result_group_t &result_group,
+                         const RoiMask *roi = NULL, FrameTimestamps *timestamps = NULL) override;
+    int input_width() const override { return config.input_width; }
+    int input_height() const override { return config.input_height; }
+
+private:
+    MockEngineConfig config;
+    int core;
+};
+
+#endif
@@ -0,0 +1,46 @@
+#include "motion_gate.h"
+
+#include <algorithm>
+
+MotionGate::MotionGate(const MotionConfig &cfg)
+    : config(cfg), since_inference(0), checked(0), skipped(0)
+{
+}
+
+bool MotionGate::need_inference(const cv::Mat &frame)
+{
+    checked++;
+    if(frame.empty())
+    {
+        return true;
+    }
+
+    // 最近邻缩小只采样少量像素，开销与原图分辨率基本无关；再模糊一下压住噪点
+    int w = config.sample_width > 0 ? config.sample_width : 160;
+    int h = std::max(1, frame.rows * w / std::max(1, frame.cols));
+    cv::Mat small, gray;
+    cv::resize(frame, small, cv::Size(w, h), 0, 0, cv::INTER_NEAREST);
+    cv::cvtColor(small, gray, cv::COLOR_BGR2GRAY);
+    cv::GaussianBlur(gray, gray, cv::Size(5, 5), 0);
+
+    bool motion = true;
+    if(!reference.empty() && reference.size() == gray.size() && since_inference < config.max_skip)
+    {
+        cv::Mat diff;
+        cv::absdiff(gray, reference, diff);
+        cv::threshold(diff, diff, config.pixel_threshold, 255, cv::THRESH_BINARY);
+        double changed = (double)cv::countNonZero(diff) / (w * h);
+        motion = changed >= config.min_area;
+    }
+
+    if(!motion)
+    {
+        since_inference++;
+        skipped++;
+        return false;
+    }
+    // 送去推理的帧成为新的参考帧：缓慢变化累积到阈值也会触发推理
+    reference = gray;
+    since_inference = 0;
+    return true;
+}
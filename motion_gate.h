@@ -0,0 +1,41 @@
+#ifndef MOTION_GATE_H
+#define MOTION_GATE_H
+
+#include <opencv2/opencv.hpp>
+
+// 运动门控参数
+struct MotionConfig
+{
+    bool enabled;
+    int sample_width;       // 运动检测的采样宽度（像素），高度按比例
+    int pixel_threshold;    // 灰度差超过该值的像素算作变化
+    double min_area;        // 变化像素占比超过该值才算有运动
+    int max_skip;           // 最多连续跳过的帧数，到了就强制推理一次
+
+    MotionConfig() : enabled(false), sample_width(160), pixel_threshold(25), min_area(0.002), max_skip(25) {}
+};
+
+//-----------------------------------
+// 低分辨率帧差运动检测：与上一次送去推理的帧比较，没有运动的帧不占用 NPU，
+// 由调用方沿用上一帧的检测结果。每路流一个实例，按帧序调用（非线程安全）
+//-----------------------------------
+class MotionGate
+{
+public:
+    explicit MotionGate(const MotionConfig &cfg);
+
+    // 返回 true 表示这一帧需要推理
+    bool need_inference(const cv::Mat &frame);
+
+    uint64_t frames_checked() const { return checked; }
+    uint64_t frames_skipped() const { return skipped; }
+
+private:
+    MotionConfig config;
+    cv::Mat reference;   // 上一次推理的帧（低分辨率灰度）
+    int since_inference; // 距上一次推理已跳过的帧数
+    uint64_t checked;
+    uint64_t skipped;
+};
+
+#endif
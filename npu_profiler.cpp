@@ -0,0 +1,252 @@
+#include "npu_profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+static std::atomic<int> g_profile_interval(0);
+
+void set_npu_profile_interval(int every_n)
+{
+    g_profile_interval = every_n > 0 ? every_n : 0;
+}
+
+int npu_profile_interval()
+{
+    return g_profile_interval.load();
+}
+
+NpuProfiler &NpuProfiler::instance()
+{
+    static NpuProfiler profiler;
+    return profiler;
+}
+
+//-----------------------------------
+// 解析 RKNN_QUERY_PERF_DETAIL 文本
+//   表头含 "ID" 与 "Time(us)"，各列与表头按字符位置对齐；
+//   数据行以层号开头，OpType 为第二列，FullName 为最后一列，Target 取 NPU/CPU/GPU 中出现的那一列。
+//   不同版本的运行库列顺序不同，所以 Time(us) 按表头中的位置取，而不是按第几列取
+//-----------------------------------
+struct ParsedLayer {
+    int id;
+    std::string op_type;
+    std::string target;
+    std::string name;
+    int64_t time_us;
+};
+
+static void parse_perf_detail(const char *text, size_t len, std::vector<ParsedLayer> &out)
+{
+    std::istringstream in(std::string(text, len));
+    std::string line;
+    size_t time_col = std::string::npos;
+    while(std::getline(in, line))
+    {
+        if(time_col == std::string::npos)
+        {
+            size_t pos = line.find("Time(us)");
+            if(pos != std::string::npos && line.find("ID") != std::string::npos)
+            {
+                time_col = pos;
+            }
+            continue;
+        }
+        // 数据行以层号开头，汇总行（Total ...）与分隔线跳过
+        size_t first = line.find_first_not_of(" \t");
+        if(first == std::string::npos || line[first] < '0' || line[first] > '9' || line.size() <= time_col)
+        {
+            continue;
+        }
+        std::istringstream fields(line);
+        std::vector<std::string> tokens;
+        std::string tok;
+        while(fields >> tok)
+        {
+            tokens.push_back(tok);
+        }
+        if(tokens.size() < 3)
+        {
+            continue;
+        }
+
+        ParsedLayer layer;
+        layer.id = atoi(tokens[0].c_str());
+        layer.op_type = tokens[1];
+        layer.name = tokens.back();
+        for(size_t i = 2; i < tokens.size(); i++)
+        {
+            if(tokens[i] == "NPU" || tokens[i] == "CPU" || tokens[i] == "GPU")
+            {
+                layer.target = tokens[i];
+                break;
+            }
+        }
+        // 表头位置可能正好落在上一列的尾部空格里，跳过空白后再取数
+        const char *p = line.c_str() + time_col;
+        while(*p == ' ' || *p == '\t')
+        {
+            p++;
+        }
+        char *end = NULL;
+        double us = strtod(p, &end);
+        if(end == p)
+        {
+            continue;
+        }
+        layer.time_us = (int64_t)(us + 0.5);
+        out.push_back(layer);
+    }
+}
+
+void NpuProfiler::record(int core, const char *perf_detail, size_t len, int64_t npu_run_us, int64_t host_us)
+{
+    // 解析在锁外做，多个 worker 同时采样时只在合并时互斥
+    std::vector<ParsedLayer> parsed;
+    if(perf_detail != NULL && len > 0)
+    {
+        parse_perf_detail(perf_detail, len, parsed);
+    }
+
+    int64_t layer_sum = 0;
+    for(size_t i = 0; i < parsed.size(); i++)
+    {
+        layer_sum += parsed[i].time_us;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    for(size_t i = 0; i < parsed.size(); i++)
+    {
+        const ParsedLayer &p = parsed[i];
+        std::string key = std::to_string(p.id) + ":" + p.name;
+        std::map<std::string, LayerStat>::iterator it = layers.find(key);
+        if(it == layers.end())
+        {
+            LayerStat s;
+            s.id = p.id;
+            s.op_type = p.op_type;
+            s.target = p.target;
+            s.name = p.name;
+            s.samples = 0;
+            s.total_us = 0;
+            s.max_us = 0;
+            it = layers.insert(std::make_pair(key, s)).first;
+        }
+        it->second.samples++;
+        it->second.total_us += p.time_us;
+        it->second.max_us = std::max(it->second.max_us, p.time_us);
+    }
+    if(core >= 0 && core < MAX_CORES)
+    {
+        CoreStat &c = cores[core];
+        c.samples++;
+        c.npu_run_us += npu_run_us;
+        c.host_us += host_us;
+        c.layer_us += layer_sum;
+    }
+}
+
+std::string NpuProfiler::report(int top_n) const
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    std::ostringstream out;
+    char line[256];
+
+    // 1) 各核：NPU 实际运行时间与主机侧墙钟的对比
+    out << "==== NPU 逐层分析（每 " << npu_profile_interval() << " 次推理采样一次）====\n";
+    uint64_t all_samples = 0;
+    int64_t all_run = 0, all_host = 0;
+    for(int c = 0; c < MAX_CORES; c++)
+    {
+        const CoreStat &s = cores[c];
+        if(s.samples == 0)
+        {
+            continue;
+        }
+        snprintf(line, sizeof(line),
+                 "core %d: samples=%llu  npu_run=%.2f ms  host=%.2f ms  layer_sum=%.2f ms  host_overhead=%.1f%%\n",
+                 c, (unsigned long long)s.samples, s.npu_run_us / 1000.0 / s.samples, s.host_us / 1000.0 / s.samples,
+                 s.layer_us / 1000.0 / s.samples,
+                 s.host_us > 0 ? 100.0 * (s.host_us - s.npu_run_us) / s.host_us : 0.0);
+        out << line;
+        all_samples += s.samples;
+        all_run += s.npu_run_us;
+        all_host += s.host_us;
+    }
+    if(all_samples == 0)
+    {
+        out << "没有采样\n";
+        return out.str();
+    }
+    // 主机开销（输入输出拷贝、缓存同步、驱动调用）占一半以上时，优化 NPU 计算收效不大
+    double overhead = all_host > 0 ? (double)(all_host - all_run) / all_host : 0.0;
+    out << "结论: " << (overhead > 0.5 ? "主机传输/同步为主" : "NPU 计算为主")
+        << "（主机开销占 " << (int)(overhead * 100 + 0.5) << "%）\n";
+
+    // 2) 按算子类型汇总
+    std::map<std::string, std::pair<int64_t, int> > by_type;
+    int64_t total_us = 0;
+    for(std::map<std::string, LayerStat>::const_iterator it = layers.begin(); it != layers.end(); ++it)
+    {
+        const LayerStat &s = it->second;
+        std::pair<int64_t, int> &t = by_type[s.op_type + (s.target.empty() ? "" : "@" + s.target)];
+        t.first += s.total_us;
+        t.second++;
+        total_us += s.total_us;
+    }
+    std::vector<std::pair<int64_t, std::string> > types;
+    for(std::map<std::string, std::pair<int64_t, int> >::const_iterator it = by_type.begin(); it != by_type.end(); ++it)
+    {
+        types.push_back(std::make_pair(it->second.first, it->first));
+    }
+    std::sort(types.rbegin(), types.rend());
+    out << "---- 按算子类型 ----\n";
+    for(size_t i = 0; i < types.size(); i++)
+    {
+        snprintf(line, sizeof(line), "%-28s layers=%-4d avg=%9.1f us  share=%5.1f%%\n", types[i].second.c_str(),
+                 by_type[types[i].second].second, (double)types[i].first / all_samples,
+                 total_us > 0 ? 100.0 * types[i].first / total_us : 0.0);
+        out << line;
+    }
+
+    // 3) 按累计耗时排序的各层
+    std::vector<const LayerStat *> ranked;
+    for(std::map<std::string, LayerStat>::const_iterator it = layers.begin(); it != layers.end(); ++it)
+    {
+        ranked.push_back(&it->second);
+    }
+    std::sort(ranked.begin(), ranked.end(),
+              [](const LayerStat *a, const LayerStat *b) { return a->total_us > b->total_us; });
+    size_t n = top_n > 0 ? std::min(ranked.size(), (size_t)top_n) : ranked.size();
+    out << "---- 耗时最多的 " << n << " 层（共 " << ranked.size() << " 层）----\n";
+    out << "rank    id  op_type              target       avg_us     max_us   share  name\n";
+    for(size_t i = 0; i < n; i++)
+    {
+        const LayerStat &s = *ranked[i];
+        snprintf(line, sizeof(line), "%4d %5d  %-20s %-6s %10.1f %10lld  %5.1f%%  ", (int)i + 1, s.id,
+                 s.op_type.c_str(), s.target.c_str(), (double)s.total_us / s.samples, (long long)s.max_us,
+                 total_us > 0 ? 100.0 * s.total_us / total_us : 0.0);
+        out << line << s.name << "\n";
+    }
+    return out.str();
+}
+
+bool NpuProfiler::write_report(const std::string &path, int top_n) const
+{
+    std::string text = report(top_n);
+    FILE *fp = fopen(path.c_str(), "w");
+    if(fp == NULL)
+    {
+        std::cerr << "Fail to create NPU profile report: " << path << "\n";
+        return false;
+    }
+    fwrite(text.data(), 1, text.size(), fp);
+    fclose(fp);
+    std::cout << "[NpuProfiler] 逐层分析报告已写到 " << path << std::endl;
+    return true;
+}
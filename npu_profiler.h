@@ -0,0 +1,60 @@
+#ifndef NPU_PROFILER_H
+#define NPU_PROFILER_H
+
+#include <map>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+
+//-----------------------------------
+// NPU 逐层耗时分析
+//   开启后检测模型的上下文带 RKNN_FLAG_COLLECT_PERF_MASK 初始化，每 N 次推理查询一次
+//   RKNN_QUERY_PERF_DETAIL（逐层）与 RKNN_QUERY_PERF_RUN（NPU 实际运行时长），跨帧、跨核汇总。
+//   同时记录主机侧 inputs_set + run + outputs_get 的墙钟时间：两者差值是输入输出拷贝与同步的开销，
+//   用来判断一个模型版本是卡在 NPU 计算上还是卡在主机传输上
+//-----------------------------------
+
+// 采样间隔：<=0 关闭；必须在创建线程池（即 rknn_init）之前设置
+void set_npu_profile_interval(int every_n);
+int npu_profile_interval();
+
+class NpuProfiler
+{
+public:
+    enum { MAX_CORES = 3 };
+
+    static NpuProfiler &instance();
+
+    // 记录一次采样：perf_detail 为 RKNN_QUERY_PERF_DETAIL 返回的文本，
+    // npu_run_us 为 RKNN_QUERY_PERF_RUN 的时长，host_us 为主机侧墙钟时间
+    void record(int core, const char *perf_detail, size_t len, int64_t npu_run_us, int64_t host_us);
+
+    // 按累计耗时排序的报告：各核汇总、算子类型汇总、前 top_n 层
+    std::string report(int top_n) const;
+    bool write_report(const std::string &path, int top_n) const;
+
+private:
+    NpuProfiler() {}
+
+    struct LayerStat {
+        int id;
+        std::string op_type;
+        std::string target;  // NPU / CPU 等，CPU 层往往意味着算子没被 NPU 支持
+        std::string name;
+        uint64_t samples;
+        int64_t total_us;
+        int64_t max_us;
+    };
+    struct CoreStat {
+        uint64_t samples;
+        int64_t npu_run_us;   // RKNN_QUERY_PERF_RUN 累计
+        int64_t host_us;      // 主机侧墙钟累计
+        int64_t layer_us;     // 各层耗时之和累计
+    };
+
+    mutable std::mutex mutex;
+    std::map<std::string, LayerStat> layers;  // 键为 "层号:全名"，不同核上的同一层合在一起
+    CoreStat cores[MAX_CORES] = {};
+};
+
+#endif
@@ -0,0 +1,329 @@
+#include "overlay_renderer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <stdio.h>
+#include <string.h>
+
+#include "RgaUtils.h"
+#include "im2d.h"
+#include "rga.h"
+
+// 框的颜色与线宽，与原先 cv::rectangle 的 Scalar(255, 0, 0)(BGR 蓝色)、线宽 3 保持一致
+// RGA 的颜色值按 RGBA8888 从低字节到高字节排列：R 在最低字节
+#define OVERLAY_BOX_COLOR_RGA  0xffff0000u
+#define OVERLAY_BOX_THICKNESS  3
+// 标签文字：红色，原先 putText 的字体与缩放
+#define OVERLAY_FONT           cv::FONT_HERSHEY_SIMPLEX
+#define OVERLAY_FONT_SCALE     0.8
+
+static std::atomic<int> g_overlay_backend(OVERLAY_RGA);
+
+void set_overlay_backend(OverlayBackend backend)
+{
+    g_overlay_backend = backend;
+}
+
+OverlayBackend overlay_backend()
+{
+    return (OverlayBackend)g_overlay_backend.load();
+}
+
+//-----------------------------------
+// 字形图集
+//-----------------------------------
+const GlyphAtlas &GlyphAtlas::instance()
+{
+    // 函数内静态变量的初始化是线程安全的，多个 worker 首次画框时只栅格化一次
+    static const GlyphAtlas atlas;
+    return atlas;
+}
+
+GlyphAtlas::GlyphAtlas()
+{
+    int max_ascent = 0, max_descent = 0, total_width = 0;
+    for(int c = 0; c < 128; c++)
+    {
+        glyph_x[c] = 0;
+        glyph_w[c] = 0;
+        if(c < 32 || c > 126)
+        {
+            continue;
+        }
+        int baseline = 0;
+        cv::Size size = cv::getTextSize(std::string(1, (char)c), OVERLAY_FONT, OVERLAY_FONT_SCALE, 1, &baseline);
+        glyph_x[c] = total_width;
+        glyph_w[c] = size.width;
+        total_width += size.width;
+        max_ascent = std::max(max_ascent, size.height);
+        max_descent = std::max(max_descent, baseline);
+    }
+    cell_height = max_ascent + max_descent + 2;
+
+    cv::Mat mask(cell_height, total_width, CV_8UC1, cv::Scalar(0));
+    for(int c = 32; c <= 126; c++)
+    {
+        cv::putText(mask, std::string(1, (char)c), cv::Point(glyph_x[c], 1 + max_ascent),
+                    OVERLAY_FONT, OVERLAY_FONT_SCALE, cv::Scalar(255), 1, cv::LINE_AA);
+    }
+
+    // RGBA：颜色固定为红色，字形形状放在 alpha 通道
+    atlas = cv::Mat(cell_height, total_width, CV_8UC4, cv::Scalar(255, 0, 0, 0));
+    for(int r = 0; r < cell_height; r++)
+    {
+        const uchar *m = mask.ptr<uchar>(r);
+        uchar *a = atlas.ptr<uchar>(r);
+        for(int x = 0; x < total_width; x++)
+        {
+            a[4 * x + 3] = m[x];
+        }
+    }
+}
+
+int GlyphAtlas::text_width(const char *text) const
+{
+    int w = 0;
+    for(const unsigned char *p = (const unsigned char *)text; *p; p++)
+    {
+        w += (*p < 128) ? glyph_w[*p] : 0;
+    }
+    return w;
+}
+
+int GlyphAtlas::blit(const char *text, cv::Mat &dst, int x) const
+{
+    int start = x;
+    int rows = std::min(cell_height, dst.rows);
+    for(const unsigned char *p = (const unsigned char *)text; *p && x < dst.cols; p++)
+    {
+        int w = (*p < 128) ? glyph_w[*p] : 0;
+        w = std::min(w, dst.cols - x);
+        if(w <= 0)
+        {
+            continue;
+        }
+        for(int r = 0; r < rows; r++)
+        {
+            memcpy(dst.ptr<uchar>(r) + 4 * x, atlas.ptr<uchar>(r) + 4 * glyph_x[*p], 4 * w);
+        }
+        x += w;
+    }
+    return x - start;
+}
+
+//-----------------------------------
+// 叠加渲染
+//-----------------------------------
+OverlayRenderer::OverlayRenderer()
+    : rga_ok(true)
+{
+}
+
+int OverlayRenderer::draw(const cv::Mat &img, const detect_result_group_t &group)
+{
+    if(img.empty() || group.size() == 0)
+    {
+        return 0;
+    }
+    compose_labels(img, group);
+    if(overlay_backend() == OVERLAY_RGA && rga_ok && draw_rga(img, group))
+    {
+        return 0;
+    }
+    draw_cpu(img, group);
+    return 0;
+}
+
+void OverlayRenderer::compose_labels(const cv::Mat &img, const detect_result_group_t &group)
+{
+    strips.clear();
+    const GlyphAtlas &atlas = GlyphAtlas::instance();
+    int h = atlas.height();
+    if(img.rows < h)
+    {
+        return;
+    }
+
+    // 先排版：各标签的文字与贴到帧上的位置
+    char text[128];
+    std::vector<std::string> texts;
+    texts.reserve(group.size());
+    int sheet_w = 0;
+    for(size_t i = 0; i < group.size(); i++)
+    {
+        const detect_result_t &det = group[i];
+        int n = snprintf(text, sizeof(text), "%s", class_label(det.class_id));
+        if(det.track_id != 0 && n < (int)sizeof(text))
+        {
+            n += snprintf(text + n, sizeof(text) - n, "#%d", det.track_id);
+        }
+        if(det.attr_id != 0 && n < (int)sizeof(text))
+        {
+            n += snprintf(text + n, sizeof(text) - n, "(%s)", attribute_label(det.attr_id));
+        }
+        if(n < (int)sizeof(text))
+        {
+            snprintf(text + n, sizeof(text) - n, ":%.2f %%", det.box_conf * 100);
+        }
+
+        // 标签放在框的上方，贴着上边界时放到框内
+        int x = std::min(std::max((int)det.box.xmin, 0), img.cols - 1);
+        int y = det.box.ymin - h - 2;
+        if(y < 0)
+        {
+            y = std::max((int)det.box.ymin, 0) + 2;
+        }
+        y = std::min(y, img.rows - h);
+        int w = std::min(atlas.text_width(text), img.cols - x);
+        if(w <= 0)
+        {
+            continue;
+        }
+        strips.push_back(cv::Rect(x, y, w, h));
+        texts.push_back(text);
+        sheet_w = std::max(sheet_w, w);
+    }
+    if(strips.empty())
+    {
+        return;
+    }
+
+    // 标签表只在变大时重新分配（宽度按 16 对齐，满足 RGA 的行宽要求），每帧只清除用到的行
+    int sheet_h = (int)strips.size() * h;
+    sheet_w = (sheet_w + 15) / 16 * 16;
+    if(labels.rows < sheet_h || labels.cols < sheet_w)
+    {
+        labels = cv::Mat(std::max(labels.rows, sheet_h), std::max(labels.cols, sheet_w), CV_8UC4);
+    }
+    labels(cv::Rect(0, 0, labels.cols, sheet_h)).setTo(cv::Scalar(0, 0, 0, 0));
+    for(size_t i = 0; i < strips.size(); i++)
+    {
+        cv::Mat dst = labels(cv::Rect(0, (int)i * h, strips[i].width, h));
+        atlas.blit(texts[i].c_str(), dst, 0);
+    }
+}
+
+bool OverlayRenderer::draw_rga(const cv::Mat &img, const detect_result_group_t &group)
+{
+    // RGA 导入虚拟地址要求行宽 16 对齐且内存连续，不满足时这一帧走 CPU
+    if(img.type() != CV_8UC3 || img.cols % 16 != 0 || !img.isContinuous())
+    {
+        return false;
+    }
+
+    std::vector<im_rect> rects;
+    std::vector<size_t> small_boxes;
+    rects.reserve(group.size());
+    for(size_t i = 0; i < group.size(); i++)
+    {
+        const box_p &b = group[i].box;
+        int x0 = std::max((int)b.xmin, 0), y0 = std::max((int)b.ymin, 0);
+        int x1 = std::min((int)b.xmax, img.cols), y1 = std::min((int)b.ymax, img.rows);
+        if(x1 - x0 < 2 * OVERLAY_BOX_THICKNESS || y1 - y0 < 2 * OVERLAY_BOX_THICKNESS)
+        {
+            // RGA 画不了比线宽还窄的框，留给 CPU 补画，保证两个后端输出一致
+            small_boxes.push_back(i);
+            continue;
+        }
+        im_rect r = {x0, y0, x1 - x0, y1 - y0};
+        rects.push_back(r);
+    }
+
+    rga_buffer_handle_t img_handle = importbuffer_virtualaddr(img.data, img.total() * img.elemSize());
+    rga_buffer_handle_t labels_handle = 0;
+    if(!strips.empty())
+    {
+        labels_handle = importbuffer_virtualaddr(labels.data, labels.total() * labels.elemSize());
+    }
+    int ret = IM_STATUS_SUCCESS;
+    if(img_handle == 0 || (!strips.empty() && labels_handle == 0))
+    {
+        ret = IM_STATUS_FAILED;
+    }
+    else
+    {
+        rga_buffer_t dst = wrapbuffer_handle(img_handle, img.cols, img.rows, RK_FORMAT_BGR_888);
+        // 一次调用画完所有框
+        if(!rects.empty())
+        {
+            ret = imrectangleArray(dst, rects.data(), (int)rects.size(), OVERLAY_BOX_COLOR_RGA, OVERLAY_BOX_THICKNESS);
+        }
+        // 所有标签的混合放进同一个任务，一次提交
+        if(ret == IM_STATUS_SUCCESS && !strips.empty())
+        {
+            rga_buffer_t fg = wrapbuffer_handle(labels_handle, labels.cols, labels.rows, RK_FORMAT_RGBA_8888);
+            rga_buffer_t pat;
+            memset(&pat, 0, sizeof(pat));
+            im_rect pat_rect = {0, 0, 0, 0};
+            int h = GlyphAtlas::instance().height();
+            im_job_handle_t job = imbeginJob();
+            for(size_t i = 0; i < strips.size() && ret == IM_STATUS_SUCCESS; i++)
+            {
+                im_rect src_rect = {0, (int)i * h, strips[i].width, h};
+                im_rect dst_rect = {strips[i].x, strips[i].y, strips[i].width, h};
+                ret = improcessTask(job, fg, dst, pat, src_rect, dst_rect, pat_rect, NULL, IM_ALPHA_BLEND_SRC_OVER);
+            }
+            if(ret == IM_STATUS_SUCCESS)
+            {
+                ret = imendJob(job, IM_SYNC);
+            }
+            else
+            {
+                imcancelJob(job);
+            }
+        }
+    }
+    if(img_handle)
+    {
+        releasebuffer_handle(img_handle);
+    }
+    if(labels_handle)
+    {
+        releasebuffer_handle(labels_handle);
+    }
+    if(ret != IM_STATUS_SUCCESS)
+    {
+        printf("%d, RGA overlay error, fall back to CPU! %s\n", __LINE__, imStrError((IM_STATUS)ret));
+        rga_ok = false;
+        return false;
+    }
+    for(size_t k = 0; k < small_boxes.size(); k++)
+    {
+        const box_p &b = group[small_boxes[k]].box;
+        cv::rectangle(img, cv::Point(b.xmin, b.ymin), cv::Point(b.xmax, b.ymax), cv::Scalar(255, 0, 0, 255),
+                      OVERLAY_BOX_THICKNESS);
+    }
+    return true;
+}
+
+void OverlayRenderer::draw_cpu(const cv::Mat &img, const detect_result_group_t &group)
+{
+    for(size_t i = 0; i < group.size(); i++)
+    {
+        const box_p &b = group[i].box;
+        cv::rectangle(img, cv::Point(b.xmin, b.ymin), cv::Point(b.xmax, b.ymax), cv::Scalar(255, 0, 0, 255),
+                      OVERLAY_BOX_THICKNESS);
+    }
+
+    // 逐个标签混合；标签表是 RGBA，帧是 BGR
+    for(size_t i = 0; i < strips.size(); i++)
+    {
+        const cv::Rect &s = strips[i];
+        for(int r = 0; r < s.height; r++)
+        {
+            const uchar *src = labels.ptr<uchar>((int)i * s.height + r);
+            uchar *dst = const_cast<uchar *>(img.ptr<uchar>(s.y + r)) + 3 * s.x;
+            for(int x = 0; x < s.width; x++, src += 4, dst += 3)
+            {
+                int a = src[3];
+                if(a == 0)
+                {
+                    continue;
+                }
+                dst[0] = (uchar)((src[2] * a + dst[0] * (255 - a)) / 255);
+                dst[1] = (uchar)((src[1] * a + dst[1] * (255 - a)) / 255);
+                dst[2] = (uchar)((src[0] * a + dst[2] * (255 - a)) / 255);
+            }
+        }
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef OVERLAY_RENDERER_H
+#define OVERLAY_RENDERER_H
+
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#include "post_process.h"
+
+// 画框后端
+enum OverlayBackend {
+    OVERLAY_RGA = 0,  // RGA 画框 + 批量 alpha 混合标签，失败时自动退回 CPU
+    OVERLAY_CPU       // 全部在 CPU 上画（非 Rockchip 平台或调试用）
+};
+
+// 设置/查询全局画框后端，需在启动流水线之前设置
+void set_overlay_backend(OverlayBackend backend);
+OverlayBackend overlay_backend();
+
+//-----------------------------------
+// 字形图集：启动时用 putText 把可打印 ASCII 字符各栅格化一次，存成一条 RGBA 图，
+// 标签文字由字形拼接而成，运行时不再调用 putText。全局只读共享
+//-----------------------------------
+class GlyphAtlas
+{
+public:
+    static const GlyphAtlas &instance();
+
+    int height() const { return cell_height; }
+    // 文本拼接后的宽度（像素）
+    int text_width(const char *text) const;
+    // 把文本拼到 dst（RGBA，与图集同高）的 (x, 0) 处，超出 dst 的部分截断；返回写入的宽度
+    int blit(const char *text, cv::Mat &dst, int x) const;
+
+private:
+    GlyphAtlas();
+
+    cv::Mat atlas;           // RGBA，cell_height 行，所有字形横向排列
+    int cell_height;
+    int glyph_x[128];        // 各字符在图集中的起始列
+    int glyph_w[128];        // 各字符的宽度（即前进宽度），不可打印字符为 0
+};
+
+//-----------------------------------
+// 一帧检测结果的叠加渲染：
+//   框：所有框一次 imrectangleArray 画完；边长不足两倍线宽的小框 RGA 画不了，用 cv::rectangle 补画
+//   标签：从字形图集拼到一张紧凑的 RGBA 标签表（每个标签一行，宽度为最长标签），
+//         所有标签的 alpha 混合放进同一个 RGA 任务一次提交；标签表大小只与标签数有关，与帧分辨率无关
+//   RGA 不可用（行宽未 16 对齐、导入或调用失败）时用 cv::rectangle + CPU 逐标签混合
+// 每个线程一个实例（标签表不共享）
+//-----------------------------------
+class OverlayRenderer
+{
+public:
+    OverlayRenderer();
+
+    int draw(const cv::Mat &img, const detect_result_group_t &group);
+
+private:
+    void compose_labels(const cv::Mat &img, const detect_result_group_t &group);
+    bool draw_rga(const cv::Mat &img, const detect_result_group_t &group);
+    void draw_cpu(const cv::Mat &img, const detect_result_group_t &group);
+
+    cv::Mat labels;                // RGBA 标签表：第 i 个标签在 (0, i*字高) 处，只增不减
+    std::vector<cv::Rect> strips;  // 本帧各标签贴到帧上的位置
+    bool rga_ok;                   // RGA 调用失败过一次后本实例一直走 CPU
+};
+
+#endif
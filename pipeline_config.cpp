@@ -0,0 +1,569 @@
+#include "pipeline_config.h"
+
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+PipelineConfig::PipelineConfig()
+    : input_path("/home/orangepi/Desktop/video.mp4"),
+      output_path("output.avi"),
+      model_path("/home/orangepi/Desktop/model/yolov5s.rknn"),
+      num_threads(3),
+      pace_realtime(false),
+      report_interval_s(5),
+      offline_readers(0),
+      segment_frames(60),
+      bench_decode(false),
+      bench_similarity(false),
+      similarity_dim(256),
+      encoders(0),
+      gop_frames(50),
+      segment_output(SEGMENT_CONCAT),
+      output_mode(OUTPUT_VIDEO),
+      sidecar_format(SIDECAR_JSONL),
+      overlay(OVERLAY_RGA),
+      trace_buffer(1 << 16),
+      log_level(LOG_LEVEL_INFO),
+      npu_profile_every(0),
+      npu_profile_report("npu_profile.txt"),
+      autotune(false),
+      autotune_frames(200),
+      autotune_p99_ms(0),
+      autotune_out("pipeline.profile"),
+      read_queue_size(100),
+      write_queue_size(100),
+      max_inflight(16),
+      deadline_ms(0),
+      deadline_action(DEADLINE_SKIP),
+      priority(PRIORITY_NORMAL)
+{
+    lane_weights[PRIORITY_LIVE]   = 8;
+    lane_weights[PRIORITY_NORMAL] = 4;
+    lane_weights[PRIORITY_BULK]   = 1;
+}
+
+static std::string stream_suffixed_path(const PipelineConfig &cfg, const std::string &path, int stream_id)
+{
+    if(cfg.streams.size() <= 1)
+    {
+        return path;
+    }
+    std::string base = path;
+    std::string ext;
+    size_t dot = base.find_last_of('.');
+    size_t slash = base.find_last_of('/');
+    if(dot != std::string::npos && (slash == std::string::npos || dot > slash))
+    {
+        ext = base.substr(dot);
+        base = base.substr(0, dot);
+    }
+    return base + "_" + std::to_string(stream_id) + ext;
+}
+
+std::string stream_output_path(const PipelineConfig &cfg, int stream_id)
+{
+    return stream_suffixed_path(cfg, cfg.output_path, stream_id);
+}
+
+std::string stream_store_path(const PipelineConfig &cfg, int stream_id)
+{
+    return stream_suffixed_path(cfg, cfg.det_store_path, stream_id);
+}
+
+bool parse_task_priority(const std::string &name, TaskPriority &priority)
+{
+    if(name == "live")        { priority = PRIORITY_LIVE; }
+    else if(name == "normal") { priority = PRIORITY_NORMAL; }
+    else if(name == "bulk")   { priority = PRIORITY_BULK; }
+    else                      { return false; }
+    return true;
+}
+
+bool save_pipeline_profile(const std::string &path, const PipelineConfig &cfg, const std::string &comment)
+{
+    FILE *fp = fopen(path.c_str(), "w");
+    if(fp == NULL)
+    {
+        std::cerr << "Fail to create profile: " << path << "\n";
+        return false;
+    }
+    fprintf(fp, "# pipeline profile, model=%s\n", cfg.model_path.c_str());
+    if(!comment.empty())
+    {
+        fprintf(fp, "# %s\n", comment.c_str());
+    }
+    fprintf(fp, "workers=%d\n", cfg.num_threads);
+    fprintf(fp, "max_inflight=%d\n", cfg.max_inflight);
+    fprintf(fp, "read_queue=%zu\n", cfg.read_queue_size);
+    fprintf(fp, "write_queue=%zu\n", cfg.write_queue_size);
+    return fclose(fp) == 0;
+}
+
+bool load_pipeline_profile(const std::string &path, PipelineConfig &cfg)
+{
+    FILE *fp = fopen(path.c_str(), "r");
+    if(fp == NULL)
+    {
+        std::cerr << "Fail to open profile: " << path << "\n";
+        return false;
+    }
+    char line[256];
+    int line_no = 0;
+    bool ok = true;
+    while(ok && fgets(line, sizeof(line), fp) != NULL)
+    {
+        line_no++;
+        if(line[0] == '#' || line[0] == '\n' || line[0] == '\r' || line[0] == '\0')
+        {
+            continue;
+        }
+        char key[64];
+        long value;
+        if(sscanf(line, "%63[^=]=%ld", key, &value) != 2 || value <= 0)
+        {
+            std::cerr << path << ":" << line_no << " 格式有误\n";
+            ok = false;
+        }
+        else if(strcmp(key, "workers") == 0)      { cfg.num_threads = (int)value; }
+        else if(strcmp(key, "max_inflight") == 0) { cfg.max_inflight = (int)value; }
+        else if(strcmp(key, "read_queue") == 0)   { cfg.read_queue_size = (size_t)value; }
+        else if(strcmp(key, "write_queue") == 0)  { cfg.write_queue_size = (size_t)value; }
+        else
+        {
+            // 旧版本程序读新 profile 时跳过不认识的键
+            std::cerr << path << ":" << line_no << " 忽略未知的键: " << key << "\n";
+        }
+    }
+    fclose(fp);
+    return ok;
+}
+
+void print_pipeline_usage(const char *prog)
+{
+    std::cout << "用法: " << prog << " [选项]\n"
+              << "  --input [P:]PATH      输入视频/摄像头，可重复指定多路；P 为可选优先级前缀 live|normal|bulk\n"
+              << "  --output PATH         输出视频（多路时自动加 _流编号 后缀）\n"
+              << "  --pace                按帧率读取本地文件，模拟实时摄像头\n"
+              << "  --report-sec N        每 N 秒打印各路统计（0 为不打印）\n"
+              << "  --offline-readers N   离线模式：按关键帧分段，N 个读线程并行解码\n"
+              << "  --segment-frames N    分段的最小帧数（默认 60）\n"
+              << "  --bench-decode        对比单读线程与分段并行解码的速度后退出\n"
+              << "  --bench-similarity    对比 CPU 与 NPU(rknn_matmul) 计算特征相似度矩阵的速度后退出\n"
+              << "  --similarity-dim N    相似度测试的特征维度（默认 256）\n"
+              << "  --encoders N          并行分段编码线程数（>1 时启用）\n"
+              << "  --gop-frames N        每个编码分段的帧数（默认 50）\n"
+              << "  --segment-output M    分段编码输出: concat(无损拼接)|hls(MPEG-TS 分段 + m3u8 列表)\n"
+              << "  --output-mode M       输出内容: video(画框重编码)|sidecar(只写检测结果)|remux(检测结果+原视频流拷贝，沿用输入的容器格式)\n"
+              << "  --sidecar-format F    检测结果文件格式: jsonl|bin\n"
+              << "  --overlay B           画框后端: rga(默认，失败时退回 CPU)|cpu\n"
+              << "  --det-store PATH      把检测结果追加到列式检测结果库（用 det_query 查询）\n"
+              << "  --trace PATH          记录时间线，退出或收到 SIGUSR1 时写出 Chrome trace JSON（用 Perfetto 打开）\n"
+              << "  --trace-buffer N      每个线程缓冲的追踪事件数（默认 65536，满了丢弃后续事件）\n"
+              << "  --dump-dir DIR        开启调试图片转储，写到已存在的目录 DIR（文件名含流编号与帧号）\n"
+              << "  --dump-every N        每 N 帧转储一次原图与 RGA 处理后的模型输入\n"
+              << "  --dump-slow-ms N      推理超过 N 毫秒的帧转储原图\n"
+              << "  --dump-empty          没有检测框的帧转储原图\n"
+              << "  --dump-queue N        转储 I/O 队列容量（默认 8，满了丢弃）\n"
+              << "  --dump-max N          最多转储的文件数（默认 1000，0 为不限）\n"
+              << "  --log-level L         日志级别: debug(含每帧队列状态，每线程每秒一条)|info(默认)|warn|error|off\n"
+              << "  --npu-profile N       NPU 逐层分析：每 N 次推理采样一次逐层耗时，退出时写排序报告\n"
+              << "  --npu-profile-report PATH  逐层分析报告文件（默认 npu_profile.txt）\n"
+              << "  --profile PATH        读入调参 profile（worker 数、在线帧窗口、队列容量），其后的参数仍可覆盖\n"
+              << "  --autotune            试运行搜索 worker 数（每个 NPU 核 1~4 个）、在线帧窗口、队列容量，保存 profile 后退出\n"
+              << "  --autotune-frames N   每次试运行每路流的帧数（默认 200）\n"
+              << "  --autotune-p99-ms N   延迟约束：端到端 p99 不超过 N 毫秒（默认不约束）\n"
+              << "  --autotune-out PATH   调参结果 profile（默认 pipeline.profile）\n"
+              << "  --cpu-pin             按线程职责绑核：读/聚合/worker/写放大核，日志与 I/O 放小核（从 sysfs 识别大小核）\n"
+              << "  --pin ROLE=CPUS       单独指定某类线程的核并开启绑核，ROLE 为 read|aggregate|worker|write|log|io，\n"
+              << "                        CPUS 为 big|little|any|核列表（如 4-7 或 0,2），可重复\n"
+              << "  --read-queue N        每路读队列容量\n"
+              << "  --write-queue N       每路写队列容量\n"
+              << "  --model PATH          RKNN 模型\n"
+              << "  --threads N           线程池 worker 数\n"
+              << "  --inflight N          线程池中同时处理的最大帧数\n"
+              << "  --read-policy P       读队列准入策略: block|drop_newest|drop_oldest|every_n\n"
+              << "  --pool-policy P       线程池准入策略: block|drop_newest|drop_oldest|every_n\n"
+              << "  --read-watermark N    读队列过载水位（默认为队列容量）\n"
+              << "  --pool-watermark N    线程池任务队列过载水位（0 为不限）\n"
+              << "  --keep-every N        every_n 策略下过载时每 N 帧保留 1 帧\n"
+              << "  --max-age-ms MS       帧龄上限，超过即丢弃（0 为不限）\n"
+              << "  --deadline-ms MS      每帧截止时间（相对采集时刻，0 为不设）\n"
+              << "  --deadline-action A   赶不上截止时间时: skip|degrade\n"
+              << "  --roi-rect [S@]x,y,w,h        感兴趣区域矩形，S 为流编号（省略时作用于所有流），可重复\n"
+              << "  --roi-poly [S@]x1,y1,x2,y2,.. 感兴趣区域多边形（至少 3 个点），可重复\n"
+              << "  --motion              运动门控：低分辨率帧差检测不到运动的帧不推理，沿用上一帧结果\n"
+              << "  --motion-threshold N  灰度差阈值（默认 25）\n"
+              << "  --motion-min-area F   变化像素占比下限（默认 0.002）\n"
+              << "  --motion-max-skip N   最多连续跳过的帧数（默认 25）\n"
+              << "  --motion-width N      运动检测的采样宽度（默认 160）\n"
+              << "  --track               多目标跟踪（卡尔曼 + 匈牙利关联），每个框带轨迹号\n"
+              << "  --detect-interval N   跟踪稳定时最多每 N 帧检测一次，中间帧用预测（默认 4）\n"
+              << "  --track-iou F         关联的最小 IoU（默认 0.3）\n"
+              << "  --track-max-age N     轨迹连续 N 个检测帧未匹配即删除（默认 10）\n"
+              << "  --cascade-model PATH  对检测框做二级分类（属性识别），多帧的框凑批推理\n"
+              << "  --cascade-labels PATH 属性标签文件\n"
+              << "  --cascade-core N      二级分类使用的 NPU 核 0|1|2，-1 为自动（默认 2）\n"
+              << "  --cascade-wait-ms N   凑批最多等待的毫秒数（默认 10）\n"
+              << "  --cascade-classes L   只对这些类别编号分类，如 0,2,7（默认全部）\n"
+              << "  --cascade-min-side N  边长小于 N 的框不分类（默认 16）\n"
+              << "  --tiles               大分辨率帧切成重叠的块分别推理，跨块 NMS 合并\n"
+              << "  --tile-size N         块边长（原图像素，默认等于模型输入尺寸）\n"
+              << "  --tile-overlap N      相邻块重叠像素（默认 64）\n"
+              << "  --tile-min-side N     帧长边超过 N 才切块（默认 1280）\n"
+              << "  --no-tile-global      不额外做整帧缩放推理\n"
+              << "  --priority P          提交优先级: live|normal|bulk\n"
+              << "  --lane-weights L,N,B  live/normal/bulk 三级调度权重（默认 8,4,1）\n";
+}
+
+int parse_pipeline_args(int argc, char **argv, PipelineConfig &cfg)
+{
+    for(int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        if(strcmp(arg, "-h") == 0 || strcmp(arg, "--help") == 0)
+        {
+            print_pipeline_usage(argv[0]);
+            return -1;
+        }
+        // 不带取值的开关
+        if(strcmp(arg, "--pace") == 0)
+        {
+            cfg.pace_realtime = true;
+            continue;
+        }
+        if(strcmp(arg, "--bench-decode") == 0)
+        {
+            cfg.bench_decode = true;
+            continue;
+        }
+        if(strcmp(arg, "--bench-similarity") == 0)
+        {
+            cfg.bench_similarity = true;
+            continue;
+        }
+        if(strcmp(arg, "--cpu-pin") == 0)
+        {
+            cfg.cpu_placement.enabled = true;
+            continue;
+        }
+        if(strcmp(arg, "--autotune") == 0)
+        {
+            cfg.autotune = true;
+            continue;
+        }
+        if(strcmp(arg, "--dump-empty") == 0)
+        {
+            cfg.dump.on_empty = true;
+            continue;
+        }
+        if(strcmp(arg, "--tiles") == 0)
+        {
+            cfg.tiling.enabled = true;
+            continue;
+        }
+        if(strcmp(arg, "--motion") == 0)
+        {
+            cfg.motion.enabled = true;
+            continue;
+        }
+        if(strcmp(arg, "--track") == 0)
+        {
+            cfg.tracker.enabled = true;
+            continue;
+        }
+        if(strcmp(arg, "--no-tile-global") == 0)
+        {
+            cfg.tiling.global_view = false;
+            continue;
+        }
+        if(i + 1 >= argc)
+        {
+            std::cerr << "参数缺少取值: " << arg << "\n";
+            return -1;
+        }
+        const char *val = argv[++i];
+
+        if(strcmp(arg, "--input") == 0)
+        {
+            // 可选的优先级前缀，例如 live:rtsp://... 或 bulk:/data/old.mp4
+            StreamSpec spec;
+            spec.path = val;
+            spec.priority = PRIORITY_NUM;  // 未指定，解析完后用 --priority 补齐
+            size_t colon = spec.path.find(':');
+            TaskPriority p;
+            if(colon != std::string::npos && parse_task_priority(spec.path.substr(0, colon), p))
+            {
+                spec.priority = p;
+                spec.path = spec.path.substr(colon + 1);
+            }
+            cfg.streams.push_back(spec);
+        }
+        else if(strcmp(arg, "--report-sec") == 0)   { cfg.report_interval_s = atoi(val); }
+        else if(strcmp(arg, "--offline-readers") == 0) { cfg.offline_readers = atoi(val); }
+        else if(strcmp(arg, "--segment-frames") == 0)  { cfg.segment_frames = atoi(val); }
+        else if(strcmp(arg, "--similarity-dim") == 0)  { cfg.similarity_dim = atoi(val); }
+        else if(strcmp(arg, "--encoders") == 0)        { cfg.encoders = atoi(val); }
+        else if(strcmp(arg, "--gop-frames") == 0)      { cfg.gop_frames = atoi(val); }
+        else if(strcmp(arg, "--segment-output") == 0)
+        {
+            if(strcmp(val, "concat") == 0)   { cfg.segment_output = SEGMENT_CONCAT; }
+            else if(strcmp(val, "hls") == 0) { cfg.segment_output = SEGMENT_HLS; }
+            else
+            {
+                std::cerr << "未知的分段输出方式: " << val << "\n";
+                return -1;
+            }
+        }
+        else if(strcmp(arg, "--output-mode") == 0)
+        {
+            if(strcmp(val, "video") == 0)        { cfg.output_mode = OUTPUT_VIDEO; }
+            else if(strcmp(val, "sidecar") == 0) { cfg.output_mode = OUTPUT_SIDECAR; }
+            else if(strcmp(val, "remux") == 0)   { cfg.output_mode = OUTPUT_REMUX; }
+            else
+            {
+                std::cerr << "未知的输出方式: " << val << "\n";
+                return -1;
+            }
+        }
+        else if(strcmp(arg, "--sidecar-format") == 0)
+        {
+            if(strcmp(val, "jsonl") == 0)    { cfg.sidecar_format = SIDECAR_JSONL; }
+            else if(strcmp(val, "bin") == 0) { cfg.sidecar_format = SIDECAR_BINARY; }
+            else
+            {
+                std::cerr << "未知的检测结果文件格式: " << val << "\n";
+                return -1;
+            }
+        }
+        else if(strcmp(arg, "--det-store") == 0)    { cfg.det_store_path = val; }
+        else if(strcmp(arg, "--profile") == 0)
+        {
+            // 在出现的位置读入，之后的 --threads 等参数可以再覆盖
+            if(!load_pipeline_profile(val, cfg))
+            {
+                return -1;
+            }
+        }
+        else if(strcmp(arg, "--pin") == 0)
+        {
+            if(!parse_cpu_placement(val, cfg.cpu_placement))
+            {
+                std::cerr << "绑核格式应为 ROLE=big|little|any|核列表: " << val << "\n";
+                return -1;
+            }
+            cfg.cpu_placement.enabled = true;
+        }
+        else if(strcmp(arg, "--autotune-frames") == 0) { cfg.autotune_frames = atoi(val); }
+        else if(strcmp(arg, "--autotune-p99-ms") == 0) { cfg.autotune_p99_ms = atof(val); }
+        else if(strcmp(arg, "--autotune-out") == 0)    { cfg.autotune_out = val; }
+        else if(strcmp(arg, "--read-queue") == 0)   { cfg.read_queue_size = atoi(val); }
+        else if(strcmp(arg, "--write-queue") == 0)  { cfg.write_queue_size = atoi(val); }
+        else if(strcmp(arg, "--output") == 0)       { cfg.output_path = val; }
+        else if(strcmp(arg, "--model") == 0)        { cfg.model_path = val; }
+        else if(strcmp(arg, "--threads") == 0)      { cfg.num_threads = atoi(val); }
+        else if(strcmp(arg, "--inflight") == 0)     { cfg.max_inflight = atoi(val); }
+        else if(strcmp(arg, "--read-policy") == 0 || strcmp(arg, "--pool-policy") == 0)
+        {
+            AdmissionConfig &ac = (arg[2] == 'r') ? cfg.read_admission : cfg.pool_admission;
+            if(!parse_admission_policy(val, ac.policy))
+            {
+                std::cerr << "未知的准入策略: " << val << "\n";
+                return -1;
+            }
+        }
+        else if(strcmp(arg, "--read-watermark") == 0) { cfg.read_admission.high_watermark = atoi(val); }
+        else if(strcmp(arg, "--pool-watermark") == 0) { cfg.pool_admission.high_watermark = atoi(val); }
+        else if(strcmp(arg, "--keep-every") == 0)
+        {
+            cfg.read_admission.keep_every_n = atoi(val);
+            cfg.pool_admission.keep_every_n = atoi(val);
+        }
+        else if(strcmp(arg, "--max-age-ms") == 0)
+        {
+            cfg.read_admission.max_frame_age_ms = atoi(val);
+            cfg.pool_admission.max_frame_age_ms = atoi(val);
+        }
+        else if(strcmp(arg, "--roi-rect") == 0 || strcmp(arg, "--roi-poly") == 0)
+        {
+            // 可选的流编号前缀，例如 1@100,200,640,360；不带前缀时作用于所有流
+            RoiSpec roi;
+            roi.stream_id = -1;
+            std::string spec = val;
+            size_t at = spec.find('@');
+            if(at != std::string::npos)
+            {
+                roi.stream_id = atoi(spec.substr(0, at).c_str());
+                spec = spec.substr(at + 1);
+            }
+            bool ok;
+            if(strcmp(arg, "--roi-rect") == 0)
+            {
+                cv::Rect rect;
+                ok = parse_roi_rect(spec, rect);
+                if(ok)
+                {
+                    RoiMask mask;
+                    mask.add_rect(rect);
+                    roi.polygon = mask.polygons[0];
+                }
+            }
+            else
+            {
+                ok = parse_roi_polygon(spec, roi.polygon);
+            }
+            if(!ok)
+            {
+                std::cerr << "感兴趣区域格式有误: " << val << "\n";
+                return -1;
+            }
+            cfg.rois.push_back(roi);
+        }
+        else if(strcmp(arg, "--motion-threshold") == 0) { cfg.motion.pixel_threshold = atoi(val); }
+        else if(strcmp(arg, "--motion-min-area") == 0)  { cfg.motion.min_area = atof(val); }
+        else if(strcmp(arg, "--motion-max-skip") == 0)  { cfg.motion.max_skip = atoi(val); }
+        else if(strcmp(arg, "--motion-width") == 0)     { cfg.motion.sample_width = atoi(val); }
+        else if(strcmp(arg, "--detect-interval") == 0) { cfg.tracker.max_interval = atoi(val); }
+        else if(strcmp(arg, "--track-iou") == 0)       { cfg.tracker.iou_threshold = (float)atof(val); }
+        else if(strcmp(arg, "--track-max-age") == 0)   { cfg.tracker.max_age = atoi(val); }
+        else if(strcmp(arg, "--cascade-model") == 0)
+        {
+            cfg.cascade.enabled = true;
+            cfg.cascade.model_path = val;
+        }
+        else if(strcmp(arg, "--trace") == 0)        { cfg.trace_path = val; }
+        else if(strcmp(arg, "--trace-buffer") == 0) { cfg.trace_buffer = (size_t)atol(val); }
+        else if(strcmp(arg, "--log-level") == 0)
+        {
+            if(!log_parse_level(val, cfg.log_level))
+            {
+                std::cerr << "未知的日志级别: " << val << "\n";
+                return -1;
+            }
+        }
+        else if(strcmp(arg, "--dump-dir") == 0)
+        {
+            cfg.dump.enabled = true;
+            cfg.dump.dir = val;
+        }
+        else if(strcmp(arg, "--dump-every") == 0)   { cfg.dump.every_n = atoi(val); }
+        else if(strcmp(arg, "--dump-slow-ms") == 0) { cfg.dump.slow_ms = atoi(val); }
+        else if(strcmp(arg, "--dump-queue") == 0)   { cfg.dump.queue_size = atoi(val); }
+        else if(strcmp(arg, "--dump-max") == 0)     { cfg.dump.max_files = atoi(val); }
+        else if(strcmp(arg, "--npu-profile") == 0)        { cfg.npu_profile_every = atoi(val); }
+        else if(strcmp(arg, "--npu-profile-report") == 0) { cfg.npu_profile_report = val; }
+        else if(strcmp(arg, "--overlay") == 0)
+        {
+            if(strcmp(val, "rga") == 0)      { cfg.overlay = OVERLAY_RGA; }
+            else if(strcmp(val, "cpu") == 0) { cfg.overlay = OVERLAY_CPU; }
+            else
+            {
+                std::cerr << "未知的画框后端: " << val << "\n";
+                return -1;
+            }
+        }
+        else if(strcmp(arg, "--cascade-labels") == 0)   { cfg.cascade.labels_path = val; }
+        else if(strcmp(arg, "--cascade-core") == 0)     { cfg.cascade.npu_core = atoi(val); }
+        else if(strcmp(arg, "--cascade-wait-ms") == 0)  { cfg.cascade.max_wait_ms = atoi(val); }
+        else if(strcmp(arg, "--cascade-min-side") == 0) { cfg.cascade.min_box_side = atoi(val); }
+        else if(strcmp(arg, "--cascade-classes") == 0)
+        {
+            cfg.cascade.classes.clear();
+            const char *p = val;
+            while(*p)
+            {
+                char *end = NULL;
+                long id = strtol(p, &end, 10);
+                if(end == p)
+                {
+                    std::cerr << "类别列表格式应为逗号分隔的编号: " << val << "\n";
+                    return -1;
+                }
+                cfg.cascade.classes.push_back((int)id);
+                p = (*end == ',') ? end + 1 : end;
+            }
+        }
+        else if(strcmp(arg, "--tile-size") == 0)     { cfg.tiling.tile_size = atoi(val); }
+        else if(strcmp(arg, "--tile-overlap") == 0)  { cfg.tiling.overlap = atoi(val); }
+        else if(strcmp(arg, "--tile-min-side") == 0) { cfg.tiling.min_frame_side = atoi(val); }
+        else if(strcmp(arg, "--deadline-ms") == 0) { cfg.deadline_ms = atoi(val); }
+        else if(strcmp(arg, "--deadline-action") == 0)
+        {
+            if(strcmp(val, "skip") == 0)         { cfg.deadline_action = DEADLINE_SKIP; }
+            else if(strcmp(val, "degrade") == 0) { cfg.deadline_action = DEADLINE_DEGRADE; }
+            else
+            {
+                std::cerr << "未知的截止时间处理方式: " << val << "\n";
+                return -1;
+            }
+        }
+        else if(strcmp(arg, "--priority") == 0)
+        {
+            if(!parse_task_priority(val, cfg.priority))
+            {
+                std::cerr << "未知的优先级: " << val << "\n";
+                return -1;
+            }
+        }
+        else if(strcmp(arg, "--lane-weights") == 0)
+        {
+            unsigned w[PRIORITY_NUM];
+            if(sscanf(val, "%u,%u,%u", &w[0], &w[1], &w[2]) != PRIORITY_NUM)
+            {
+                std::cerr << "权重格式应为 L,N,B: " << val << "\n";
+                return -1;
+            }
+            for(int p = 0; p < PRIORITY_NUM; p++) cfg.lane_weights[p] = w[p];
+        }
+        else
+        {
+            std::cerr << "未知参数: " << arg << "\n";
+            print_pipeline_usage(argv[0]);
+            return -1;
+        }
+    }
+
+    if(cfg.num_threads <= 0)  cfg.num_threads = 1;
+    if(cfg.max_inflight <= 0) cfg.max_inflight = 1;
+    if(cfg.read_queue_size == 0)  cfg.read_queue_size = 1;
+    if(cfg.write_queue_size == 0) cfg.write_queue_size = 1;
+
+    if(cfg.offline_readers > 1 && cfg.read_admission.policy != ADMIT_BLOCK)
+    {
+        // 离线分段解码要求不丢帧，否则乱序重排会一直等待被丢掉的帧
+        std::cerr << "离线分段解码模式下读端策略强制为 block\n";
+        cfg.read_admission.policy = ADMIT_BLOCK;
+    }
+
+    if(cfg.streams.empty())
+    {
+        StreamSpec spec;
+        spec.path = cfg.input_path;
+        spec.priority = PRIORITY_NUM;
+        cfg.streams.push_back(spec);
+    }
+    for(size_t i = 0; i < cfg.streams.size(); i++)
+    {
+        if(cfg.streams[i].priority == PRIORITY_NUM)
+        {
+            cfg.streams[i].priority = cfg.priority;
+        }
+    }
+    for(size_t r = 0; r < cfg.rois.size(); r++)
+    {
+        const RoiSpec &roi = cfg.rois[r];
+        if(roi.stream_id >= (int)cfg.streams.size())
+        {
+            std::cerr << "感兴趣区域的流编号超出范围: " << roi.stream_id << "\n";
+            return -1;
+        }
+        for(size_t i = 0; i < cfg.streams.size(); i++)
+        {
+            if(roi.stream_id < 0 || roi.stream_id == (int)i)
+            {
+                cfg.streams[i].roi.add_polygon(roi.polygon);
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,112 @@
+#ifndef PIPELINE_CONFIG_H
+#define PIPELINE_CONFIG_H
+
+#include <string>
+#include <vector>
+
+#include "admission.h"
+#include "thread_poll.h"
+#include "segment_writer.h"
+#include "detection_sink.h"
+#include "roi.h"
+#include "motion_gate.h"
+#include "tracker.h"
+#include "cascade.h"
+#include "debug_dump.h"
+#include "overlay_renderer.h"
+#include "logger.h"
+#include "cpu_affinity.h"
+
+// 一路输入流的描述
+struct StreamSpec
+{
+    std::string path;       // 视频文件 / 摄像头 / RTSP 地址
+    TaskPriority priority;  // 提交到线程池时的优先级
+    RoiMask roi;            // 感兴趣区域，为空表示整帧
+};
+
+// 命令行中的一个感兴趣区域，解析完所有输入后再分配到各路流
+struct RoiSpec
+{
+    int stream_id;                  // -1 表示所有流
+    std::vector<cv::Point> polygon;
+};
+
+// 流水线运行参数，默认值与原先 main.cpp 中写死的一致
+struct PipelineConfig
+{
+    std::string input_path;     // 输入视频（未指定 --input 时使用）
+    std::string output_path;    // 输出视频，多路流时自动加上 _流编号 后缀
+    std::string model_path;     // RKNN 模型
+    int num_threads;            // 线程池 worker 数
+
+    std::vector<StreamSpec> streams;  // 多路输入，--input 可重复指定
+    bool pace_realtime;         // 按帧率放帧，用本地文件模拟实时摄像头
+    int report_interval_s;      // 运行中打印各路统计的间隔（秒），<=0 不打印
+
+    int offline_readers;        // 离线分段并行解码的读线程数，<=1 时使用单读线程
+    int segment_frames;         // 分段的最小帧数（无关键帧信息时即为段长）
+    bool bench_decode;          // 只对比单读线程与分段解码的解码速度，然后退出
+    bool bench_similarity;      // 只测特征相似度矩阵 CPU 与 NPU 的分界点，然后退出
+    int similarity_dim;         // 相似度测试的特征维度
+
+    int encoders;               // 并行分段编码线程数，<=1 时使用单个 VideoWriter
+    int gop_frames;             // 每个编码分段的帧数
+    SegmentOutputMode segment_output;  // 分段编码后无损拼接还是输出分段列表
+
+    OutputMode output_mode;        // 画框重编码 / 只写检测结果 / 检测结果 + 原视频流拷贝
+    SidecarFormat sidecar_format;  // 检测结果文件格式
+    OverlayBackend overlay;        // 画框后端：RGA 或 CPU
+    std::string det_store_path;    // 列式检测结果库，空表示不写；多路流时自动加 _流编号 后缀
+    std::string trace_path;        // 时间线追踪输出（Chrome trace JSON），空表示不追踪
+    size_t trace_buffer;           // 每个线程缓冲的追踪事件数
+    LogLevel log_level;            // 运行期日志级别
+    int npu_profile_every;         // NPU 逐层分析：每 N 次推理采样一次，<=0 关闭
+    std::string npu_profile_report;  // 逐层分析报告文件
+    bool autotune;                 // 自动调参：试运行搜索 worker 数 / 在线帧窗口 / 队列深度，保存 profile 后退出
+    int autotune_frames;           // 每次试运行每路流的帧数
+    double autotune_p99_ms;        // 调参的延迟约束（端到端 p99，毫秒），<=0 不约束
+    std::string autotune_out;      // 调参结果 profile
+
+    size_t read_queue_size;     // 每路读队列容量
+    size_t write_queue_size;    // 每路写队列容量
+    int max_inflight;           // 每路聚合线程同时在线程池中的最大帧数
+
+    AdmissionConfig read_admission;  // 读线程 -> 读队列 的准入策略
+    AdmissionConfig pool_admission;  // 聚合线程 -> 线程池 的准入策略
+
+    int deadline_ms;                 // 帧截止时间（相对采集时刻，毫秒），<=0 表示不设截止
+    DeadlineAction deadline_action;  // 赶不上截止时间时跳过还是降级
+
+    TileConfig tiling;               // 大分辨率帧切块推理
+    std::vector<RoiSpec> rois;       // 各路流的感兴趣区域
+    MotionConfig motion;             // 运动门控：静止帧跳过推理
+    TrackerConfig tracker;           // 多目标跟踪与自适应检测间隔
+    CascadeConfig cascade;           // 检测框二级分类（属性识别）
+    DebugDumpConfig dump;            // 调试图片转储（默认关闭）
+    CpuPlacementConfig cpu_placement;  // 按线程职责绑核（默认关闭）
+
+    TaskPriority priority;               // 本流提交到线程池时的优先级
+    unsigned lane_weights[PRIORITY_NUM]; // 各优先级的调度权重
+
+    PipelineConfig();
+};
+
+// 解析命令行参数，成功返回 0，参数有误返回 -1
+int parse_pipeline_args(int argc, char **argv, PipelineConfig &cfg);
+void print_pipeline_usage(const char *prog);
+
+// 调参 profile：每行 key=value（workers / max_inflight / read_queue / write_queue），# 开头为注释
+bool save_pipeline_profile(const std::string &path, const PipelineConfig &cfg, const std::string &comment);
+// 读入 profile 覆盖 cfg 中对应的字段，文件不存在或格式有误返回 false
+bool load_pipeline_profile(const std::string &path, PipelineConfig &cfg);
+
+// 第 stream_id 路流的输出路径：单路时就是 output_path，多路时为 output_<id>.ext
+std::string stream_output_path(const PipelineConfig &cfg, int stream_id);
+// 第 stream_id 路流的检测结果库路径，规则同上
+std::string stream_store_path(const PipelineConfig &cfg, int stream_id);
+
+// 字符串与优先级互转："live" / "normal" / "bulk"
+bool parse_task_priority(const std::string &name, TaskPriority &priority);
+
+#endif
@@ -18,7 +18,6 @@ struct ProbArray
     int index;
 };
 cv::Mat test_img;
-static vector<string> labels;
 
 // Sigmoid 函数：计算输入值的 sigmoid 结果
 static float sigmoid(float x)
@@ -125,10 +124,50 @@ int LoadLableName(const char * filepath, vector<string> &lable_vector, int num_l
     {
         // cout << "标签数量是 " << line_num << endl;
     }
-    std::cout << "labels.size()=" << labels.size() << std::endl;
+    std::cout << "labels.size()=" << lable_vector.size() << std::endl;
     return line_num;
 }
 
+static const vector<string> &shared_labels()
+{
+    // 函数内静态变量的初始化是线程安全的，多个 worker 同时首次调用也只加载一次
+    static const vector<string> labels = []()
+    {
+        vector<string> v;
+        LoadLableName(LABLE_PATH, v, OBJ_CLASS_NUM);
+        return v;
+    }();
+    return labels;
+}
+
+const char *class_label(int class_id)
+{
+    const vector<string> &labels = shared_labels();
+    if(class_id < 0 || class_id >= (int)labels.size())
+    {
+        return "unknown";
+    }
+    return labels[class_id].c_str();
+}
+
+// 属性标签在启动时加载，之后只读，多线程查表不需要加锁
+static vector<string> attribute_labels;
+
+int load_attribute_labels(const char *path)
+{
+    attribute_labels.clear();
+    return readLines(path, attribute_labels, 65534);
+}
+
+const char *attribute_label(int attr_id)
+{
+    if(attr_id <= 0 || attr_id > (int)attribute_labels.size())
+    {
+        return "unknown";
+    }
+    return attribute_labels[attr_id - 1].c_str();
+}
+
 static float deqnt_int8_to_f32(int int_num, int32_t zp, float scale)
 {
     float float_num = (float)(int_num - zp) * scale;
@@ -277,26 +316,10 @@ inline static int clamp(float val, int min, int max) { return val > min? (val <
 int post_process(int8_t *output0, int8_t *output1, int8_t *output2,
                  int model_height, int model_width, float box_threshold,
                  float nms_threshold, float scale_w, float scale_h,
-                 std::vector<int32_t>& qnt_zps, std::vector<float>& qnt_scales, detect_result_group_t &result_group)
+                 std::vector<int32_t>& qnt_zps, std::vector<float>& qnt_scales, detect_result_group_t &result_group,
+                 const RoiMask *roi, int offset_x, int offset_y)
 {
-    // 1. 加载标签
-    static bool g_labels_loaded = false;
-    if(!g_labels_loaded)
-    {
-        // 只有第一次才加载标签文件
-        int nlines = LoadLableName(LABLE_PATH, labels, OBJ_CLASS_NUM);
-        g_labels_loaded = true;
-    }
-    else
-    {
-        // 后续不再重复加载
-        // 如果你仍想打印，可以查看 labels.size() 之类
-        // cout << "已加载过标签, labels.size()=" << labels.size() << endl;
-    }
-    // for (string &s : labels)
-    // {
-    //     cout << "lable name " << s << endl;
-    // }
+    // 1. 标签只在显示/输出时查表（class_label），这里只输出类别编号
     
     // 示例：量化和反量化测试
     int8_t int8_num = qnt_f32_to_int8(1.5, 1, 8.0f/255.0f);
@@ -345,6 +368,32 @@ int post_process(int8_t *output0, int8_t *output1, int8_t *output2,
     if (validCount < 0) {
         return 0;
     }
+
+    // 感兴趣区域：中心落在区域外的候选框在排序和 NMS 之前就丢掉
+    if(roi != NULL && !roi->empty())
+    {
+        int kept = 0;
+        for(int i = 0; i < validCount; i++)
+        {
+            float cx = (detect_boxes[4*i + 0] + detect_boxes[4*i + 2] / 2) / scale_w + offset_x;
+            float cy = (detect_boxes[4*i + 1] + detect_boxes[4*i + 3] / 2) / scale_h + offset_y;
+            if(!roi->contains(cx, cy))
+            {
+                continue;
+            }
+            if(kept != i)
+            {
+                for(int k = 0; k < 4; k++)
+                {
+                    detect_boxes[4*kept + k] = detect_boxes[4*i + k];
+                }
+                objProbs[kept] = objProbs[i];
+                classID[kept] = classID[i];
+            }
+            kept++;
+        }
+        validCount = kept;
+    }
     //printf("jiacne:%d\n",validCount);
     
     std::vector<ProbArray> prob_arr;    
@@ -370,7 +419,7 @@ int post_process(int8_t *output0, int8_t *output1, int8_t *output2,
 
     for(const int& id : class_set)
     {
-        // printf("lable num:%d,name is %s\n",id,labels[id].c_str());
+        // printf("lable num:%d,name is %s\n",id,class_label(id));
     }
     
 
@@ -380,7 +429,7 @@ int post_process(int8_t *output0, int8_t *output1, int8_t *output2,
     }
 
     int count = 0;
-    result_group.box_count = 0;
+    result_group.clear();
     
     for(int i = 0; i < validCount; i++)
     {
@@ -397,19 +446,20 @@ int post_process(int8_t *output0, int8_t *output1, int8_t *output2,
         float box_conf  = objProbs[i];
         int id          = classID[n];
 
-        result_group.result[count].box.xmin = (int)(clamp(xmin, 0, model_width) / scale_w);
-        result_group.result[count].box.ymin = (int)(clamp(ymin, 0, model_height) / scale_h);
-        result_group.result[count].box.xmax = (int)(clamp(xmax, 0, model_width) / scale_w);
-        result_group.result[count].box.ymax = (int)(clamp(ymax, 0, model_height) / scale_h);
-        result_group.result[count].box_conf = box_conf;
-
-        const char *label_temp = labels[id].c_str();
-        // 将类别名称复制到检测结果组中
-        strncpy(result_group.result[count].label, label_temp, 32);
-
-        // printf("%s\n", labels[id].c_str());
+        detect_result_t det;
+        det.box.xmin = (int16_t)(clamp(xmin, 0, model_width) / scale_w);
+        det.box.ymin = (int16_t)(clamp(ymin, 0, model_height) / scale_h);
+        det.box.xmax = (int16_t)(clamp(xmax, 0, model_width) / scale_w);
+        det.box.ymax = (int16_t)(clamp(ymax, 0, model_height) / scale_h);
+        det.box_conf = box_conf;
+        det.class_id = (uint16_t)id;
+        det.track_id = 0;
+        det.attr_id = 0;
+        det.attr_conf = 0;
+        result_group.push_back(det);
+
+        // printf("%s\n", class_label(id));
         count++;
-        result_group.box_count = count;
     }
    
     return 0;
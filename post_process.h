@@ -16,7 +16,11 @@
 #include <opencv2/highgui.hpp>
 #include <opencv2/imgproc.hpp>
 
+#include "small_vector.h"
+#include "roi.h"
+
 #define OBJ_NUM_MAX_SIZE        64
+#define OBJ_INLINE_SIZE         16   // 检测结果内联存储的框数，超过时才分配堆内存
 #define OBJ_CLASS_NUM 80
 #define LABLE_PATH "/home/orangepi/Desktop/model/coco_80_labels_list.txt"
 #define BOX_NUM_SIZE (OBJ_CLASS_NUM+5)
@@ -27,29 +31,38 @@
 
 using namespace std;
 
+// 原图像素坐标，16 位足够覆盖 8K 分辨率
 struct box_p
 {
-    int xmin;
-    int ymin;
-    int xmax;
-    int ymax;
+    int16_t xmin;
+    int16_t ymin;
+    int16_t xmax;
+    int16_t ymax;
 };
 
+// 一个检测框，20 字节；类别名只在显示/输出时通过 class_label 查表
 struct detect_result_t
 {
-    char label[32];
+    uint16_t class_id;  // 类别编号，对应标签文件中的行号
+    uint16_t track_id;  // 跟踪轨迹号，0 表示未跟踪
     float box_conf;
     box_p box;
+    uint16_t attr_id;   // 二级分类（属性）结果：0 表示未分类，否则为属性标签行号 + 1
+    uint16_t attr_conf; // 属性置信度 * 10000
 };
 
-  // 定义结构体，表示检测结果组
-struct detect_result_group_t
-{
-    int box_count;                          // 框的数量
-    detect_result_t result[OBJ_NUM_MAX_SIZE];// 检测结果数组
-};  
+// 一帧的检测结果：少量框时内联存放，拷贝只复制实际的框
+typedef SmallVector<detect_result_t, OBJ_INLINE_SIZE> detect_result_group_t;
+
+// 共享标签表：类别编号 -> 类别名，首次调用时加载标签文件（线程安全），越界时返回 "unknown"
+const char *class_label(int class_id);
+// 属性标签表：二级分类模型的标签文件，需在启动流水线之前加载一次；attr_id 无效时返回 "unknown"
+int load_attribute_labels(const char *path);
+const char *attribute_label(int attr_id);
 
 
+// roi 非空时丢掉中心不在区域内的候选框；offset_x/offset_y 为模型输入区域在原图中的左上角
 int post_process(int8_t *output0, int8_t *output1, int8_t *output2, int model_height, int model_width, float box_threshold,
-                 float nms_threshold, float scale_w, float scale_h, std::vector<int32_t>& qnt_zps, std::vector<float>& qnt_scales, detect_result_group_t& group);
+                 float nms_threshold, float scale_w, float scale_h, std::vector<int32_t>& qnt_zps, std::vector<float>& qnt_scales, detect_result_group_t& group,
+                 const RoiMask *roi = NULL, int offset_x = 0, int offset_y = 0);
 #endif
\ No newline at end of file
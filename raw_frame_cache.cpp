@@ -0,0 +1,251 @@
+#include "raw_frame_cache.h"
+
+#include <fcntl.h>
+#include <iostream>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+static uint64_t align_up(uint64_t v)
+{
+    return (v + RAW_CACHE_ALIGN - 1) / RAW_CACHE_ALIGN * RAW_CACHE_ALIGN;
+}
+
+bool is_raw_frame_cache_path(const std::string &path)
+{
+    static const std::string ext = ".rkframes";
+    return path.size() > ext.size() && path.compare(path.size() - ext.size(), ext.size(), ext) == 0;
+}
+
+//-----------------------------------
+// 生成缓存文件：先写各帧，最后追加索引并回填文件头
+//-----------------------------------
+int build_raw_frame_cache(const std::string &video_path, const std::string &cache_path, int max_frames)
+{
+    cv::VideoCapture cap(video_path);
+    if(!cap.isOpened())
+    {
+        std::cerr << "Fail to open input video: " << video_path << "\n";
+        return -1;
+    }
+    FILE *fp = fopen(cache_path.c_str(), "wb");
+    if(fp == NULL)
+    {
+        std::cerr << "Fail to create frame cache: " << cache_path << "\n";
+        return -1;
+    }
+
+    RawCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, RAW_CACHE_MAGIC, sizeof(header.magic));
+    header.version = RAW_CACHE_VERSION;
+    header.fps = cap.get(cv::CAP_PROP_FPS);
+    if(header.fps < 1.0)  // 避免某些视频元数据不完整
+    {
+        header.fps = 25.0;
+    }
+
+    std::vector<RawCacheIndexEntry> index;
+    std::vector<char> zeros(RAW_CACHE_ALIGN, 0);
+    uint64_t offset = RAW_CACHE_ALIGN;  // 第一帧紧跟在文件头所占的一页之后
+    bool ok = fwrite(zeros.data(), 1, RAW_CACHE_ALIGN, fp) == RAW_CACHE_ALIGN;
+    cv::Mat frame;
+    while(ok && (max_frames <= 0 || (int)index.size() < max_frames) && cap.read(frame))
+    {
+        if(index.empty())
+        {
+            if(frame.type() != CV_8UC3)
+            {
+                std::cerr << "Unsupported frame type: " << frame.type() << "\n";
+                ok = false;
+                break;
+            }
+            header.width = frame.cols;
+            header.height = frame.rows;
+            header.type = frame.type();
+            header.step = (uint32_t)(frame.cols * frame.elemSize());
+            header.frame_bytes = align_up((uint64_t)header.step * frame.rows);
+        }
+        else if(frame.cols != (int)header.width || frame.rows != (int)header.height)
+        {
+            std::cerr << "Frame size changed at frame " << index.size() << ", stop here\n";
+            break;
+        }
+
+        // 逐行写，解码器给出的帧行之间可能有填充
+        for(int r = 0; r < frame.rows && ok; r++)
+        {
+            ok = fwrite(frame.ptr(r), 1, header.step, fp) == header.step;
+        }
+        size_t pad = (size_t)(header.frame_bytes - (uint64_t)header.step * frame.rows);
+        if(ok && pad > 0)
+        {
+            ok = fwrite(zeros.data(), 1, pad, fp) == pad;
+        }
+
+        RawCacheIndexEntry entry;
+        entry.offset = offset;
+        entry.pts_ms = cap.get(cv::CAP_PROP_POS_MSEC);
+        if(entry.pts_ms < 0)
+        {
+            entry.pts_ms = index.size() * 1000.0 / header.fps;
+        }
+        index.push_back(entry);
+        offset += header.frame_bytes;
+    }
+
+    header.frame_count = (uint32_t)index.size();
+    header.index_offset = offset;
+    if(ok && !index.empty())
+    {
+        size_t bytes = index.size() * sizeof(RawCacheIndexEntry);
+        ok = fwrite(index.data(), 1, bytes, fp) == bytes;
+    }
+    if(ok)
+    {
+        ok = fseek(fp, 0, SEEK_SET) == 0 && fwrite(&header, 1, sizeof(header), fp) == sizeof(header);
+    }
+    if(fclose(fp) != 0)
+    {
+        ok = false;
+    }
+    if(!ok || index.empty())
+    {
+        std::cerr << "Fail to write frame cache: " << cache_path << "\n";
+        return -1;
+    }
+    return (int)index.size();
+}
+
+// 读入并校验文件头
+static bool read_header(int fd, const std::string &path, RawCacheHeader &header, uint64_t file_size)
+{
+    if(pread(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+       memcmp(header.magic, RAW_CACHE_MAGIC, sizeof(header.magic)) != 0)
+    {
+        std::cerr << "Not a frame cache file: " << path << "\n";
+        return false;
+    }
+    if(header.version != RAW_CACHE_VERSION || header.type != (uint32_t)CV_8UC3)
+    {
+        std::cerr << "Unsupported frame cache version/type: " << path << "\n";
+        return false;
+    }
+    if(header.frame_count == 0 ||
+       header.index_offset + (uint64_t)header.frame_count * sizeof(RawCacheIndexEntry) > file_size)
+    {
+        std::cerr << "Truncated frame cache file: " << path << "\n";
+        return false;
+    }
+    return true;
+}
+
+bool print_raw_frame_cache_info(const std::string &cache_path)
+{
+    int fd = ::open(cache_path.c_str(), O_RDONLY);
+    if(fd < 0)
+    {
+        std::cerr << "Fail to open frame cache: " << cache_path << "\n";
+        return false;
+    }
+    struct stat st;
+    RawCacheHeader header;
+    bool ok = fstat(fd, &st) == 0 && read_header(fd, cache_path, header, (uint64_t)st.st_size);
+    ::close(fd);
+    if(!ok)
+    {
+        return false;
+    }
+    std::cout << cache_path << ": " << header.width << "x" << header.height << " " << header.frame_count
+              << " 帧, " << header.fps << " fps, 每帧 " << header.frame_bytes << " 字节, 文件 "
+              << st.st_size / (1024.0 * 1024.0) << " MB" << std::endl;
+    return true;
+}
+
+//-----------------------------------
+// 映射重放
+//-----------------------------------
+MmapFrameSource::MmapFrameSource(const std::string &path_in, bool pace, int loops_in)
+    : path(path_in), pace_realtime(pace), loops(loops_in > 0 ? loops_in : 1),
+      fd(-1), base(NULL), mapped_bytes(0), index(NULL), next_frame(0), loop(0), pts_ms(-1.0)
+{
+    memset(&header, 0, sizeof(header));
+}
+
+MmapFrameSource::~MmapFrameSource()
+{
+    if(base != NULL)
+    {
+        munmap(base, mapped_bytes);
+    }
+    if(fd >= 0)
+    {
+        ::close(fd);
+    }
+}
+
+bool MmapFrameSource::open()
+{
+    fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+    {
+        std::cerr << "Fail to open frame cache: " << path << "\n";
+        return false;
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0 || !read_header(fd, path, header, (uint64_t)st.st_size))
+    {
+        return false;
+    }
+
+    // 只读映射：帧不会被改写，循环重放时每一遍看到的都是原始帧，也不会产生写时复制的页
+    mapped_bytes = (size_t)st.st_size;
+    void *p = mmap(NULL, mapped_bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(p == MAP_FAILED)
+    {
+        std::cerr << "Fail to mmap frame cache: " << path << "\n";
+        return false;
+    }
+    base = (uint8_t *)p;
+    index = (const RawCacheIndexEntry *)(base + header.index_offset);
+
+    // 顺序读取并提前读入页缓存，重放时不被磁盘拖慢
+    madvise(base, mapped_bytes, MADV_SEQUENTIAL);
+    madvise(base, mapped_bytes, MADV_WILLNEED);
+
+    next_frame = 0;
+    loop = 0;
+    next_frame_time = std::chrono::steady_clock::now();
+    return true;
+}
+
+bool MmapFrameSource::read(cv::Mat &frame)
+{
+    if(next_frame >= header.frame_count)
+    {
+        if(++loop >= loops)
+        {
+            return false;
+        }
+        next_frame = 0;
+    }
+    if(pace_realtime)
+    {
+        // 模拟摄像头：按帧率等待下一帧的到达时刻
+        std::this_thread::sleep_until(next_frame_time);
+        next_frame_time += std::chrono::microseconds(static_cast<int64_t>(1e6 / header.fps));
+    }
+
+    const RawCacheIndexEntry &entry = index[next_frame];
+    // 不拷贝：Mat 直接指向映射内存，映射在 source 析构前一直有效
+    frame = cv::Mat((int)header.height, (int)header.width, (int)header.type, base + entry.offset, header.step);
+    // 循环重放时时间戳接着上一轮递增
+    double loop_ms = (index[header.frame_count - 1].pts_ms + 1000.0 / header.fps) * loop;
+    pts_ms = entry.pts_ms + loop_ms;
+    next_frame++;
+    return true;
+}
@@ -0,0 +1,89 @@
+#ifndef RAW_FRAME_CACHE_H
+#define RAW_FRAME_CACHE_H
+
+#include <chrono>
+#include <stdint.h>
+#include <string>
+#include <opencv2/opencv.hpp>
+
+#include "frame_source.h"
+
+//-----------------------------------
+// 预解码的原始帧缓存文件（.rkframes）
+//   [0, 4096)            头：魔数、版本、宽高、像素类型、行字节数、帧数、帧率、索引位置
+//   [4096, ...)          各帧原始像素，每帧按 4096 对齐，可以直接 mmap 后当作 cv::Mat 使用
+//   index_offset 起      索引：每帧一项（数据偏移 + 时间戳），写完所有帧后追加
+// 解码一次，之后每次压测都按内存速度重放，排除解码速度波动与解码占用 CPU 的影响
+//-----------------------------------
+
+#define RAW_CACHE_MAGIC   "RKFRAME1"
+#define RAW_CACHE_VERSION 1
+#define RAW_CACHE_ALIGN   4096
+
+struct RawCacheHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t type;          // OpenCV 像素类型，目前只有 CV_8UC3
+    uint32_t step;          // 每行字节数
+    uint32_t frame_count;
+    double fps;
+    uint64_t frame_bytes;   // 每帧占用的字节数（已按 RAW_CACHE_ALIGN 对齐）
+    uint64_t index_offset;  // 索引在文件中的偏移
+};
+
+struct RawCacheIndexEntry
+{
+    uint64_t offset;  // 帧数据在文件中的偏移
+    double pts_ms;    // 帧在原视频中的时间戳
+};
+
+// 把视频解码成缓存文件，max_frames<=0 表示全部帧；返回写入的帧数，失败返回 -1
+int build_raw_frame_cache(const std::string &video_path, const std::string &cache_path, int max_frames);
+// 打印缓存文件的头信息，失败返回 false
+bool print_raw_frame_cache_info(const std::string &cache_path);
+// 路径是否为缓存文件（按扩展名判断）
+bool is_raw_frame_cache_path(const std::string &path);
+
+//-----------------------------------
+// 从缓存文件重放帧：整个文件只读映射，read 返回的 cv::Mat 直接指向映射内存，不拷贝。
+//   帧是只读的：需要画框时由调用方先拷贝（见 StreamPipeline::readThreadFunc）
+//   loops>1 时循环重放，帧号与时间戳继续递增
+//-----------------------------------
+class MmapFrameSource : public FrameSource
+{
+public:
+    MmapFrameSource(const std::string &path, bool pace_realtime = false, int loops = 1);
+    ~MmapFrameSource();
+
+    bool open();
+    bool read(cv::Mat &frame);
+    double last_pts_ms() const { return pts_ms; }
+    // 各帧在映射中互不重叠，读下一帧不会覆盖上一帧
+    bool frames_persistent() const { return true; }
+
+    int width() const { return (int)header.width; }
+    int height() const { return (int)header.height; }
+    double fps() const { return header.fps; }
+    std::string name() const { return path; }
+
+private:
+    std::string path;
+    bool pace_realtime;
+    int loops;
+
+    int fd;
+    uint8_t *base;
+    size_t mapped_bytes;
+    RawCacheHeader header;
+    const RawCacheIndexEntry *index;
+
+    uint32_t next_frame;
+    int loop;
+    double pts_ms;
+    std::chrono::steady_clock::time_point next_frame_time;
+};
+
+#endif
@@ -0,0 +1,120 @@
+#include "roi.h"
+
+#include <algorithm>
+#include <stdlib.h>
+
+void RoiMask::add_polygon(const std::vector<cv::Point> &poly)
+{
+    if(poly.size() < 3)
+    {
+        return;
+    }
+    int x0 = poly[0].x, y0 = poly[0].y, x1 = poly[0].x, y1 = poly[0].y;
+    for(size_t i = 1; i < poly.size(); i++)
+    {
+        x0 = std::min(x0, poly[i].x);
+        y0 = std::min(y0, poly[i].y);
+        x1 = std::max(x1, poly[i].x);
+        y1 = std::max(y1, poly[i].y);
+    }
+    if(!polygons.empty())
+    {
+        x0 = std::min(x0, bounds.x);
+        y0 = std::min(y0, bounds.y);
+        x1 = std::max(x1, bounds.x + bounds.width);
+        y1 = std::max(y1, bounds.y + bounds.height);
+    }
+    bounds = cv::Rect(x0, y0, x1 - x0, y1 - y0);
+    polygons.push_back(poly);
+}
+
+void RoiMask::add_rect(const cv::Rect &rect)
+{
+    std::vector<cv::Point> poly;
+    poly.push_back(cv::Point(rect.x, rect.y));
+    poly.push_back(cv::Point(rect.x + rect.width, rect.y));
+    poly.push_back(cv::Point(rect.x + rect.width, rect.y + rect.height));
+    poly.push_back(cv::Point(rect.x, rect.y + rect.height));
+    add_polygon(poly);
+}
+
+// 射线法判断点是否在多边形内
+static bool point_in_polygon(const std::vector<cv::Point> &poly, float x, float y)
+{
+    bool inside = false;
+    for(size_t i = 0, j = poly.size() - 1; i < poly.size(); j = i++)
+    {
+        float xi = poly[i].x, yi = poly[i].y;
+        float xj = poly[j].x, yj = poly[j].y;
+        if(((yi > y) != (yj > y)) && (x < (xj - xi) * (y - yi) / (yj - yi) + xi))
+        {
+            inside = !inside;
+        }
+    }
+    return inside;
+}
+
+bool RoiMask::contains(float x, float y) const
+{
+    if(x < bounds.x || y < bounds.y || x > bounds.x + bounds.width || y > bounds.y + bounds.height)
+    {
+        return false;
+    }
+    for(size_t i = 0; i < polygons.size(); i++)
+    {
+        if(point_in_polygon(polygons[i], x, y))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static std::vector<int> parse_int_list(const std::string &spec)
+{
+    std::vector<int> values;
+    const char *p = spec.c_str();
+    while(*p != '\0')
+    {
+        char *end = NULL;
+        long v = strtol(p, &end, 10);
+        if(end == p)
+        {
+            values.clear();
+            return values;
+        }
+        values.push_back((int)v);
+        p = end;
+        if(*p == ',')
+        {
+            p++;
+        }
+    }
+    return values;
+}
+
+bool parse_roi_rect(const std::string &spec, cv::Rect &rect)
+{
+    std::vector<int> v = parse_int_list(spec);
+    if(v.size() != 4 || v[2] <= 0 || v[3] <= 0)
+    {
+        return false;
+    }
+    rect = cv::Rect(v[0], v[1], v[2], v[3]);
+    return true;
+}
+
+bool parse_roi_polygon(const std::string &spec, std::vector<cv::Point> &poly)
+{
+    std::vector<int> v = parse_int_list(spec);
+    if(v.size() < 6 || v.size() % 2 != 0)
+    {
+        return false;
+    }
+    poly.clear();
+    for(size_t i = 0; i < v.size(); i += 2)
+    {
+        poly.push_back(cv::Point(v[i], v[i + 1]));
+    }
+    return true;
+}
@@ -0,0 +1,29 @@
+#ifndef ROI_H
+#define ROI_H
+
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+//-----------------------------------
+// 感兴趣区域：一个或多个多边形（矩形按四边形存）
+//   预处理只裁剪所有多边形的外接矩形送入模型，分辨率都用在关心的区域上；
+//   后处理在 NMS 之前丢掉中心落在多边形外的候选框
+//-----------------------------------
+struct RoiMask
+{
+    std::vector<std::vector<cv::Point> > polygons;
+    cv::Rect bounds;  // 所有多边形的外接矩形
+
+    bool empty() const { return polygons.empty(); }
+    void add_polygon(const std::vector<cv::Point> &poly);
+    void add_rect(const cv::Rect &rect);
+    // 点是否落在任一多边形内
+    bool contains(float x, float y) const;
+};
+
+// 解析 "x,y,w,h"（矩形）或 "x1,y1,x2,y2,x3,y3,..."（多边形，至少 3 个点），成功返回 true
+bool parse_roi_rect(const std::string &spec, cv::Rect &rect);
+bool parse_roi_polygon(const std::string &spec, std::vector<cv::Point> &poly);
+
+#endif
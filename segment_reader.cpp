@@ -0,0 +1,278 @@
+#include "segment_reader.h"
+#include "trace.h"
+#include "cpu_affinity.h"
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+
+std::vector<int> probe_keyframes(const std::string &path)
+{
+    std::vector<int> keyframes;
+
+    // 逐个列出视频包的 flags，带 K 的是关键帧；包的序号即解码顺序下的帧号
+    std::string cmd = "ffprobe -v error -select_streams v:0 -show_entries packet=flags -of csv=p=0 " + shell_quote(path) + " 2>/dev/null";
+    FILE *fp = popen(cmd.c_str(), "r");
+    if(fp == NULL)
+    {
+        return keyframes;
+    }
+
+    char line[64];
+    int frame_no = 0;
+    while(fgets(line, sizeof(line), fp) != NULL)
+    {
+        if(line[0] == 'K')
+        {
+            keyframes.push_back(frame_no);
+        }
+        frame_no++;
+    }
+    pclose(fp);
+    return keyframes;
+}
+
+std::vector<VideoSegment> plan_segments(const std::vector<int> &keyframes, int total_frames, int min_frames)
+{
+    std::vector<VideoSegment> segments;
+    if(min_frames <= 0) min_frames = 1;
+
+    // 候选切分点：关键帧；没有关键帧信息时按 min_frames 均匀切分（seek 会自动从前一个关键帧解码到目标帧）
+    std::vector<int> cuts;
+    if(!keyframes.empty())
+    {
+        cuts = keyframes;
+    }
+    else if(total_frames > 0)
+    {
+        for(int f = 0; f < total_frames; f += min_frames)
+        {
+            cuts.push_back(f);
+        }
+    }
+    if(cuts.empty() || cuts[0] != 0)
+    {
+        cuts.insert(cuts.begin(), 0);
+    }
+
+    // 相邻关键帧太近时合并，保证每段至少 min_frames 帧，摊薄每段 seek 的开销
+    int seg_start = 0;
+    for(size_t i = 1; i < cuts.size(); i++)
+    {
+        if(cuts[i] - seg_start >= min_frames)
+        {
+            VideoSegment seg = { seg_start, cuts[i] };
+            segments.push_back(seg);
+            seg_start = cuts[i];
+        }
+    }
+    // 最后一段读到文件结尾，不依赖可能不准确的总帧数
+    VideoSegment last = { seg_start, -1 };
+    segments.push_back(last);
+    return segments;
+}
+
+SegmentedReader::SegmentedReader(const std::string &path_in, int readers, int min_frames, int window)
+    : path(path_in), num_readers(readers > 0 ? readers : 1), min_segment_frames(min_frames),
+      window_frames(window), next_segment(0), decoded(0), write_frontier(0), first_pending(0)
+{
+}
+
+int SegmentedReader::prepare()
+{
+    cv::VideoCapture cap(path);
+    if(!cap.isOpened())
+    {
+        std::cerr << "Fail to open input video: " << path << "\n";
+        return -1;
+    }
+    int total_frames = static_cast<int>(cap.get(cv::CAP_PROP_FRAME_COUNT));
+    cap.release();
+
+    std::vector<int> keyframes = probe_keyframes(path);
+    if(keyframes.empty())
+    {
+        std::cerr << "[SegmentedReader] ffprobe 不可用，按 " << min_segment_frames << " 帧均匀分段\n";
+    }
+    segments = plan_segments(keyframes, total_frames, min_segment_frames);
+
+    // 窗口至少要容纳所有读线程各自正在解码的一段，否则读线程之间会互相等待
+    int longest = min_segment_frames;
+    for(size_t i = 0; i + 1 < segments.size(); i++)
+    {
+        longest = std::max(longest, segments[i].end - segments[i].start);
+    }
+    if(window_frames < longest * num_readers)
+    {
+        window_frames = longest * num_readers;
+    }
+
+    std::cout << "[SegmentedReader] 关键帧=" << keyframes.size() << " 分段=" << segments.size()
+              << " 读线程=" << num_readers << " 窗口=" << window_frames << " 帧\n";
+    return (int)segments.size();
+}
+
+void SegmentedReader::run(const std::function<void(FrameData &)> &emit)
+{
+    next_segment = 0;
+    {
+        std::unique_lock<std::mutex> lock(window_mutex);
+        segment_done.assign(segments.size(), 0);
+        first_pending = 0;
+    }
+    std::vector<std::thread> readers;
+    for(int i = 0; i < num_readers; i++)
+    {
+        readers.emplace_back(&SegmentedReader::reader_loop, this, i, std::cref(emit));
+    }
+    for(auto &t : readers)
+    {
+        t.join();
+    }
+    // 所有读线程都打不开文件时没有人领段：读线程都退出了，剩下的段也不会再有帧
+    for(size_t i = 0; i < segments.size(); i++)
+    {
+        mark_segment_done((int)i);
+    }
+}
+
+void SegmentedReader::mark_segment_done(int seg_id)
+{
+    std::unique_lock<std::mutex> lock(window_mutex);
+    segment_done[seg_id] = 1;
+    while(first_pending < (int)segment_done.size() && segment_done[first_pending])
+    {
+        first_pending++;
+    }
+}
+
+int SegmentedReader::pending_frontier()
+{
+    std::unique_lock<std::mutex> lock(window_mutex);
+    if(first_pending >= (int)segments.size())
+    {
+        return INT_MAX;
+    }
+    return segments[first_pending].start;
+}
+
+void SegmentedReader::on_frames_written(int next_write_index)
+{
+    {
+        std::unique_lock<std::mutex> lock(window_mutex);
+        write_frontier = next_write_index;
+    }
+    window_cond.notify_all();
+}
+
+void SegmentedReader::reader_loop(int reader_id, const std::function<void(FrameData &)> &emit)
+{
+    trace_set_thread_name("segment reader " + std::to_string(reader_id));
+    pin_current_thread(THREAD_ROLE_READ);
+    cv::VideoCapture cap(path);
+    if(!cap.isOpened())
+    {
+        // 打开失败时一段也不领，所有段由其他读线程解码
+        std::cerr << "[SegmentedReader " << reader_id << "] open failed.\n";
+        return;
+    }
+
+    while(true)
+    {
+        int seg_id = next_segment++;
+        if(seg_id >= (int)segments.size())
+        {
+            break;
+        }
+        const VideoSegment &seg = segments[seg_id];
+
+        // 段首离已写出帧太远就先等待，避免乱序结果在重排窗口里无限堆积
+        {
+            std::unique_lock<std::mutex> lock(window_mutex);
+            window_cond.wait(lock, [this, &seg]
+            {
+                return seg.start < write_frontier + window_frames;
+            });
+        }
+
+        // seek 到段首（关键帧），逐帧解码直到段尾
+        int idx = seg.start;
+        if(seg.start > 0)
+        {
+            cap.set(cv::CAP_PROP_POS_FRAMES, seg.start);
+            // seek 不一定精确落在段首（均匀分段时段首不是关键帧，或关键帧号与解码器计数不一致）：
+            // 落在前面就空解码追上；落在后面就从实际位置开始编号，中间缺的帧由下游跳过
+            int pos = static_cast<int>(cap.get(cv::CAP_PROP_POS_FRAMES));
+            while(pos >= 0 && pos < seg.start && cap.grab())
+            {
+                pos++;
+            }
+            if(pos > seg.start)
+            {
+                std::cerr << "[SegmentedReader " << reader_id << "] 段 " << seg_id << " seek 到 " << pos
+                          << "，段首应为 " << seg.start << "\n";
+                idx = pos;
+            }
+        }
+        while(seg.end < 0 || idx < seg.end)
+        {
+            cv::Mat frame;
+            int64_t decode_begin = stage_now_us();
+            if(!cap.read(frame))
+            {
+                if(seg.end >= 0)
+                {
+                    std::cerr << "[SegmentedReader " << reader_id << "] 段 " << seg_id << " 在帧 " << idx
+                              << " 提前结束，应到 " << seg.end << "\n";
+                }
+                break;
+            }
+            FrameData data{ frame, idx++, std::chrono::steady_clock::now(), cap.get(cv::CAP_PROP_POS_MSEC) };
+            data.timestamps.t[TS_DECODE_BEGIN] = decode_begin;
+            data.timestamps.mark(TS_DECODE_END);
+            trace_complete("decode", decode_begin, data.timestamps.t[TS_DECODE_END], data.index);
+            decoded++;
+            emit(data);
+        }
+        // 段内的帧都已交给 emit（放进了读队列），之后下游可以放心跳过这一段里缺的帧号
+        mark_segment_done(seg_id);
+    }
+    std::cerr << "[SegmentedReader " << reader_id << "] finished.\n";
+}
+
+void benchmark_segment_decode(const std::string &path, int num_readers, int min_segment_frames)
+{
+    // 1) 单读线程基线
+    auto t0 = std::chrono::steady_clock::now();
+    uint64_t single_frames = 0;
+    {
+        cv::VideoCapture cap(path);
+        cv::Mat frame;
+        while(cap.read(frame))
+        {
+            single_frames++;
+        }
+    }
+    double single_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    // 2) 分段并行解码，窗口不设限，只测解码本身
+    SegmentedReader reader(path, num_readers, min_segment_frames, 1 << 30);
+    if(reader.prepare() < 0)
+    {
+        return;
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    reader.run([](FrameData &) {});
+    double multi_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t1).count();
+
+    double single_fps = single_s > 0 ? single_frames / single_s : 0;
+    double multi_fps = multi_s > 0 ? reader.frames_decoded() / multi_s : 0;
+    std::cout << "[DecodeBench] 单读线程: " << single_frames << " 帧 " << single_s << " s, " << single_fps << " FPS\n"
+              << "[DecodeBench] " << num_readers << " 读线程分段: " << reader.frames_decoded() << " 帧 "
+              << multi_s << " s, " << multi_fps << " FPS\n"
+              << "[DecodeBench] 加速比: " << (single_fps > 0 ? multi_fps / single_fps : 0) << "x\n";
+}
@@ -0,0 +1,75 @@
+#ifndef SEGMENT_READER_H
+#define SEGMENT_READER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "frame_source.h"
+
+// 一个按关键帧对齐的解码段：[start, end) 帧号，end<0 表示读到文件结尾
+struct VideoSegment {
+    int start;
+    int end;
+};
+
+// 用 ffprobe 列出视频流关键帧所在的帧号（解码顺序），ffprobe 不可用时返回空
+std::vector<int> probe_keyframes(const std::string &path);
+
+// 按关键帧把视频切成若干段，每段至少 min_frames 帧；没有关键帧信息时按 min_frames 均匀切分
+std::vector<VideoSegment> plan_segments(const std::vector<int> &keyframes, int total_frames, int min_frames);
+
+//-----------------------------------
+// 离线并行解码：多个读线程各自打开文件、seek 到段首并解码整段，
+// 帧带全局下标交给 emit，由下游乱序推理后按下标重排
+//-----------------------------------
+class SegmentedReader
+{
+public:
+    // window_frames：读线程最多领先已写出帧多少帧，用于限制在途帧的内存
+    SegmentedReader(const std::string &path, int num_readers, int min_segment_frames, int window_frames);
+
+    // 探测关键帧并规划分段，返回段数，失败返回 -1
+    int prepare();
+
+    // 启动读线程并阻塞到所有段解码完成
+    void run(const std::function<void(FrameData &)> &emit);
+
+    // 下游每按序写出一帧调用一次，推进读线程的窗口
+    void on_frames_written(int next_write_index);
+
+    // 此帧号之前的帧要么已经交给 emit，要么永远不会再来（所在段已解码完或中途失败）；
+    // 全部段都结束时返回 INT_MAX。下游据此跳过缺号，不会一直等下去
+    int pending_frontier();
+
+    int num_segments() const { return (int)segments.size(); }
+    uint64_t frames_decoded() const { return decoded.load(); }
+
+private:
+    void reader_loop(int reader_id, const std::function<void(FrameData &)> &emit);
+    void mark_segment_done(int seg_id);
+
+    std::string path;
+    int num_readers;
+    int min_segment_frames;
+    int window_frames;
+
+    std::vector<VideoSegment> segments;
+    std::atomic<int> next_segment;
+    std::atomic<uint64_t> decoded;
+
+    // 已写出帧的前沿，读线程只在段首落在 前沿+窗口 以内时开始解码
+    std::mutex window_mutex;
+    std::condition_variable window_cond;
+    int write_frontier;
+    std::vector<char> segment_done;  // 各段是否已结束（读完、中途失败都算），受 window_mutex 保护
+    int first_pending;               // 第一个未结束的段
+};
+
+// 对比单读线程与多读线程分段解码的纯解码速度，打印加速比
+void benchmark_segment_decode(const std::string &path, int num_readers, int min_segment_frames);
+
+#endif
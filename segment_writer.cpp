@@ -0,0 +1,245 @@
+#include "segment_writer.h"
+#include "cpu_affinity.h"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+
+SegmentedVideoSink::SegmentedVideoSink(const std::string &path_in, int encoders_in, int gop, SegmentOutputMode mode_in)
+    : path(path_in), num_encoders(encoders_in > 0 ? encoders_in : 1), gop_frames(gop > 0 ? gop : 50),
+      mode(mode_in), width(0), height(0), fps(25.0), next_seg_id(0),
+      chunks(encoders_in > 0 ? encoders_in : 1), frames_lost(0), frames_encoded(0), closed(false)
+{
+    base = path;
+    size_t dot = path.find_last_of('.');
+    size_t slash = path.find_last_of('/');
+    if(dot != std::string::npos && (slash == std::string::npos || dot > slash))
+    {
+        base = path.substr(0, dot);
+        ext = path.substr(dot);
+    }
+    else
+    {
+        ext = ".avi";
+    }
+    if(mode == SEGMENT_HLS)
+    {
+        // HLS 播放器只接受 MPEG-TS（或 fMP4）分段
+        ext = ".ts";
+    }
+}
+
+SegmentedVideoSink::~SegmentedVideoSink()
+{
+    close();
+}
+
+std::string SegmentedVideoSink::segment_path(int seg_id) const
+{
+    char name[32];
+    snprintf(name, sizeof(name), "_seg%05d", seg_id);
+    return base + name + ext;
+}
+
+bool SegmentedVideoSink::open(int width_in, int height_in, double fps_in)
+{
+    width = width_in;
+    height = height_in;
+    fps = fps_in;
+    open_time = std::chrono::steady_clock::now();
+
+    // 启动编码线程，每个线程一次编码一个 GOP 块
+    for(int i = 0; i < num_encoders; i++)
+    {
+        encoders.emplace_back(&SegmentedVideoSink::encoder_loop, this, i);
+    }
+    return true;
+}
+
+void SegmentedVideoSink::write(const FrameData &fd)
+{
+    if(fd.frame.empty())
+    {
+        return;
+    }
+    if(current.frames.empty())
+    {
+        current.seg_id = next_seg_id++;
+        current.frames.reserve(gop_frames);
+    }
+    current.frames.push_back(fd.frame);
+
+    // 攒满一个 GOP 就交给编码线程；队列满时阻塞写线程，限制在途内存
+    if((int)current.frames.size() >= gop_frames)
+    {
+        chunks.enqueue(current);
+        current.frames.clear();
+    }
+}
+
+void SegmentedVideoSink::encoder_loop(int encoder_id)
+{
+    pin_current_thread(THREAD_ROLE_WRITE);
+    int fourcc = cv::VideoWriter::fourcc('H','2','6','4');
+    EncodeChunk chunk;
+    while(chunks.dequeue(chunk))
+    {
+        // 每块都新开一个 writer，段首自然是关键帧，段与段之间可以无损拼接
+        cv::VideoWriter writer(segment_path(chunk.seg_id), fourcc, fps, cv::Size(width, height));
+        if(!writer.isOpened())
+        {
+            std::cerr << "[Encoder " << encoder_id << "] Fail to create segment: " << segment_path(chunk.seg_id)
+                      << "，丢失 " << chunk.frames.size() << " 帧\n";
+            record_segment(chunk.seg_id, (int)chunk.frames.size(), false);
+            continue;
+        }
+        for(size_t i = 0; i < chunk.frames.size(); i++)
+        {
+            writer.write(chunk.frames[i]);
+        }
+        writer.release();
+        frames_encoded += chunk.frames.size();
+        record_segment(chunk.seg_id, (int)chunk.frames.size(), true);
+    }
+}
+
+void SegmentedVideoSink::record_segment(int seg_id, int frames, bool ok)
+{
+    std::unique_lock<std::mutex> lock(seg_mutex);
+    if((int)seg_frames.size() <= seg_id)
+    {
+        seg_frames.resize(seg_id + 1, 0);
+        seg_ok.resize(seg_id + 1, 0);
+    }
+    seg_frames[seg_id] = frames;
+    seg_ok[seg_id] = ok ? 1 : 0;
+    if(!ok)
+    {
+        frames_lost += frames;
+    }
+}
+
+bool SegmentedVideoSink::write_playlist()
+{
+    std::string list_path = base + ".m3u8";
+    std::ofstream out(list_path.c_str());
+    if(!out.is_open())
+    {
+        std::cerr << "Fail to create playlist: " << list_path << "\n";
+        return false;
+    }
+
+    double target = gop_frames / fps;
+    out << "#EXTM3U\n"
+        << "#EXT-X-VERSION:3\n"
+        << "#EXT-X-TARGETDURATION:" << (int)(target + 0.999) << "\n"
+        << "#EXT-X-MEDIA-SEQUENCE:0\n";
+    bool first = true;
+    for(size_t i = 0; i < seg_frames.size(); i++)
+    {
+        if(!seg_ok[i])
+        {
+            continue;
+        }
+        std::string seg = segment_path((int)i);
+        std::string seg_name = seg.substr(seg.find_last_of('/') + 1);
+        if(!first)
+        {
+            // 每段单独编码，时间戳都从 0 开始
+            out << "#EXT-X-DISCONTINUITY\n";
+        }
+        out << "#EXTINF:" << seg_frames[i] / fps << ",\n" << seg_name << "\n";
+        first = false;
+    }
+    out << "#EXT-X-ENDLIST\n";
+    std::cout << "[SegmentedVideoSink] 分段列表: " << list_path << "\n";
+    return true;
+}
+
+bool SegmentedVideoSink::concat_segments()
+{
+    // ffmpeg concat 分离器 + 流拷贝：只重新封装，不重新编码
+    std::string list_path = base + "_concat.txt";
+    int good = 0;
+    {
+        std::ofstream out(list_path.c_str());
+        // concat 列表里的相对路径是相对列表文件所在目录解析的，只写文件名；编码失败的分段不存在，不能列进去
+        for(size_t i = 0; i < seg_frames.size(); i++)
+        {
+            if(!seg_ok[i])
+            {
+                continue;
+            }
+            good++;
+            std::string seg = segment_path((int)i);
+            // concat 列表的引号规则与 shell 单引号相同
+            out << "file " << shell_quote(seg.substr(seg.find_last_of('/') + 1)) << "\n";
+        }
+    }
+    if(good == 0)
+    {
+        std::cerr << "[SegmentedVideoSink] 没有编码成功的分段，不生成 " << path << "\n";
+        remove(list_path.c_str());
+        return false;
+    }
+    std::string cmd = "ffmpeg -y -loglevel error -f concat -safe 0 -i " + shell_quote(list_path) + " -c copy " +
+                      shell_quote(path);
+    int ret = system(cmd.c_str());
+    if(ret != 0)
+    {
+        std::cerr << "[SegmentedVideoSink] ffmpeg 拼接失败(" << ret << ")，保留分段文件与拼接列表 " << list_path
+                  << "（可用 ffmpeg -f concat -safe 0 -i 列表 -c copy 输出 手动拼接）\n";
+        return false;
+    }
+
+    for(size_t i = 0; i < seg_frames.size(); i++)
+    {
+        remove(segment_path((int)i).c_str());
+    }
+    remove(list_path.c_str());
+    std::cout << "[SegmentedVideoSink] 已无损拼接 " << good << " 个分段到 " << path << "\n";
+    return true;
+}
+
+void SegmentedVideoSink::close()
+{
+    if(closed || encoders.empty())
+    {
+        return;
+    }
+    closed = true;
+
+    auto t0 = std::chrono::steady_clock::now();
+    // 最后一个不满 GOP 的块
+    if(!current.frames.empty())
+    {
+        chunks.enqueue(current);
+        current.frames.clear();
+    }
+    chunks.stop();
+    for(auto &t : encoders)
+    {
+        t.join();
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    double drain_s = std::chrono::duration<double>(t1 - t0).count();
+    double total_s = std::chrono::duration<double>(t1 - open_time).count();
+    std::cout << "[SegmentedVideoSink] " << num_encoders << " 个编码线程共编码 " << frames_encoded.load()
+              << " 帧，平均 " << (total_s > 0 ? frames_encoded.load() / total_s : 0) << " FPS，收尾耗时 "
+              << drain_s << " s\n";
+    if(frames_lost > 0)
+    {
+        std::cerr << "[SegmentedVideoSink] 有分段编码失败，输出中缺少 " << frames_lost << " 帧\n";
+    }
+
+    if(mode == SEGMENT_CONCAT)
+    {
+        concat_segments();
+    }
+    else
+    {
+        write_playlist();
+    }
+}
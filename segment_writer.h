@@ -0,0 +1,76 @@
+#ifndef SEGMENT_WRITER_H
+#define SEGMENT_WRITER_H
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#include "SafeQueue.h"
+#include "frame_sink.h"
+
+// 分段编码完成后的输出方式
+enum SegmentOutputMode {
+    SEGMENT_CONCAT = 0,  // 用 ffmpeg concat 无损拼接成一个文件（流拷贝，不重编码）
+    SEGMENT_HLS          // 分段直接编码成 MPEG-TS，写 m3u8 列表（HLS 点播）
+};
+
+// 一个待编码的 GOP 块
+struct EncodeChunk {
+    int seg_id;
+    std::vector<cv::Mat> frames;
+};
+
+//-----------------------------------
+// 并行分段编码输出：按序收帧，每 gop_frames 帧切成一块交给多个编码线程，
+// 每块独立编码成一个分段文件（段首必为关键帧），最后无损拼接或生成 HLS 列表；
+// 拼接失败时保留分段文件和 ffmpeg concat 列表，可以事后手动拼接；
+// 编码失败的分段不进拼接列表和 m3u8，丢失的帧数会打印出来
+//-----------------------------------
+class SegmentedVideoSink : public FrameSink
+{
+public:
+    SegmentedVideoSink(const std::string &path, int num_encoders, int gop_frames, SegmentOutputMode mode);
+    ~SegmentedVideoSink();
+
+    bool open(int width, int height, double fps);
+    void write(const FrameData &fd);
+    void close();
+
+private:
+    void encoder_loop(int encoder_id);
+    void record_segment(int seg_id, int frames, bool ok);
+    std::string segment_path(int seg_id) const;
+    bool write_playlist();
+    bool concat_segments();
+
+    std::string path;
+    std::string base;   // 输出路径去掉扩展名
+    std::string ext;    // 扩展名（含点）
+    int num_encoders;
+    int gop_frames;
+    SegmentOutputMode mode;
+
+    int width;
+    int height;
+    double fps;
+
+    EncodeChunk current;  // 正在攒帧的块（仅写线程访问）
+    int next_seg_id;
+    SafeQueue<EncodeChunk> chunks;
+    std::vector<std::thread> encoders;
+
+    // 各分段的帧数与是否编码成功，写列表时计算时长、跳过失败的分段
+    std::mutex seg_mutex;
+    std::vector<int> seg_frames;
+    std::vector<char> seg_ok;
+    uint64_t frames_lost;
+    std::atomic<uint64_t> frames_encoded;
+    std::chrono::steady_clock::time_point open_time;
+    bool closed;
+};
+
+#endif
@@ -0,0 +1,432 @@
+#include "similarity_engine.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <math.h>
+#include <random>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// RK3588 上 fp16 matmul 的对齐要求：K 按 32 对齐，N 按 16 对齐，K 不超过 4096
+#define MATMUL_K_ALIGN 32
+#define MATMUL_N_ALIGN 16
+#define MATMUL_MAX_K   4096
+
+static int align_up(int v, int a)
+{
+    return (v + a - 1) / a * a;
+}
+
+static int next_pow2(int v)
+{
+    int p = 1;
+    while(p < v)
+    {
+        p <<= 1;
+    }
+    return p;
+}
+
+static uint16_t float_to_half(float f)
+{
+#if defined(__aarch64__)
+    __fp16 h = (__fp16)f;
+    uint16_t bits;
+    memcpy(&bits, &h, sizeof(bits));
+    return bits;
+#else
+    // 软件转换，舍入到最近偶数；归一化后的特征都在 [-1, 1]，不会溢出
+    uint32_t x;
+    memcpy(&x, &f, sizeof(x));
+    uint32_t sign = (x >> 16) & 0x8000;
+    int32_t exp = (int32_t)((x >> 23) & 0xff) - 127 + 15;
+    uint32_t mant = x & 0x7fffff;
+    if(exp <= 0)
+    {
+        if(exp < -10)
+        {
+            return (uint16_t)sign;
+        }
+        mant |= 0x800000;
+        uint32_t shift = (uint32_t)(14 - exp);
+        uint32_t half = mant >> shift;
+        uint32_t rem = mant & ((1u << shift) - 1);
+        uint32_t mid = 1u << (shift - 1);
+        if(rem > mid || (rem == mid && (half & 1)))
+        {
+            half++;
+        }
+        return (uint16_t)(sign | half);
+    }
+    if(exp >= 31)
+    {
+        return (uint16_t)(sign | 0x7c00);
+    }
+    uint32_t half = sign | ((uint32_t)exp << 10) | (mant >> 13);
+    uint32_t rem = mant & 0x1fff;
+    if(rem > 0x1000 || (rem == 0x1000 && (half & 1)))
+    {
+        half++;
+    }
+    return (uint16_t)half;
+#endif
+}
+
+void l2_normalize_rows(const float *src, float *dst, int rows, int k)
+{
+    for(int r = 0; r < rows; r++)
+    {
+        const float *s = src + (size_t)r * k;
+        float *d = dst + (size_t)r * k;
+        float sum = 0.f;
+        for(int i = 0; i < k; i++)
+        {
+            sum += s[i] * s[i];
+        }
+        float scale = sum > 0.f ? 1.f / sqrtf(sum) : 0.f;
+        for(int i = 0; i < k; i++)
+        {
+            d[i] = s[i] * scale;
+        }
+    }
+}
+
+//-----------------------------------
+// CPU 实现
+//-----------------------------------
+#if defined(__ARM_NEON)
+static inline float dot_product(const float *a, const float *b, int k)
+{
+    float32x4_t acc0 = vdupq_n_f32(0.f);
+    float32x4_t acc1 = vdupq_n_f32(0.f);
+    int i = 0;
+    for(; i + 8 <= k; i += 8)
+    {
+        acc0 = vmlaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+        acc1 = vmlaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    }
+    float32x4_t acc = vaddq_f32(acc0, acc1);
+    float lanes[4];
+    vst1q_f32(lanes, acc);
+    float sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    for(; i < k; i++)
+    {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+#else
+static inline float dot_product(const float *a, const float *b, int k)
+{
+    // 4 路独立累加，便于编译器自动向量化
+    float s0 = 0.f, s1 = 0.f, s2 = 0.f, s3 = 0.f;
+    int i = 0;
+    for(; i + 4 <= k; i += 4)
+    {
+        s0 += a[i] * b[i];
+        s1 += a[i + 1] * b[i + 1];
+        s2 += a[i + 2] * b[i + 2];
+        s3 += a[i + 3] * b[i + 3];
+    }
+    float sum = (s0 + s1) + (s2 + s3);
+    for(; i < k; i++)
+    {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+#endif
+
+int CpuSimilarityEngine::compute(const float *query, int m, const float *gallery, int n, int k, float *out)
+{
+    if(m <= 0 || n <= 0 || k <= 0)
+    {
+        return 0;
+    }
+    norm_query.resize((size_t)m * k);
+    norm_gallery.resize((size_t)n * k);
+    l2_normalize_rows(query, norm_query.data(), m, k);
+    l2_normalize_rows(gallery, norm_gallery.data(), n, k);
+
+    // gallery 按块遍历，一块特征留在缓存里与所有 query 行做点积
+    const int block = std::max(1, (32 * 1024) / (int)(k * sizeof(float)));
+    for(int j0 = 0; j0 < n; j0 += block)
+    {
+        int j1 = std::min(n, j0 + block);
+        for(int i = 0; i < m; i++)
+        {
+            const float *q = norm_query.data() + (size_t)i * k;
+            float *row = out + (size_t)i * n;
+            for(int j = j0; j < j1; j++)
+            {
+                row[j] = dot_product(q, norm_gallery.data() + (size_t)j * k, k);
+            }
+        }
+    }
+    return 0;
+}
+
+//-----------------------------------
+// NPU 实现
+//-----------------------------------
+NpuSimilarityEngine::NpuSimilarityEngine(rknn_core_mask mask)
+    : core_mask(mask), ctx(0), mem_a(NULL), mem_b(NULL), mem_c(NULL), ctx_m(0), ctx_n(0), ctx_k(0)
+{
+    memset(&io_attr, 0, sizeof(io_attr));
+}
+
+NpuSimilarityEngine::~NpuSimilarityEngine()
+{
+    release();
+}
+
+void NpuSimilarityEngine::release()
+{
+    if(ctx_m == 0)
+    {
+        return;
+    }
+    if(mem_a) rknn_destroy_mem(ctx, mem_a);
+    if(mem_b) rknn_destroy_mem(ctx, mem_b);
+    if(mem_c) rknn_destroy_mem(ctx, mem_c);
+    mem_a = mem_b = mem_c = NULL;
+    rknn_matmul_destroy(ctx);
+    ctx = 0;
+    ctx_m = ctx_n = ctx_k = 0;
+}
+
+int NpuSimilarityEngine::prepare(int m, int n, int k)
+{
+    int mp = next_pow2(m);
+    int np = align_up(next_pow2(n), MATMUL_N_ALIGN);
+    int kp = align_up(k, MATMUL_K_ALIGN);
+    if(mp == ctx_m && np == ctx_n && kp == ctx_k)
+    {
+        return 0;
+    }
+    release();
+
+    rknn_matmul_info info;
+    memset(&info, 0, sizeof(info));
+    info.M = mp;
+    info.K = kp;
+    info.N = np;
+    info.type = RKNN_TENSOR_FLOAT16;
+    info.native_layout = 0;
+    info.perf_layout = 0;
+    memset(&io_attr, 0, sizeof(io_attr));
+    int ret = rknn_matmul_create(&ctx, &info, &io_attr);
+    if(ret < 0)
+    {
+        printf("rknn_matmul_create fail! ret=%d (M=%d K=%d N=%d)\n", ret, mp, kp, np);
+        return -1;
+    }
+    ctx_m = mp;
+    ctx_n = np;
+    ctx_k = kp;
+    if(core_mask != RKNN_NPU_CORE_AUTO)
+    {
+        ret = rknn_matmul_set_core_mask(ctx, core_mask);
+        if(ret < 0)
+        {
+            printf("rknn_matmul_set_core_mask fail! ret=%d\n", ret);
+        }
+    }
+
+    mem_a = rknn_create_mem(ctx, io_attr.A.size);
+    mem_b = rknn_create_mem(ctx, io_attr.B.size);
+    mem_c = rknn_create_mem(ctx, io_attr.C.size);
+    if(mem_a == NULL || mem_b == NULL || mem_c == NULL)
+    {
+        printf("rknn_create_mem fail!\n");
+        release();
+        return -1;
+    }
+    if(rknn_matmul_set_io_mem(ctx, mem_a, &io_attr.A) < 0 ||
+       rknn_matmul_set_io_mem(ctx, mem_b, &io_attr.B) < 0 ||
+       rknn_matmul_set_io_mem(ctx, mem_c, &io_attr.C) < 0)
+    {
+        printf("rknn_matmul_set_io_mem fail!\n");
+        release();
+        return -1;
+    }
+    return 0;
+}
+
+int NpuSimilarityEngine::compute(const float *query, int m, const float *gallery, int n, int k, float *out)
+{
+    if(m <= 0 || n <= 0 || k <= 0)
+    {
+        return 0;
+    }
+    if(k > MATMUL_MAX_K)
+    {
+        printf("NpuSimilarityEngine: K=%d 超过 matmul 上限 %d\n", k, MATMUL_MAX_K);
+        return -1;
+    }
+    if(prepare(m, n, k) != 0)
+    {
+        return -1;
+    }
+
+    // A: (M, K) 行主序，补齐的行和列填零
+    norm_buf.resize((size_t)std::max(m, n) * k);
+    uint16_t *a = (uint16_t *)mem_a->virt_addr;
+    memset(a, 0, io_attr.A.size);
+    l2_normalize_rows(query, norm_buf.data(), m, k);
+    for(int i = 0; i < m; i++)
+    {
+        const float *src = norm_buf.data() + (size_t)i * k;
+        uint16_t *dst = a + (size_t)i * ctx_k;
+        for(int c = 0; c < k; c++)
+        {
+            dst[c] = float_to_half(src[c]);
+        }
+    }
+
+    // B: (K, N) 行主序，即 gallery 的转置
+    uint16_t *b = (uint16_t *)mem_b->virt_addr;
+    memset(b, 0, io_attr.B.size);
+    l2_normalize_rows(gallery, norm_buf.data(), n, k);
+    for(int j = 0; j < n; j++)
+    {
+        const float *src = norm_buf.data() + (size_t)j * k;
+        for(int c = 0; c < k; c++)
+        {
+            b[(size_t)c * ctx_n + j] = float_to_half(src[c]);
+        }
+    }
+
+    int ret = rknn_matmul_run(ctx);
+    if(ret < 0)
+    {
+        printf("rknn_matmul_run fail! ret=%d\n", ret);
+        return -1;
+    }
+
+    // C: (M, N) fp32，只取有效部分
+    const float *c = (const float *)mem_c->virt_addr;
+    for(int i = 0; i < m; i++)
+    {
+        memcpy(out + (size_t)i * n, c + (size_t)i * ctx_n, n * sizeof(float));
+    }
+    return 0;
+}
+
+//-----------------------------------
+// 自动切换
+//-----------------------------------
+AutoSimilarityEngine::AutoSimilarityEngine(double crossover_macs, rknn_core_mask core_mask)
+    : crossover(crossover_macs), npu(core_mask), npu_failed(false)
+{
+}
+
+int AutoSimilarityEngine::compute(const float *query, int m, const float *gallery, int n, int k, float *out)
+{
+    double macs = (double)m * n * k;
+    if(!npu_failed && macs >= crossover)
+    {
+        if(npu.compute(query, m, gallery, n, k, out) == 0)
+        {
+            return 0;
+        }
+        // NPU 不可用（驱动版本不支持 matmul 等），之后一直走 CPU
+        npu_failed = true;
+        std::cerr << "[Similarity] NPU matmul 不可用，改用 CPU\n";
+    }
+    return cpu.compute(query, m, gallery, n, k, out);
+}
+
+SimilarityEngine *create_similarity_engine(SimilarityBackend backend, double crossover_macs)
+{
+    switch(backend)
+    {
+    case SIMILARITY_NPU:
+        return new NpuSimilarityEngine();
+    case SIMILARITY_AUTO:
+        return new AutoSimilarityEngine(crossover_macs);
+    case SIMILARITY_CPU:
+    default:
+        return new CpuSimilarityEngine();
+    }
+}
+
+//-----------------------------------
+// 分界点测试：M = N 从 8 到 1024，每个规模先跑一次预热（NPU 在这次创建上下文），再计时
+//-----------------------------------
+static double time_engine_ms(SimilarityEngine &engine, const std::vector<float> &q, const std::vector<float> &g,
+                             int size, int k, int iterations, std::vector<float> &out)
+{
+    if(engine.compute(q.data(), size, g.data(), size, k, out.data()) != 0)
+    {
+        return -1.0;
+    }
+    auto t0 = std::chrono::steady_clock::now();
+    for(int it = 0; it < iterations; it++)
+    {
+        engine.compute(q.data(), size, g.data(), size, k, out.data());
+    }
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count() / iterations;
+}
+
+double benchmark_similarity_crossover(int k, int iterations)
+{
+    if(iterations < 1)
+    {
+        iterations = 1;
+    }
+    const int max_size = 1024;
+    std::mt19937 rng(12345);
+    std::normal_distribution<float> dist(0.f, 1.f);
+    std::vector<float> q((size_t)max_size * k), g((size_t)max_size * k);
+    for(size_t i = 0; i < q.size(); i++)
+    {
+        q[i] = dist(rng);
+        g[i] = dist(rng);
+    }
+    std::vector<float> out_cpu((size_t)max_size * max_size), out_npu((size_t)max_size * max_size);
+
+    CpuSimilarityEngine cpu;
+    NpuSimilarityEngine npu;
+    double crossover = -1.0;
+    bool npu_ok = true;
+    std::cout << "[SimilarityBench] K=" << k << ", 每个规模 " << iterations << " 次取平均\n";
+    for(int size = 8; size <= max_size; size *= 2)
+    {
+        double cpu_ms = time_engine_ms(cpu, q, g, size, k, iterations, out_cpu);
+        double npu_ms = npu_ok ? time_engine_ms(npu, q, g, size, k, iterations, out_npu) : -1.0;
+        if(npu_ms < 0)
+        {
+            npu_ok = false;
+            std::cout << "[SimilarityBench] M=N=" << size << " CPU " << cpu_ms << " ms, NPU 不可用\n";
+            continue;
+        }
+
+        // fp16 与 fp32 结果的最大偏差，用来确认 NPU 结果可用
+        float max_err = 0.f;
+        for(size_t i = 0; i < (size_t)size * size; i++)
+        {
+            max_err = std::max(max_err, fabsf(out_cpu[i] - out_npu[i]));
+        }
+        std::cout << "[SimilarityBench] M=N=" << size << " CPU " << cpu_ms << " ms, NPU " << npu_ms
+                  << " ms, 加速比 " << (npu_ms > 0 ? cpu_ms / npu_ms : 0) << "x, 最大误差 " << max_err << "\n";
+        if(crossover < 0 && npu_ms < cpu_ms)
+        {
+            crossover = (double)size * size * k;
+        }
+    }
+    if(crossover > 0)
+    {
+        std::cout << "[SimilarityBench] NPU 在 M*N*K >= " << crossover << " 时占优\n";
+    }
+    else
+    {
+        std::cout << "[SimilarityBench] 测试范围内 NPU 均不占优\n";
+    }
+    return crossover;
+}
@@ -0,0 +1,106 @@
+#ifndef SIMILARITY_ENGINE_H
+#define SIMILARITY_ENGINE_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "rknn_matmul_api.h"
+
+// 相似度计算后端
+enum SimilarityBackend {
+    SIMILARITY_CPU = 0,  // CPU 向量化实现
+    SIMILARITY_NPU,      // rknn_matmul 在 NPU 上做 fp16 矩阵乘
+    SIMILARITY_AUTO      // 按矩阵规模在两者之间切换
+};
+
+//-----------------------------------
+// 余弦相似度引擎：query(M x K) 与 gallery(N x K) 两组特征向量，输出 M x N 相似度矩阵
+//   输入按行存放的 float 特征，不要求事先归一化；out 由调用方分配 M*N 个 float
+//   每个实例只能在一个线程中使用（NPU 后端持有 matmul 上下文）
+//-----------------------------------
+class SimilarityEngine
+{
+public:
+    virtual ~SimilarityEngine() {}
+
+    // 成功返回 0
+    virtual int compute(const float *query, int m, const float *gallery, int n, int k, float *out) = 0;
+    virtual const char *name() const = 0;
+};
+
+//-----------------------------------
+// CPU 实现：先归一化，再按块计算点积；aarch64 上用 NEON 一次处理 4 个分量
+//-----------------------------------
+class CpuSimilarityEngine : public SimilarityEngine
+{
+public:
+    int compute(const float *query, int m, const float *gallery, int n, int k, float *out);
+    const char *name() const { return "cpu"; }
+
+private:
+    std::vector<float> norm_query;
+    std::vector<float> norm_gallery;
+};
+
+//-----------------------------------
+// NPU 实现：归一化后转成 fp16 送 rknn_matmul，C = A(M x K) * B(K x N) 输出 fp32
+//   K、N 按 RK3588 fp16 的对齐要求补零（补零不改变点积）；M、N 向上取到 2 的幂，
+//   规模在同一档内变化时复用已创建的 matmul 上下文，避免每帧重新创建
+//-----------------------------------
+class NpuSimilarityEngine : public SimilarityEngine
+{
+public:
+    explicit NpuSimilarityEngine(rknn_core_mask core_mask = RKNN_NPU_CORE_AUTO);
+    ~NpuSimilarityEngine();
+
+    int compute(const float *query, int m, const float *gallery, int n, int k, float *out);
+    const char *name() const { return "npu"; }
+
+private:
+    int prepare(int m, int n, int k);
+    void release();
+
+    rknn_core_mask core_mask;
+    rknn_matmul_ctx ctx;
+    rknn_matmul_io_attr io_attr;
+    rknn_tensor_mem *mem_a;
+    rknn_tensor_mem *mem_b;
+    rknn_tensor_mem *mem_c;
+    int ctx_m;   // 当前上下文的（补齐后）规模，0 表示未创建
+    int ctx_n;
+    int ctx_k;
+    std::vector<float> norm_buf;
+};
+
+//-----------------------------------
+// 自动切换：M*N*K 小于 crossover_macs 时走 CPU（NPU 的提交和拷贝开销划不来），否则走 NPU；
+// NPU 调用失败时退回 CPU。crossover_macs 用 benchmark_similarity_crossover 在目标板上测得
+//-----------------------------------
+class AutoSimilarityEngine : public SimilarityEngine
+{
+public:
+    AutoSimilarityEngine(double crossover_macs, rknn_core_mask core_mask = RKNN_NPU_CORE_AUTO);
+
+    int compute(const float *query, int m, const float *gallery, int n, int k, float *out);
+    const char *name() const { return "auto"; }
+
+private:
+    double crossover;
+    CpuSimilarityEngine cpu;
+    NpuSimilarityEngine npu;
+    bool npu_failed;
+};
+
+// RK3588 上 K=256 时实测的大致分界点，按板子和特征维度用 --bench-similarity 重新测
+#define SIMILARITY_DEFAULT_CROSSOVER_MACS (64.0 * 64.0 * 256.0)
+
+SimilarityEngine *create_similarity_engine(SimilarityBackend backend,
+                                           double crossover_macs = SIMILARITY_DEFAULT_CROSSOVER_MACS);
+
+// 把每行归一化为单位向量（零向量保持为零），dst 可以与 src 相同
+void l2_normalize_rows(const float *src, float *dst, int rows, int k);
+
+// 对比 CPU 与 NPU 在不同规模下的耗时，打印表格并返回 NPU 开始占优的 M*N*K（NPU 始终不占优时返回负数）
+double benchmark_similarity_crossover(int k, int iterations);
+
+#endif
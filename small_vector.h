@@ -0,0 +1,142 @@
+#ifndef SMALL_VECTOR_H
+#define SMALL_VECTOR_H
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+
+// 带内联存储的小向量：元素不超过 N 个时放在对象内部，不分配堆内存；超过后整体搬到堆上
+//  - 拷贝只复制实际元素（而不是整个容量），适合按值在线程之间传递的检测结果
+//  - 只用于可平凡拷贝的类型（按字节拷贝/移动）
+template<typename T, size_t N>
+class SmallVector
+{
+public:
+    SmallVector() : data_(inline_buf()), size_(0), capacity_(N) {}
+
+    SmallVector(const SmallVector &other) : data_(inline_buf()), size_(0), capacity_(N)
+    {
+        assign(other);
+    }
+
+    SmallVector(SmallVector &&other) : data_(inline_buf()), size_(0), capacity_(N)
+    {
+        take(other);
+    }
+
+    ~SmallVector()
+    {
+        release();
+    }
+
+    SmallVector &operator=(const SmallVector &other)
+    {
+        if(this != &other)
+        {
+            assign(other);
+        }
+        return *this;
+    }
+
+    SmallVector &operator=(SmallVector &&other)
+    {
+        if(this != &other)
+        {
+            release();
+            take(other);
+        }
+        return *this;
+    }
+
+    size_t size() const { return size_; }
+    size_t capacity() const { return capacity_; }
+    bool empty() const { return size_ == 0; }
+    void clear() { size_ = 0; }
+
+    T &operator[](size_t i) { return data_[i]; }
+    const T &operator[](size_t i) const { return data_[i]; }
+    T *begin() { return data_; }
+    T *end() { return data_ + size_; }
+    const T *begin() const { return data_; }
+    const T *end() const { return data_ + size_; }
+
+    void push_back(const T &value)
+    {
+        if(size_ == capacity_)
+        {
+            reserve(capacity_ * 2);
+        }
+        data_[size_++] = value;
+    }
+
+    void reserve(size_t n)
+    {
+        if(n <= capacity_)
+        {
+            return;
+        }
+        T *p = static_cast<T *>(malloc(n * sizeof(T)));
+        if(p == NULL)
+        {
+            throw std::bad_alloc();
+        }
+        memcpy(p, data_, size_ * sizeof(T));
+        if(data_ != inline_buf())
+        {
+            free(data_);
+        }
+        data_ = p;
+        capacity_ = n;
+    }
+
+private:
+    T *inline_buf() { return reinterpret_cast<T *>(storage_); }
+    bool on_heap() const { return capacity_ > N; }
+
+    void assign(const SmallVector &other)
+    {
+        clear();
+        reserve(other.size_);
+        memcpy(data_, other.data_, other.size_ * sizeof(T));
+        size_ = other.size_;
+    }
+
+    // 接管 other 的内容，other 变为空（调用前本对象不持有堆内存）
+    void take(SmallVector &other)
+    {
+        if(other.on_heap())
+        {
+            data_ = other.data_;
+            capacity_ = other.capacity_;
+            other.data_ = other.inline_buf();
+            other.capacity_ = N;
+        }
+        else
+        {
+            data_ = inline_buf();
+            capacity_ = N;
+            memcpy(data_, other.data_, other.size_ * sizeof(T));
+        }
+        size_ = other.size_;
+        other.size_ = 0;
+    }
+
+    void release()
+    {
+        if(on_heap())
+        {
+            free(data_);
+        }
+        data_ = inline_buf();
+        size_ = 0;
+        capacity_ = N;
+    }
+
+    T *data_;
+    size_t size_;
+    size_t capacity_;
+    alignas(T) unsigned char storage_[N * sizeof(T)];
+};
+
+#endif
@@ -0,0 +1,182 @@
+#include "stage_timing.h"
+
+#include <chrono>
+#include <iostream>
+#include <stdio.h>
+#include <string.h>
+
+// 各阶段的起止时间点
+static const TimestampPoint stage_points[STAGE_NUM][2] = {
+    {TS_DECODE_BEGIN,   TS_DECODE_END},
+    {TS_READ_ENQUEUE,   TS_READ_DEQUEUE},
+    {TS_POOL_SUBMIT,    TS_POOL_DEQUEUE},
+    {TS_POOL_DEQUEUE,   TS_PREPROCESS_END},
+    {TS_PREPROCESS_END, TS_NPU_END},
+    {TS_NPU_END,        TS_POSTPROCESS_END},
+    {TS_RENDER_BEGIN,   TS_RENDER_END},
+    {TS_READ_DEQUEUE,   TS_AGG_EMIT},
+    {TS_AGG_EMIT,       TS_WRITE_DEQUEUE},
+    {TS_WRITE_DEQUEUE,  TS_WRITE_END},
+    {TS_DECODE_BEGIN,   TS_WRITE_END},
+};
+
+const char *stage_name(PipelineStage stage)
+{
+    static const char *names[STAGE_NUM] = {
+        "decode", "read_queue", "pool_queue", "preprocess", "npu", "postprocess",
+        "render", "inflight", "write_queue", "write", "total"
+    };
+    return (stage >= 0 && stage < STAGE_NUM) ? names[stage] : "unknown";
+}
+
+int64_t stage_now_us()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void FrameTimestamps::clear()
+{
+    memset(t, 0, sizeof(t));
+}
+
+void FrameTimestamps::merge(const FrameTimestamps &other)
+{
+    for(int i = 0; i < TS_NUM; i++)
+    {
+        if(other.t[i] != 0)
+        {
+            t[i] = other.t[i];
+        }
+    }
+}
+
+//-----------------------------------
+// 直方图
+//-----------------------------------
+LatencyHistogram::LatencyHistogram()
+    : total(0), max_us(0)
+{
+    for(int i = 0; i < BUCKETS; i++)
+    {
+        buckets[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+int LatencyHistogram::bucket_of(int64_t v)
+{
+    if(v < SUB_COUNT)
+    {
+        return v < 0 ? 0 : (int)v;
+    }
+    int e = 63 - __builtin_clzll((unsigned long long)v);  // v 的最高位
+    if(e > MAX_EXP)
+    {
+        return BUCKETS - 1;
+    }
+    int sub = (int)((v >> (e - SUB_BITS)) & (SUB_COUNT - 1));
+    return SUB_COUNT + (e - SUB_BITS) * SUB_COUNT + sub;
+}
+
+int64_t LatencyHistogram::bucket_upper(int idx)
+{
+    if(idx < SUB_COUNT)
+    {
+        return idx;
+    }
+    int e = (idx - SUB_COUNT) / SUB_COUNT + SUB_BITS;
+    int sub = (idx - SUB_COUNT) % SUB_COUNT;
+    return ((int64_t)(SUB_COUNT + sub + 1) << (e - SUB_BITS)) - 1;
+}
+
+void LatencyHistogram::record(int64_t value_us)
+{
+    buckets[bucket_of(value_us)].fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add(1, std::memory_order_relaxed);
+    int64_t m = max_us.load(std::memory_order_relaxed);
+    while(value_us > m && !max_us.compare_exchange_weak(m, value_us, std::memory_order_relaxed))
+    {
+    }
+}
+
+void LatencyHistogram::add(const LatencyHistogram &other)
+{
+    for(int i = 0; i < BUCKETS; i++)
+    {
+        uint64_t c = other.buckets[i].load(std::memory_order_relaxed);
+        if(c != 0)
+        {
+            buckets[i].fetch_add(c, std::memory_order_relaxed);
+        }
+    }
+    total.fetch_add(other.count(), std::memory_order_relaxed);
+    int64_t m = max_us.load(std::memory_order_relaxed);
+    int64_t om = other.max();
+    while(om > m && !max_us.compare_exchange_weak(m, om, std::memory_order_relaxed))
+    {
+    }
+}
+
+int64_t LatencyHistogram::percentile(double p) const
+{
+    uint64_t n = count();
+    if(n == 0)
+    {
+        return 0;
+    }
+    uint64_t target = (uint64_t)(p / 100.0 * n + 0.5);
+    if(target < 1) target = 1;
+    uint64_t seen = 0;
+    for(int i = 0; i < BUCKETS; i++)
+    {
+        seen += buckets[i].load(std::memory_order_relaxed);
+        if(seen >= target)
+        {
+            // 格的上界可能超过真实最大值，取两者较小者
+            int64_t upper = bucket_upper(i);
+            return upper < max() ? upper : max();
+        }
+    }
+    return max();
+}
+
+//-----------------------------------
+// 各阶段直方图
+//-----------------------------------
+void StageHistograms::record(const FrameTimestamps &ts)
+{
+    for(int s = 0; s < STAGE_NUM; s++)
+    {
+        int64_t begin = ts.t[stage_points[s][0]];
+        int64_t end = ts.t[stage_points[s][1]];
+        if(begin != 0 && end != 0 && end >= begin)
+        {
+            stages[s].record(end - begin);
+        }
+    }
+}
+
+void StageHistograms::add(const StageHistograms &other)
+{
+    for(int s = 0; s < STAGE_NUM; s++)
+    {
+        stages[s].add(other.stages[s]);
+    }
+}
+
+void StageHistograms::print(const std::string &prefix) const
+{
+    char line[160];
+    for(int s = 0; s < STAGE_NUM; s++)
+    {
+        const LatencyHistogram &h = stages[s];
+        if(h.count() == 0)
+        {
+            continue;
+        }
+        snprintf(line, sizeof(line), "%-12s n=%-8llu p50=%8.2f p90=%8.2f p99=%8.2f max=%8.2f ms",
+                 stage_name((PipelineStage)s), (unsigned long long)h.count(),
+                 h.percentile(50) / 1000.0, h.percentile(90) / 1000.0, h.percentile(99) / 1000.0, h.max() / 1000.0);
+        std::cout << prefix << " " << line << std::endl;
+    }
+}
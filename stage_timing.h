@@ -0,0 +1,107 @@
+#ifndef STAGE_TIMING_H
+#define STAGE_TIMING_H
+
+#include <atomic>
+#include <stdint.h>
+#include <string>
+
+// 一帧在流水线中经过的时间点
+enum TimestampPoint {
+    TS_DECODE_BEGIN = 0,  // 读线程开始读取/解码
+    TS_DECODE_END,        // 解码完成（即采集时刻）
+    TS_READ_ENQUEUE,      // 放入读队列
+    TS_READ_DEQUEUE,      // 聚合线程从读队列取出
+    TS_POOL_SUBMIT,       // 提交到线程池
+    TS_POOL_DEQUEUE,      // worker 取出任务
+    TS_PREPROCESS_END,    // RGA 裁剪/转色/缩放完成
+    TS_NPU_END,           // rknn_run 与取输出完成
+    TS_POSTPROCESS_END,   // 后处理（解码框 + NMS）完成
+    TS_RENDER_BEGIN,      // 开始画框
+    TS_RENDER_END,        // 画框完成
+    TS_AGG_EMIT,          // 聚合线程按序放入写队列
+    TS_WRITE_DEQUEUE,     // 写线程取出
+    TS_WRITE_END,         // 写出完成
+    TS_NUM
+};
+
+// 由相邻时间点划分出的阶段
+enum PipelineStage {
+    STAGE_DECODE = 0,     // DECODE_BEGIN -> DECODE_END
+    STAGE_READ_QUEUE,     // READ_ENQUEUE -> READ_DEQUEUE   读队列排队
+    STAGE_POOL_QUEUE,     // POOL_SUBMIT -> POOL_DEQUEUE    线程池排队
+    STAGE_PREPROCESS,     // POOL_DEQUEUE -> PREPROCESS_END
+    STAGE_NPU,            // PREPROCESS_END -> NPU_END
+    STAGE_POSTPROCESS,    // NPU_END -> POSTPROCESS_END
+    STAGE_RENDER,         // RENDER_BEGIN -> RENDER_END
+    STAGE_INFLIGHT,       // READ_DEQUEUE -> AGG_EMIT       聚合线程中停留（含推理与按序等待）
+    STAGE_WRITE_QUEUE,    // AGG_EMIT -> WRITE_DEQUEUE      写队列排队
+    STAGE_WRITE,          // WRITE_DEQUEUE -> WRITE_END
+    STAGE_TOTAL,          // DECODE_BEGIN -> WRITE_END      端到端
+    STAGE_NUM
+};
+
+const char *stage_name(PipelineStage stage);
+
+// steady_clock 的微秒数
+int64_t stage_now_us();
+
+//-----------------------------------
+// 一帧的时间戳，随 FrameData / ProcessResult 在各线程之间传递；0 表示没经过该时间点
+//-----------------------------------
+struct FrameTimestamps
+{
+    int64_t t[TS_NUM];
+
+    FrameTimestamps() { clear(); }
+    void clear();
+    void mark(TimestampPoint p) { t[p] = stage_now_us(); }
+    // 合并另一份时间戳中已记录的时间点（线程池返回的时间点合入聚合线程持有的那一份）
+    void merge(const FrameTimestamps &other);
+};
+
+//-----------------------------------
+// HDR 风格的对数线性直方图：每个 2 的幂区间再均分 16 格，相对误差约 6%，
+// 覆盖 1 us 到约 19 小时；计数用原子量，写线程记录的同时主线程可以读取
+//-----------------------------------
+class LatencyHistogram
+{
+public:
+    enum { SUB_BITS = 4, SUB_COUNT = 1 << SUB_BITS, MAX_EXP = 36,
+           BUCKETS = SUB_COUNT + (MAX_EXP - SUB_BITS + 1) * SUB_COUNT };
+
+    LatencyHistogram();
+
+    void record(int64_t value_us);
+    void add(const LatencyHistogram &other);
+
+    uint64_t count() const { return total.load(std::memory_order_relaxed); }
+    int64_t max() const { return max_us.load(std::memory_order_relaxed); }
+    // 分位数（0~100），返回所在格的上界（微秒）
+    int64_t percentile(double p) const;
+
+private:
+    static int bucket_of(int64_t v);
+    static int64_t bucket_upper(int idx);
+
+    std::atomic<uint64_t> buckets[BUCKETS];
+    std::atomic<uint64_t> total;
+    std::atomic<int64_t> max_us;
+};
+
+//-----------------------------------
+// 各阶段一个直方图；每路流一份，由写线程在帧写出后按时间戳记录
+//-----------------------------------
+class StageHistograms
+{
+public:
+    void record(const FrameTimestamps &ts);
+    void add(const StageHistograms &other);
+    // 打印各阶段 p50/p90/p99/max（毫秒），没有样本的阶段不打印
+    void print(const std::string &prefix) const;
+    const LatencyHistogram &stage(PipelineStage s) const { return stages[s]; }
+
+private:
+    LatencyHistogram stages[STAGE_NUM];
+};
+
+#endif
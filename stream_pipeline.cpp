@@ -0,0 +1,580 @@
+#include "stream_pipeline.h"
+#include "trace.h"
+#include "logger.h"
+#include "cpu_affinity.h"
+
+#include <climits>
+#include <deque>
+#include <future>
+#include <iostream>
+#include <map>
+
+// 聚合线程中在线的帧：推理结果的 future 以及采集时刻
+struct InflightFrame {
+    std::future<ProcessResult> result;
+    std::chrono::steady_clock::time_point capture_time;
+    double pts_ms;
+    cv::Mat frame;  // 二级分类时保留原图，用于裁剪检测框
+    FrameTimestamps timestamps;
+};
+
+// 等待二级分类的帧，按帧序排队；降级帧不分类，轮到它时沿用前面的属性
+struct CascadePending {
+    FrameData data;
+    cv::Mat frame;
+    bool classified;                                // 是否提交了二级分类
+    std::future<detect_result_group_t> detections;  // classified 时有效
+};
+
+// 不经过线程池的帧：直接给出已就绪的降级结果，按序写出时由跟踪预测或沿用上一帧的检测结果
+static std::future<ProcessResult> ready_degraded_result(const cv::Mat &frame, bool render)
+{
+    std::promise<ProcessResult> promise;
+    ProcessResult result;
+    if(render)
+    {
+        result.processed_img = frame;
+    }
+    result.degraded = true;
+    result.success = true;
+    promise.set_value(result);
+    return promise.get_future();
+}
+
+StreamPipeline::StreamPipeline(int id, FrameSource *src, FrameSink *dst,
+                               ThreadPoll &pool, const PipelineConfig &cfg, TaskPriority prio)
+    : stream_id(id), source(src), sink(dst), npu_pool(pool), config(cfg), priority(prio),
+      readQueue(cfg.read_queue_size), writeQueue(cfg.write_queue_size),
+      read_finish(false), process_finish(false), write_finish(false),
+      readAdmission(cfg.read_admission),
+      render(cfg.output_mode == OUTPUT_VIDEO),
+      last_write_us(0), frames_read(0), frames_written(0), pool_dropped(0), motion_skipped(0), track_skipped(0),
+      latency_sum_us(0), latency_max_us(0),
+      trace_read_queue("read_queue[" + std::to_string(id) + "]"),
+      trace_write_queue("write_queue[" + std::to_string(id) + "]"),
+      trace_inflight("inflight[" + std::to_string(id) + "]")
+{
+    if(cfg.motion.enabled)
+    {
+        motion_gate.reset(new MotionGate(cfg.motion));
+    }
+    if(cfg.tracker.enabled)
+    {
+        tracker.reset(new MultiObjectTracker(cfg.tracker));
+    }
+}
+
+bool StreamPipeline::open()
+{
+    if(!source->open())
+    {
+        return false;
+    }
+    return sink->open(source->width(), source->height(), source->fps());
+}
+
+void StreamPipeline::start()
+{
+    start_time = std::chrono::steady_clock::now();
+
+    // 启动：1) 读线程, 2) 聚合线程, 3) 写线程
+    tRead = std::thread(&StreamPipeline::readThreadFunc, this);
+    tAggregator = std::thread(&StreamPipeline::aggregatorThreadFunc, this);
+    tWrite = std::thread(&StreamPipeline::writeThreadFunc, this);
+}
+
+void StreamPipeline::join()
+{
+    // 等3个线程退出
+    if(tRead.joinable())       tRead.join();
+    if(tAggregator.joinable()) tAggregator.join();
+    if(tWrite.joinable())      tWrite.join();
+
+    // 给队列发 stop 信号（好习惯，但此时往往都空了）
+    readQueue.stop();
+    writeQueue.stop();
+    sink->close();
+    if(det_store != NULL)
+    {
+        det_store->close();
+    }
+}
+
+//-----------------------------------
+// 读线程：不断从来源读取放入 readQueue
+//-----------------------------------
+void StreamPipeline::readThreadFunc()
+{
+    trace_set_thread_name("read " + std::to_string(stream_id));
+    log_set_thread_name(("read " + std::to_string(stream_id)).c_str());
+    pin_current_thread(THREAD_ROLE_READ);
+    if(segmented != NULL)
+    {
+        // 离线分段解码：多个读线程并行解码，帧带全局下标乱序进入 readQueue
+        segmented->run([this](FrameData &data)
+        {
+            frames_read++;
+            data.timestamps.mark(TS_READ_ENQUEUE);
+            readAdmission.offer(readQueue, data);
+            trace_counter(trace_read_queue.c_str(), (int64_t)readQueue.size());
+        });
+        read_finish = true;
+        std::cerr << "[ReadThread " << stream_id << "] segmented decode finished.\n";
+        return;
+    }
+
+    int idx = 0;
+    while(true)
+    {
+        cv::Mat frame;
+        // --pace 时解码阶段包含按帧率等待的时间
+        int64_t decode_begin = stage_now_us();
+        if(!source->read(frame))
+        {
+            // 读不到帧了（到视频末尾或出错）
+            std::cerr << "[ReadThread " << stream_id << "] read failed or EOF.\n";
+            break;
+        }
+        frames_read++;
+        // 容器没有时间戳时按帧率推算
+        double pts_ms = source->last_pts_ms();
+        if(pts_ms < 0)
+        {
+            pts_ms = idx * 1000.0 / source->fps();
+        }
+        // 持久的帧可能是只读映射，要画框时仍需拷贝一份
+        FrameData data{ (source->frames_persistent() && !render) ? frame : frame.clone(), idx++, std::chrono::steady_clock::now(), pts_ms };
+        data.timestamps.t[TS_DECODE_BEGIN] = decode_begin;
+        data.timestamps.mark(TS_DECODE_END);
+        data.timestamps.t[TS_READ_ENQUEUE] = data.timestamps.t[TS_DECODE_END];
+        trace_complete("decode", decode_begin, data.timestamps.t[TS_DECODE_END], data.index);
+        // 按准入策略入队：live 源读得比 NPU 快时在这里丢帧，保证延迟有界
+        readAdmission.offer(readQueue, data);
+        trace_counter(trace_read_queue.c_str(), (int64_t)readQueue.size());
+        LOG_DEBUG_EVERY_MS(1000, "[流%d] 读取队列中的图片数目目前是：%zu", stream_id, readQueue.size());
+    }
+    // 通知后续不再有新帧
+    read_finish = true;
+    std::cerr << "[ReadThread " << stream_id << "] finished.\n";
+}
+
+//-----------------------------------
+// 聚合线程：既提交多帧到线程池并行处理，也按顺序收集结果
+//-----------------------------------
+void StreamPipeline::aggregatorThreadFunc()
+{
+    trace_set_thread_name("aggregator " + std::to_string(stream_id));
+    log_set_thread_name(("aggregator " + std::to_string(stream_id)).c_str());
+    pin_current_thread(THREAD_ROLE_AGGREGATE);
+    // 用于按正确顺序写入的下标
+    int nextWriteIndex = 0;
+
+    // 存储“帧下标 -> future”的映射，实现无阻塞并行提交与按序收集（本路流独立的重排窗口）
+    std::map<int, InflightFrame> tasks_inflight;
+
+    // 分段解码时帧乱序到达：不限制在线帧数（由读线程的窗口限制内存），也不能把缺号当作丢帧
+    bool in_order_input = (segmented == NULL);
+
+    // 最近一次真正推理得到的检测结果，降级帧沿用它
+    detect_result_group_t last_detections;
+
+    // 二级分类：按帧序排队等待属性结果，以及最近一次分类的结果和各轨迹的属性
+    std::deque<CascadePending> cascade_pending;
+    detect_result_group_t last_classified;
+    std::map<uint16_t, detect_result_t> track_attrs;
+
+    // 在线帧数只在变化时记一次计数器，避免空转时每毫秒写一个事件
+    size_t traced_inflight = (size_t)-1;
+
+    // 分段解码中永远不会到达的帧数（段中途解码失败、seek 不准或帧龄超限被丢弃）
+    uint64_t frames_missing = 0;
+
+    while(true)
+    {
+        // 分段解码：先取前沿再取读队列。前沿之前的帧都在读队列里了，步骤A取空读队列后仍缺的帧号就不会再来
+        int arrived_before = segmented != NULL ? segmented->pending_frontier() : 0;
+
+        // 步骤A：从 readQueue 获取新帧并提交到线程池
+        //       在线帧数达到 max_inflight 时暂停提交，让压力回传到读队列由准入策略处理
+        FrameData inputFD;
+        while((!in_order_input || (int)tasks_inflight.size() < config.max_inflight) && readQueue.try_dequeue(inputFD))
+        {
+            inputFD.timestamps.mark(TS_READ_DEQUEUE);
+            TRACE_SCOPE_FRAME("submit", inputFD.index);
+            // 在读队列里放太久的帧直接丢弃
+            if(readAdmission.is_stale(inputFD.capture_time))
+            {
+                readAdmission.count_dropped_stale();
+                continue;
+            }
+            // 乱序到达时帧号可能重复或落在已跳过的范围里，覆盖映射会丢掉前一个 future
+            if(!in_order_input && (inputFD.index < nextWriteIndex || tasks_inflight.count(inputFD.index) != 0))
+            {
+                LOG_WARN("[流%d] 分段解码帧号 %d 重复或已跳过，丢弃", stream_id, inputFD.index);
+                continue;
+            }
+            // 提交异步推理任务，附带采集时刻与截止时间；stream_id 让线程池在多路流之间轮转
+            TaskMeta meta;
+            meta.capture_time = inputFD.capture_time;
+            // 二级分类要在原图上裁剪，画框推迟到属性结果回来之后
+            meta.render = render && cascade == NULL;
+            if(!config.streams[stream_id].roi.empty())
+            {
+                meta.roi = &config.streams[stream_id].roi;
+            }
+            if(config.deadline_ms > 0)
+            {
+                meta.deadline = inputFD.capture_time + std::chrono::milliseconds(config.deadline_ms);
+            }
+            InflightFrame inflight;
+            // 运动门控与检测间隔都需要按帧序判断，分段解码乱序到达时不启用
+            if(motion_gate && in_order_input && !motion_gate->need_inference(inputFD.frame))
+            {
+                // 静止帧不占用 NPU
+                inflight.result = ready_degraded_result(inputFD.frame, render);
+                motion_skipped++;
+            }
+            else if(tracker && in_order_input && ++frames_since_detect < tracker->detect_interval())
+            {
+                // 跟踪稳定时隔帧检测，中间帧由卡尔曼预测给出框
+                inflight.result = ready_degraded_result(inputFD.frame, render);
+                track_skipped++;
+            }
+            else
+            {
+                inflight.result = npu_pool.submit_task_async(inputFD.index, inputFD.frame, priority, stream_id, meta);
+                frames_since_detect = 0;
+            }
+            inflight.capture_time = inputFD.capture_time;
+            inflight.pts_ms = inputFD.pts_ms;
+            inflight.timestamps = inputFD.timestamps;
+            if(cascade != NULL)
+            {
+                inflight.frame = inputFD.frame;
+            }
+            // 将 (index -> future) 存到映射
+            tasks_inflight[inputFD.index] = std::move(inflight);
+        }
+
+        // 读线程按顺序送帧，映射中最小下标之前缺失的帧都已被丢弃，直接跳过
+        if(in_order_input && !tasks_inflight.empty() && tasks_inflight.begin()->first > nextWriteIndex)
+        {
+            for(int k = nextWriteIndex; tracker && k < tasks_inflight.begin()->first; k++)
+            {
+                tracker->step();
+            }
+            nextWriteIndex = tasks_inflight.begin()->first;
+        }
+        // 分段解码：缺的帧号已在前沿之前，说明它不会再来，跳到下一个在线帧（或前沿）
+        else if(!in_order_input && nextWriteIndex < arrived_before && tasks_inflight.count(nextWriteIndex) == 0 &&
+                (!tasks_inflight.empty() || arrived_before != INT_MAX))
+        {
+            int next = tasks_inflight.empty() ? arrived_before : std::min(tasks_inflight.begin()->first, arrived_before);
+            LOG_WARN("[流%d] 分段解码缺帧 %d~%d，跳过", stream_id, nextWriteIndex, next - 1);
+            frames_missing += next - nextWriteIndex;
+            for(int k = nextWriteIndex; tracker && k < next; k++)
+            {
+                tracker->step();
+            }
+            nextWriteIndex = next;
+            segmented->on_frames_written(nextWriteIndex);
+        }
+
+        // 步骤B：检查是否有“下一个待写帧(nextWriteIndex)”已经推理完成
+        //        如果完成，就把其结果按顺序放到 writeQueue
+        auto it = tasks_inflight.find(nextWriteIndex);
+        while(it != tasks_inflight.end())
+        {
+            // 不阻塞，先检查这条 future 是否ready
+            auto status = it->second.result.wait_for(std::chrono::milliseconds(0));
+            if(status == std::future_status::ready)
+            {
+                TRACE_SCOPE_FRAME("emit", nextWriteIndex);
+                // 获取推理结果
+                ProcessResult result = it->second.result.get();
+
+                if(result.dropped)
+                {
+                    // 线程池过载时丢弃的帧不写入，但轨迹仍要推进一帧，否则之后的预测框会落后
+                    pool_dropped++;
+                    if(tracker)
+                    {
+                        tracker->step();
+                    }
+                }
+                else
+                {
+                    if(result.degraded)
+                    {
+                        // 降级帧没有做推理：开启跟踪时用轨迹预测，否则按顺序沿用上一帧的检测结果
+                        if(tracker)
+                        {
+                            tracker->predict(result.detection_results);
+                        }
+                        else
+                        {
+                            result.detection_results = last_detections;
+                        }
+                        if(render && cascade == NULL)
+                        {
+                            result.timestamps.mark(TS_RENDER_BEGIN);
+                            Yolov5s::draw_result(result.processed_img, result.detection_results);
+                            result.timestamps.mark(TS_RENDER_END);
+                        }
+                    }
+                    else
+                    {
+                        if(tracker)
+                        {
+                            // 关联轨迹，给每个框写上轨迹号，并更新自适应检测间隔
+                            tracker->update(result.detection_results);
+                        }
+                        last_detections = result.detection_results;
+                    }
+
+                    // 将推理后图像和检测结果放到 writeQueue（只输出元数据时不带图像）
+                    FrameData outputFD;
+                    outputFD.index = nextWriteIndex;
+                    outputFD.capture_time = it->second.capture_time;
+                    outputFD.pts_ms = it->second.pts_ms;
+                    outputFD.timestamps = it->second.timestamps;
+                    outputFD.timestamps.merge(result.timestamps);
+                    if(cascade != NULL)
+                    {
+                        // 送去二级分类，属性结果回来后再按序写出
+                        CascadePending pending;
+                        pending.frame = it->second.frame;
+                        pending.classified = !result.degraded;
+                        if(pending.classified)
+                        {
+                            pending.detections = cascade->submit(pending.frame, result.detection_results);
+                        }
+                        else
+                        {
+                            outputFD.detections = std::move(result.detection_results);
+                        }
+                        pending.data = outputFD;
+                        cascade_pending.push_back(std::move(pending));
+                    }
+                    else
+                    {
+                        if(render)
+                        {
+                            outputFD.frame = result.processed_img.clone();
+                        }
+                        outputFD.detections = std::move(result.detection_results);
+                        outputFD.timestamps.mark(TS_AGG_EMIT);
+                        writeQueue.enqueue(outputFD);
+                    }
+                }
+
+                // 移除映射并递增下一个待写index
+                tasks_inflight.erase(it);
+                LOG_DEBUG_EVERY_MS(1000, "[流%d] 当前已经处理完成了：%d帧图片", stream_id, nextWriteIndex);
+                nextWriteIndex++;
+                if(segmented != NULL)
+                {
+                    segmented->on_frames_written(nextWriteIndex);
+                }
+
+                // 继续尝试下一个
+                it = tasks_inflight.find(nextWriteIndex);
+            }
+            else
+            {
+                // 下一个还没完成，就先退出等待，后面再检测
+                break;
+            }
+        }
+
+        if(tasks_inflight.size() != traced_inflight)
+        {
+            traced_inflight = tasks_inflight.size();
+            trace_counter(trace_inflight.c_str(), (int64_t)traced_inflight);
+        }
+
+        // 步骤B2：二级分类完成的帧按序写出
+        while(!cascade_pending.empty())
+        {
+            CascadePending &pending = cascade_pending.front();
+            detect_result_group_t &dets = pending.data.detections;
+            if(pending.classified)
+            {
+                if(pending.detections.wait_for(std::chrono::milliseconds(0)) != std::future_status::ready)
+                {
+                    break;
+                }
+                dets = pending.detections.get();
+                last_classified = dets;
+                for(size_t i = 0; i < dets.size(); i++)
+                {
+                    if(dets[i].track_id != 0 && dets[i].attr_id != 0)
+                    {
+                        track_attrs[dets[i].track_id] = dets[i];
+                    }
+                }
+            }
+            else if(tracker)
+            {
+                // 预测框按轨迹号找回该目标最近一次的属性
+                for(size_t i = 0; i < dets.size(); i++)
+                {
+                    std::map<uint16_t, detect_result_t>::const_iterator attr = track_attrs.find(dets[i].track_id);
+                    if(attr != track_attrs.end())
+                    {
+                        dets[i].attr_id = attr->second.attr_id;
+                        dets[i].attr_conf = attr->second.attr_conf;
+                    }
+                }
+            }
+            else
+            {
+                dets = last_classified;
+            }
+            if(render)
+            {
+                pending.data.timestamps.mark(TS_RENDER_BEGIN);
+                pending.data.frame = pending.frame;
+                Yolov5s::draw_result(pending.data.frame, dets);
+                pending.data.timestamps.mark(TS_RENDER_END);
+            }
+            pending.data.timestamps.mark(TS_AGG_EMIT);
+            writeQueue.enqueue(pending.data);
+            cascade_pending.pop_front();
+        }
+
+        // 步骤C：判断退出条件
+        //   若读完了 && 读队列空了 && 当前映射也空了，就说明都处理完了
+        if(read_finish && readQueue.empty() && tasks_inflight.empty() && cascade_pending.empty())
+        {
+            cout<<"[流"<<stream_id<<"] 处理线程已经结束"<<endl;
+            break;
+        }
+
+        // 为避免CPU空转过高，可稍微睡一下
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    if(frames_missing > 0)
+    {
+        std::cerr << "[AggregatorThread " << stream_id << "] 分段解码共缺 " << frames_missing << " 帧\n";
+    }
+    // 设置处理完成标志，并唤醒可能阻塞在空队列上的写线程
+    process_finish = true;
+    writeQueue.stop();
+    std::cerr << "[AggregatorThread " << stream_id << "] finished.\n";
+}
+
+//-----------------------------------
+// 写线程：从 writeQueue 中取出图像交给输出
+//-----------------------------------
+void StreamPipeline::writeThreadFunc()
+{
+    trace_set_thread_name("write " + std::to_string(stream_id));
+    log_set_thread_name(("write " + std::to_string(stream_id)).c_str());
+    pin_current_thread(THREAD_ROLE_WRITE);
+    while(true)
+    {
+        FrameData outputFD;
+        if(!writeQueue.dequeue(outputFD)) {
+            // 聚合线程已结束且队列已空，没有更多帧了
+            break;
+        }
+        outputFD.timestamps.mark(TS_WRITE_DEQUEUE);
+        trace_counter(trace_write_queue.c_str(), (int64_t)writeQueue.size());
+        TRACE_SCOPE_FRAME("write", outputFD.index);
+
+        sink->write(outputFD);
+        if(det_store != NULL)
+        {
+            const detect_result_group_t &group = outputFD.detections;
+            for(size_t i = 0; i < group.size(); i++)
+            {
+                const detect_result_t &det = group[i];
+                StoreRow row;
+                row.frame = outputFD.index;
+                row.pts_ms = outputFD.pts_ms;
+                row.class_id = det.class_id;
+                row.conf = det.box_conf;
+                row.xmin = det.box.xmin;
+                row.ymin = det.box.ymin;
+                row.xmax = det.box.xmax;
+                row.ymax = det.box.ymax;
+                det_store->append(row, class_label(det.class_id));
+            }
+        }
+
+        outputFD.timestamps.mark(TS_WRITE_END);
+        stage_hist.record(outputFD.timestamps);
+
+        // 统计端到端延迟：采集 -> 写出
+        auto now = std::chrono::steady_clock::now();
+        int64_t latency_us = std::chrono::duration_cast<std::chrono::microseconds>(now - outputFD.capture_time).count();
+        latency_sum_us += latency_us;
+        if(latency_us > latency_max_us) latency_max_us = latency_us;
+        frames_written++;
+        last_write_us = std::chrono::duration_cast<std::chrono::microseconds>(now - start_time).count();
+
+        LOG_DEBUG_EVERY_MS(1000, "[流%d] 写入队列帧数：%zu", stream_id, writeQueue.size());
+    }
+    write_finish = true;
+    std::cerr << "[WriteThread " << stream_id << "] finished.\n";
+}
+
+StreamStats StreamPipeline::stats() const
+{
+    StreamStats s;
+    s.frames_read    = frames_read.load();
+    s.frames_written = frames_written.load();
+    s.pool_dropped   = pool_dropped.load();
+    s.motion_skipped = motion_skipped.load();
+    s.track_skipped  = track_skipped.load();
+    s.read_admission = readAdmission.stats();
+
+    if(write_finish)
+    {
+        s.elapsed_s = last_write_us.load() / 1e6;
+    }
+    else
+    {
+        s.elapsed_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    }
+    if(s.elapsed_s > 0)
+    {
+        s.fps = s.frames_written / s.elapsed_s;
+    }
+    if(s.frames_written > 0)
+    {
+        s.avg_latency_ms = latency_sum_us.load() / 1000.0 / s.frames_written;
+    }
+    s.max_latency_ms = latency_max_us.load() / 1000.0;
+    return s;
+}
+
+void StreamPipeline::print_stats() const
+{
+    StreamStats s = stats();
+    std::cout << "[流" << stream_id << " " << source->name() << "]"
+              << " 读取=" << s.frames_read
+              << " 写出=" << s.frames_written
+              << " 丢弃(读端/线程池)=" << s.read_admission.dropped_total() << "/" << s.pool_dropped
+              << " FPS=" << s.fps;
+    if(motion_gate)
+    {
+        std::cout << " 静止跳过=" << s.motion_skipped
+                  << "(" << (s.frames_read > 0 ? 100.0 * s.motion_skipped / s.frames_read : 0) << "%)";
+    }
+    if(tracker)
+    {
+        std::cout << " 跟踪预测=" << s.track_skipped
+                  << "(" << (s.frames_read > 0 ? 100.0 * s.track_skipped / s.frames_read : 0) << "%)";
+    }
+    std::cout
+              << " 延迟 平均=" << s.avg_latency_ms << " ms"
+              << " 最大=" << s.max_latency_ms << " ms" << std::endl;
+}
+
+void StreamPipeline::print_stage_stats() const
+{
+    stage_hist.print("[流" + std::to_string(stream_id) + " 阶段]");
+}
@@ -0,0 +1,118 @@
+#ifndef STREAM_PIPELINE_H
+#define STREAM_PIPELINE_H
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <opencv2/opencv.hpp>
+
+#include "SafeQueue.h"
+#include "admission.h"
+#include "frame_source.h"
+#include "frame_sink.h"
+#include "pipeline_config.h"
+#include "segment_reader.h"
+#include "detection_store.h"
+#include "motion_gate.h"
+#include "tracker.h"
+#include "cascade.h"
+#include "thread_poll.h"
+
+// 单路流的运行统计快照
+struct StreamStats {
+    uint64_t frames_read = 0;      // 从来源读到的帧数
+    uint64_t frames_written = 0;   // 写出的帧数
+    uint64_t pool_dropped = 0;     // 线程池返回的被丢弃帧数
+    uint64_t motion_skipped = 0;   // 没有运动、沿用上一帧结果而未推理的帧数
+    uint64_t track_skipped = 0;    // 跟踪稳定、由轨迹预测而未推理的帧数
+    AdmissionStats read_admission; // 读端准入统计
+    double elapsed_s = 0;          // 从启动到现在（或结束）的秒数
+    double fps = 0;                // 写出帧率
+    double avg_latency_ms = 0;     // 采集 -> 写出 的平均延迟
+    double max_latency_ms = 0;     // 采集 -> 写出 的最大延迟
+};
+
+//-----------------------------------
+// 一路视频流：读线程 -> 聚合线程(提交共享线程池并按序收集) -> 写线程
+//   每路流有自己的队列、乱序重排窗口和输出，多路流共享同一个 ThreadPoll
+//-----------------------------------
+class StreamPipeline
+{
+public:
+    StreamPipeline(int stream_id, FrameSource *source, FrameSink *sink,
+                   ThreadPoll &npu_pool, const PipelineConfig &cfg, TaskPriority priority);
+
+    // 离线模式：用多线程分段解码代替单个读线程（需在 start 之前设置）
+    void set_segmented_reader(SegmentedReader *reader) { segmented = reader; }
+    // 写线程按帧序把检测结果追加到列式检测结果库（需在 start 之前设置）
+    void set_detection_store(DetectionStoreWriter *store) { det_store = store; }
+    // 检测结果先经过二级分类再按序写出；多路流可共享一个分类器以凑满批次（需在 start 之前设置）
+    void set_cascade(CascadeClassifier *classifier) { cascade = classifier; }
+
+    // 打开来源与输出，成功返回 true
+    bool open();
+    // 启动本路的 读/聚合/写 三个线程
+    void start();
+    // 等待三个线程退出
+    void join();
+    bool finished() const { return process_finish && write_finish; }
+
+    int id() const { return stream_id; }
+    StreamStats stats() const;
+    void print_stats() const;
+    // 各阶段延迟直方图（写线程记录，可在运行中读取）
+    const StageHistograms &stage_histograms() const { return stage_hist; }
+    void print_stage_stats() const;
+
+private:
+    void readThreadFunc();
+    void aggregatorThreadFunc();
+    void writeThreadFunc();
+
+    int stream_id;
+    FrameSource *source;
+    FrameSink *sink;
+    ThreadPoll &npu_pool;
+    const PipelineConfig &config;
+    TaskPriority priority;
+    SegmentedReader *segmented = NULL;  // 非空时帧是乱序到达的
+    DetectionStoreWriter *det_store = NULL;
+    CascadeClassifier *cascade = NULL;
+
+    SafeQueue<FrameData> readQueue;
+    SafeQueue<FrameData> writeQueue;
+    std::atomic<bool> read_finish;
+    std::atomic<bool> process_finish;
+    std::atomic<bool> write_finish;
+
+    AdmissionController readAdmission;
+    bool render;  // 输出视频时画框；只输出检测元数据时跳过画框与整帧拷贝
+    std::unique_ptr<MotionGate> motion_gate;  // 开启运动门控时非空，仅聚合线程使用
+    std::unique_ptr<MultiObjectTracker> tracker;  // 开启跟踪时非空，仅聚合线程使用
+    int frames_since_detect = 0;              // 距上一次送去检测的帧数
+
+    std::thread tRead;
+    std::thread tAggregator;
+    std::thread tWrite;
+
+    // 统计
+    std::chrono::steady_clock::time_point start_time;
+    std::atomic<int64_t> last_write_us;  // 最后一次写出距启动的微秒数
+    std::atomic<uint64_t> frames_read;
+    std::atomic<uint64_t> frames_written;
+    std::atomic<uint64_t> pool_dropped;
+    std::atomic<uint64_t> motion_skipped;
+    std::atomic<uint64_t> track_skipped;
+    std::atomic<int64_t> latency_sum_us;
+    std::atomic<int64_t> latency_max_us;
+    StageHistograms stage_hist;
+
+    // 时间线追踪中计数器的名字，整个运行期有效
+    const std::string trace_read_queue;
+    const std::string trace_write_queue;
+    const std::string trace_inflight;
+};
+
+#endif
@@ -1,11 +1,27 @@
 ﻿#include "thread_poll.h"
+#include "trace.h"
+#include "logger.h"
+#include "debug_dump.h"
+#include "cpu_affinity.h"
+
+#include <algorithm>
+
+// RK3588 的 NPU 核数，worker 按 i % 核数 绑定到各核
+#define THREAD_POLL_NPU_CORES 3
 
 ThreadPoll::ThreadPoll(const char* model_path, int num_threads)
 {
     // 这里可以做一些通用初始化，比如 run_flag=true
     run_flag = true;
     // 初始化：加载模型，启动线程
-    init(model_path, num_threads);
+    std::string path = model_path;
+    init([path](int worker_id) -> InferenceEngine * { return new Yolov5s(path.c_str(), worker_id % THREAD_POLL_NPU_CORES); }, num_threads);
+}
+
+ThreadPoll::ThreadPoll(const EngineFactory &factory, int num_threads)
+{
+    run_flag = true;
+    init(factory, num_threads);
 }
 
 ThreadPoll::~ThreadPoll()
@@ -17,6 +33,7 @@ ThreadPoll::~ThreadPoll()
     run_flag = false;
     // 唤醒所有等待条件，让 worker() 能跳出循环
     condition.notify_all();
+    cond_not_full.notify_all();
 
     // 等待线程结束
     for(auto& t : threads)
@@ -26,20 +43,30 @@ ThreadPoll::~ThreadPoll()
             t.join();
         }
     }
+    // 还没来得及执行的任务按丢弃处理，避免对应的 future 永远拿不到结果
+    PoolTask leftover;
+    while(tasks.pop(leftover))
+    {
+        leftover.job(-1, TASK_DROP);
+    }
     // 这里你也可以释放模型等资源
     std::cout << "ThreadPoll destroyed.\n";
 }
 
-void ThreadPoll::init(const char* model_path, int num_threads)
+void ThreadPoll::init(const EngineFactory &factory, int num_threads)
 {
 
     if(num_threads <= 0) num_threads = 1; // 保底
+
+    // 默认权重：实时流优先，回填任务只分到少量份额但不会被饿死
+    tasks.set_weight(PRIORITY_LIVE, 8);
+    tasks.set_weight(PRIORITY_NORMAL, 4);
+    tasks.set_weight(PRIORITY_BULK, 1);
     // 比如按照 num_threads 个 Yolov5s
     // 也可以根据需求只创建几个再共享
     for(int i = 0; i < num_threads; i++)
     {
-        auto yolo = std::make_shared<Yolov5s>(model_path, i % 3);
-        yolo_group.emplace_back(yolo);
+        yolo_group.emplace_back(std::shared_ptr<InferenceEngine>(factory(i)));
     }
 
     // 启动 num_threads 个工作线程
@@ -52,12 +79,15 @@ void ThreadPoll::init(const char* model_path, int num_threads)
 // worker：只对 tasks 这个队列做等待、取出、执行
 void ThreadPoll::worker(int id)
 {
-    // 取到专属的yolo实例
-    std::shared_ptr<Yolov5s> yolo = yolo_group[id];
     std::cout << "worker线程启动, id=" << id << "\n";
+    // 与 init 中 Yolov5s 的核分配一致：worker i 用 NPU 核 i % 3
+    trace_set_thread_name("npu worker " + std::to_string(id) + " (core " + std::to_string(id % 3) + ")");
+    log_set_thread_name(("worker " + std::to_string(id)).c_str());
+    pin_current_thread(THREAD_ROLE_WORKER);
     while(run_flag)
     {
-        std::packaged_task<ProcessResult()> current_task;
+        PoolTask current_task;
+        TaskVerdict verdict = TASK_RUN;
         {
             // 阻塞等待队列内有任务，或等到退出信号
             std::unique_lock<std::mutex> lock(queue_mutex);
@@ -73,66 +103,501 @@ void ThreadPoll::worker(int id)
                 break;
             }
 
-            // 从 tasks 队列取出一个打包的任务
-            current_task = std::move(tasks.front());
-            tasks.pop();
+            // 从 tasks 队列按加权公平顺序取出一个打包的任务
+            tasks.pop(current_task);
+
+            int lane = current_task.priority;
+            int64_t wait_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - current_task.submit_time).count();
+            lane_executed[lane]++;
+            lane_wait_us[lane] += wait_us;
+            if(wait_us > lane_max_wait_us[lane]) lane_max_wait_us[lane] = wait_us;
+
+            // 帧龄超限或赶不上截止时间的帧不再占用NPU
+            verdict = judge_task(current_task);
         }
+        cond_not_full.notify_one();
 
         // 离开大锁区后执行真正的推理任务
-        if(current_task.valid())
+        if(current_task.job.valid())
         {
-            // 如果任务有效，就调用 operator() 执行
-            current_task();
+            // 使用本 worker 专属的 yolo 实例，避免多个线程共用一个 rknn 上下文
+            TRACE_SCOPE_FRAME(verdict == TASK_RUN ? "infer" : "skip", current_task.index);
+            current_task.job(id, verdict);
         }
     }
     // 在worker线程退出时添加
     std::cout << "Worker " << id << " exited, remaining tasks: " << tasks.size() << std::endl;
 }
 
+void ThreadPoll::set_admission(const AdmissionConfig &cfg)
+{
+    std::unique_lock<std::mutex> lock(queue_mutex);
+    admission.set_config(cfg);
+}
+
+TaskVerdict ThreadPoll::judge_task(const PoolTask &task)
+{
+    // 帧龄从采集时刻算起：在读队列里已经等过的时间也要计入，否则进池时又重新获得一份预算
+    if(admission.is_stale(task.meta.capture_time))
+    {
+        admission.count_dropped_stale();
+        return TASK_DROP;
+    }
+    if(!task.meta.has_deadline())
+    {
+        return TASK_RUN;
+    }
+
+    // 按当前服务时间估计，推理完成时是否还能赶上截止时间
+    auto now = std::chrono::steady_clock::now();
+    auto expected_done = now + std::chrono::microseconds(est_service_us.load());
+    if(expected_done <= task.meta.deadline)
+    {
+        return TASK_RUN;
+    }
+    // 统计在任务执行、交付结果时按最终结局计入
+    if(deadline_action == DEADLINE_DEGRADE)
+    {
+        return TASK_DEGRADE;
+    }
+    return TASK_DROP;
+}
+
+void ThreadPoll::record_service_time(std::chrono::steady_clock::duration d)
+{
+    int64_t sample = std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+    int64_t est = est_service_us.load();
+    // 指数滑动平均，权重 1/8；并发更新时丢失个别样本无碍
+    est_service_us.store(est == 0 ? sample : est + (sample - est) / 8);
+}
+
+void ThreadPoll::record_npu_busy(const FrameTimestamps &ts)
+{
+    // 引擎没有打点（如 mock 引擎）时不计
+    int64_t begin = ts.t[TS_PREPROCESS_END], end = ts.t[TS_NPU_END];
+    if(begin > 0 && end >= begin)
+    {
+        busy_us += end - begin;
+    }
+}
+
+void ThreadPoll::count_deadline(const TaskMeta &meta, std::atomic<uint64_t> &outcome)
+{
+    if(meta.has_deadline())
+    {
+        dl_with_deadline++;
+        outcome++;
+    }
+}
+
+void ThreadPoll::set_deadline_action(DeadlineAction action)
+{
+    std::unique_lock<std::mutex> lock(queue_mutex);
+    deadline_action = action;
+}
+
+DeadlineStats ThreadPoll::deadline_stats() const
+{
+    DeadlineStats s;
+    s.with_deadline = dl_with_deadline.load();
+    s.met      = dl_met.load();
+    s.skipped  = dl_skipped.load();
+    s.degraded = dl_degraded.load();
+    s.late     = dl_late.load();
+    return s;
+}
+
+void ThreadPoll::set_priority_weight(TaskPriority priority, unsigned weight)
+{
+    std::unique_lock<std::mutex> lock(queue_mutex);
+    tasks.set_weight(priority, weight);
+}
+
+LaneStats ThreadPoll::lane_stats(TaskPriority priority) const
+{
+    std::unique_lock<std::mutex> lock(queue_mutex);
+    LaneStats s;
+    s.executed = lane_executed[priority];
+    if(s.executed > 0)
+    {
+        s.avg_wait_ms = lane_wait_us[priority] / 1000.0 / s.executed;
+    }
+    s.max_wait_ms = lane_max_wait_us[priority] / 1000.0;
+    return s;
+}
+
+double ThreadPoll::npu_duty_cycle() const
+{
+    int64_t elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start_time).count();
+    if(elapsed_us <= 0 || threads.empty())
+    {
+        return 0;
+    }
+    // worker 比核多时多个 worker 共用一个核，分母按实际能同时跑的核数算
+    size_t cores = std::min(threads.size(), (size_t)THREAD_POLL_NPU_CORES);
+    return (double)busy_us.load() / elapsed_us / cores;
+}
+
+void ThreadPoll::print_stats() const
+{
+    admission.print_stats("ThreadPoll");
+    static const char *lane_names[PRIORITY_NUM] = {"live", "normal", "bulk"};
+    for(int p = 0; p < PRIORITY_NUM; p++)
+    {
+        LaneStats ls = lane_stats((TaskPriority)p);
+        if(ls.executed == 0) continue;
+        std::cout << "[ThreadPoll] 优先级 " << lane_names[p]
+                  << ": 任务=" << ls.executed
+                  << " 平均排队=" << ls.avg_wait_ms << " ms"
+                  << " 最长排队=" << ls.max_wait_ms << " ms" << std::endl;
+    }
+    std::cout << "[ThreadPoll] NPU 占用率=" << npu_duty_cycle() * 100 << "%" << std::endl;
+    DeadlineStats s = deadline_stats();
+    if(s.with_deadline > 0)
+    {
+        std::cout << "[ThreadPoll] 截止时间: 任务=" << s.with_deadline
+                  << " 按时=" << s.met
+                  << " 错过=" << s.missed()
+                  << " (跳过=" << s.skipped
+                  << ", 降级=" << s.degraded
+                  << ", 超时完成=" << s.late << ")"
+                  << " 单帧耗时估计=" << est_service_us.load() / 1000.0 << " ms" << std::endl;
+    }
+}
+
 // 新的方法：往 tasks 里塞任务，并用 std::future<ProcessResult> 返回结果
-std::future<ProcessResult> ThreadPoll::submit_task_async(int index, cv::Mat img)
+std::future<ProcessResult> ThreadPoll::submit_task_async(int index, cv::Mat img,
+                                                      TaskPriority priority, int stream_id,
+                                                      const TaskMeta &meta)
 {
-    // 1) 打包任务为 std::packaged_task<ProcessResult()>
-    //    其中捕获 [this, index, img] 就可以在lambda里使用
-    std::packaged_task<ProcessResult()> task([this, index, img]()
+    // 只推理感兴趣区域的外接矩形，没有设置时为整帧
+    cv::Rect area(0, 0, img.cols, img.rows);
+    if(meta.roi != NULL && !meta.roi->empty())
+    {
+        area &= meta.roi->bounds;
+    }
+
+    // 大分辨率帧整帧缩到模型尺寸会丢掉小目标：切块推理
+    if(tiling.enabled && std::max(area.width, area.height) > tiling.min_frame_side)
+    {
+        int tile = tiling.tile_size > 0 ? tiling.tile_size : yolo_group[0]->input_width();
+        std::vector<cv::Rect> regions = plan_tiles(area.width, area.height, tile, tiling.overlap);
+        for(size_t t = 0; t < regions.size(); t++)
+        {
+            regions[t].x += area.x;
+            regions[t].y += area.y;
+        }
+        if(tiling.global_view)
+        {
+            regions.push_back(area);
+        }
+        return submit_tiled_async(index, img, regions, priority, stream_id, meta);
+    }
+
+    // 1) 打包任务为 std::packaged_task<ProcessResult(int, TaskVerdict)>
+    //    其中捕获 [this, img, meta] 就可以在lambda里使用
+    PoolTask task;
+    task.index = index;
+    task.priority = (priority >= 0 && priority < PRIORITY_NUM) ? priority : PRIORITY_NORMAL;
+    task.stream_id = stream_id;
+    task.meta = meta;
+    int64_t submit_us = stage_now_us();
+    task.job = std::packaged_task<ProcessResult(int, TaskVerdict)>([this, img, meta, area, submit_us, index, stream_id](int worker_id, TaskVerdict verdict)
     {
         ProcessResult result;
+        if(verdict == TASK_DROP)
+        {
+            // 被准入策略丢弃或赶不上截止时间：不推理，直接返回
+            result.dropped = true;
+            result.deadline_missed = meta.has_deadline() && std::chrono::steady_clock::now() > meta.deadline;
+            count_deadline(meta, dl_skipped);
+            return result;
+        }
+        if(verdict == TASK_DEGRADE)
+        {
+            // 降级：原图直接返回，由调用方沿用上一帧的检测结果
+            if(meta.render)
+            {
+                result.processed_img = img;
+            }
+            result.detection_results.clear();
+            result.degraded = true;
+            result.deadline_missed = true;
+            result.success = true;
+            count_deadline(meta, dl_degraded);
+            return result;
+        }
         try
         {
-            // 从 yolo_group 里选一个做推理，这里简单选 index % yolo_group.size()
-            // 你也可以做负载均衡
-            auto yolo = yolo_group[index % yolo_group.size()];
+            auto yolo = yolo_group[worker_id];
+            auto t0 = std::chrono::steady_clock::now();
+            result.timestamps.t[TS_POOL_SUBMIT] = submit_us;
+            result.timestamps.mark(TS_POOL_DEQUEUE);
 
-            // 推理
+            // 推理（调试转储的采样帧同时保留模型输入）
+            DebugDumper &dumper = DebugDumper::instance();
+            bool sample = dumper.want_sample(index);
+            yolo->set_keep_input(sample);
             detect_result_group_t detections;
-            yolo->inference_image(img, detections);
-            yolo->draw_result(const_cast<cv::Mat&>(img), detections);
+            yolo->inference_region(img, area, detections, meta.roi, &result.timestamps);
+            if(dumper.enabled())
+            {
+                // 在画框之前转储原图；编码与写文件在后台 I/O 线程
+                const char *reason = dumper.anomaly(result.timestamps.t[TS_POSTPROCESS_END] -
+                                                    result.timestamps.t[TS_POOL_DEQUEUE], detections.size());
+                if(sample)
+                {
+                    dumper.submit(stream_id, index, "frame", img);
+                    dumper.submit(stream_id, index, "input", yolo->last_input(), true);
+                }
+                else if(reason != NULL)
+                {
+                    dumper.submit(stream_id, index, reason, img);
+                }
+            }
 
             // 填充结果
-            result.processed_img = img.clone();
-            result.detection_results = detections;
+            if(meta.render)
+            {
+                result.timestamps.mark(TS_RENDER_BEGIN);
+                Yolov5s::draw_result(const_cast<cv::Mat&>(img), detections);
+                result.processed_img = img.clone();
+                result.timestamps.mark(TS_RENDER_END);
+            }
+            result.detection_results = std::move(detections);
             result.success = true;
+
+            auto t1 = std::chrono::steady_clock::now();
+            record_service_time(t1 - t0);
+            record_npu_busy(result.timestamps);
+            result.deadline_missed = meta.has_deadline() && t1 > meta.deadline;
+            count_deadline(meta, result.deadline_missed ? dl_late : dl_met);
         }
         catch(const std::exception& e)
         {
             result.error_msg = e.what();
             result.success = false;
+            count_deadline(meta, dl_skipped);
         }
         return result;
     });
 
-    // 2) 先拿到 future，然后把 task 放进队列
-    std::future<ProcessResult> future = task.get_future();
+    // 2) 先拿到 future，然后按准入策略把 task 放进队列
+    std::future<ProcessResult> future = task.job.get_future();
+    std::vector<PoolTask> group;
+    group.push_back(std::move(task));
+    enqueue_group(group);
+    // 3) 返回 future，后续可以 .get() 拿到结果
+    return future;
+}
+
+void ThreadPoll::enqueue_group(std::vector<PoolTask> &group)
+{
+    std::vector<PoolTask> rejected_oldest; // 过载时被丢弃的最旧任务
+    std::vector<PoolTask> rejected_group;  // 过载时被丢弃的新任务
     {
         // 加锁操作队列
         std::unique_lock<std::mutex> lock(queue_mutex);
+        const AdmissionConfig &cfg = admission.get_config();
 
-        // 把打包好的任务放到队列
-        tasks.emplace(std::move(task));
-        std::cout << "[submit_task_async] 已压入tasks队列, 现在大小=" << tasks.size() << std::endl;
+        if(admission.overloaded(tasks.size(), 0))
+        {
+            if(cfg.policy == ADMIT_BLOCK)
+            {
+                // 阻塞等待 worker 把队列消化到水位以下
+                cond_not_full.wait(lock, [this]
+                {
+                    return !admission.overloaded(tasks.size(), 0) || !run_flag;
+                });
+            }
+            else if(cfg.policy == ADMIT_DROP_OLDEST)
+            {
+                // 从最低优先级中积压最深的提交者处丢弃最旧的任务；
+                // 切块帧一次压入多个任务，丢弃同样多个，队列长度才不会越过水位
+                PoolTask oldest;
+                while(rejected_oldest.size() < group.size() && tasks.pop_oldest(oldest))
+                {
+                    rejected_oldest.push_back(std::move(oldest));
+                    admission.count_dropped_oldest();
+                }
+            }
+            else if(!admission.admit_under_load())
+            {
+                rejected_group.swap(group);
+            }
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        for(size_t i = 0; i < group.size(); i++)
+        {
+            // 把打包好的任务放到队列
+            PoolTask &task = group[i];
+            task.submit_time = now;
+            int lane = task.priority;
+            int sid = task.stream_id;
+            tasks.push(lane, sid, std::move(task));
+        }
+        if(!group.empty())
+        {
+            admission.count_admitted();
+            LOG_DEBUG_EVERY_MS(1000, "[submit_task_async] 已压入tasks队列, 现在大小=%zu", tasks.size());
+        }
     }
-    // 3) 唤醒一个worker线程来执行
-    condition.notify_one();
-    // 4) 返回 future，后续可以 .get() 拿到结果
+    // 被丢弃的任务在锁外以丢弃方式执行，使对应的 future 立即就绪
+    for(size_t i = 0; i < rejected_oldest.size(); i++)
+    {
+        rejected_oldest[i].job(-1, TASK_DROP);
+    }
+    for(size_t i = 0; i < rejected_group.size(); i++)
+    {
+        rejected_group[i].job(-1, TASK_DROP);
+    }
+    // 唤醒worker线程来执行
+    if(group.size() > 1)
+    {
+        condition.notify_all();
+    }
+    else
+    {
+        condition.notify_one();
+    }
+}
+
+// 一帧切块推理的共享状态，由该帧的各个块任务共同持有
+struct TiledFrame {
+    cv::Mat img;
+    TaskMeta meta;
+    std::vector<cv::Rect> regions;
+    std::vector<detect_result_group_t> parts;  // 各块结果（原图坐标），每块只写自己的下标
+    std::atomic<int> remaining;
+    std::atomic<bool> any_dropped;
+    std::atomic<bool> any_degraded;
+    std::promise<ProcessResult> promise;
+    int64_t submit_us;  // 整帧提交时刻
+    int index;          // 帧号与流编号，调试转储命名用
+    int stream_id;
+
+    TiledFrame() : remaining(0), any_dropped(false), any_degraded(false), submit_us(0), index(0), stream_id(0) {}
+};
+
+std::future<ProcessResult> ThreadPoll::submit_tiled_async(int index, cv::Mat img, const std::vector<cv::Rect> &regions,
+                                                          TaskPriority priority, int stream_id, const TaskMeta &meta)
+{
+    std::shared_ptr<TiledFrame> frame = std::make_shared<TiledFrame>();
+    frame->img = img;
+    frame->meta = meta;
+    frame->regions = regions;
+    frame->parts.resize(regions.size());
+    frame->remaining = (int)regions.size();
+    frame->submit_us = stage_now_us();
+    frame->index = index;
+    frame->stream_id = stream_id;
+    std::future<ProcessResult> future = frame->promise.get_future();
+
+    std::vector<PoolTask> group;
+    for(size_t t = 0; t < regions.size(); t++)
+    {
+        PoolTask task;
+        task.index = index;
+        task.priority = (priority >= 0 && priority < PRIORITY_NUM) ? priority : PRIORITY_NORMAL;
+        task.stream_id = stream_id;
+        task.meta = meta;
+        task.job = std::packaged_task<ProcessResult(int, TaskVerdict)>([this, frame, t](int worker_id, TaskVerdict verdict)
+        {
+            // 各块的时间点只保留最后完成的那一块（负责合并的块）的
+            FrameTimestamps tile_ts;
+            tile_ts.t[TS_POOL_SUBMIT] = frame->submit_us;
+            tile_ts.mark(TS_POOL_DEQUEUE);
+            if(verdict == TASK_DROP)
+            {
+                frame->any_dropped = true;
+            }
+            else if(verdict == TASK_DEGRADE)
+            {
+                frame->any_degraded = true;
+            }
+            else
+            {
+                try
+                {
+                    auto t0 = std::chrono::steady_clock::now();
+                    yolo_group[worker_id]->inference_region(frame->img, frame->regions[t], frame->parts[t], frame->meta.roi,
+                                                            &tile_ts);
+                    record_service_time(std::chrono::steady_clock::now() - t0);
+                    record_npu_busy(tile_ts);
+                }
+                catch(const std::exception&)
+                {
+                    frame->any_dropped = true;
+                }
+            }
+            if(--frame->remaining > 0)
+            {
+                return ProcessResult();
+            }
+
+            // 最后完成的块：跨块合并，交付整帧结果
+            ProcessResult result;
+            const TaskMeta &meta = frame->meta;
+            if(frame->any_dropped)
+            {
+                // 缺块的帧结果不完整，按丢弃处理
+                result.dropped = true;
+                result.deadline_missed = meta.has_deadline() && std::chrono::steady_clock::now() > meta.deadline;
+                count_deadline(meta, dl_skipped);
+            }
+            else if(frame->any_degraded)
+            {
+                if(meta.render)
+                {
+                    result.processed_img = frame->img;
+                }
+                result.degraded = true;
+                result.deadline_missed = true;
+                result.success = true;
+                count_deadline(meta, dl_degraded);
+            }
+            else
+            {
+                merge_tile_detections(frame->parts, NMS_THRESHOLD, 0.6f, result.detection_results);
+                result.timestamps = tile_ts;
+                result.timestamps.mark(TS_POSTPROCESS_END);
+                DebugDumper &dumper = DebugDumper::instance();
+                if(dumper.enabled())
+                {
+                    // 切块推理只转储整帧原图（各块的模型输入分散在不同 worker 上）
+                    const char *reason = dumper.want_sample(frame->index) ? "frame" :
+                        dumper.anomaly(result.timestamps.t[TS_POSTPROCESS_END] - frame->submit_us,
+                                       result.detection_results.size());
+                    if(reason != NULL)
+                    {
+                        dumper.submit(frame->stream_id, frame->index, reason, frame->img);
+                    }
+                }
+                if(meta.render)
+                {
+                    result.timestamps.mark(TS_RENDER_BEGIN);
+                    Yolov5s::draw_result(frame->img, result.detection_results);
+                    result.processed_img = frame->img.clone();
+                    result.timestamps.mark(TS_RENDER_END);
+                }
+                result.success = true;
+                result.deadline_missed = meta.has_deadline() && std::chrono::steady_clock::now() > meta.deadline;
+                count_deadline(meta, result.deadline_missed ? dl_late : dl_met);
+            }
+            frame->promise.set_value(result);
+            return ProcessResult();
+        });
+        group.push_back(std::move(task));
+    }
+    enqueue_group(group);
     return future;
 }
+
+void ThreadPoll::set_tiling(const TileConfig &cfg)
+{
+    std::unique_lock<std::mutex> lock(queue_mutex);
+    tiling = cfg;
+}
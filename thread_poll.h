@@ -11,9 +11,14 @@
 #include <map>
 
 #include "yolov5s.h"
+#include "inference_engine.h"
+#include "admission.h"
+#include "fair_queue.h"
+#include "tiling.h"
 #include <utility>
 #include <exception>
 #include <future>
+#include <functional>
 
 using namespace std;
 using namespace cv;
@@ -22,37 +27,163 @@ struct ProcessResult {
     cv::Mat processed_img;
     detect_result_group_t detection_results;
     bool success = false;
+    bool dropped = false;   // 被准入策略丢弃，未做推理
+    bool degraded = false;  // 赶不上截止时间，走了降级路径（未做推理，沿用上一帧检测结果）
+    bool deadline_missed = false;  // 结果产出时已超过截止时间
     std::string error_msg;
+    FrameTimestamps timestamps;    // 线程池内各时间点：提交、取出、预处理、NPU、后处理、画框
 };
+
+// 提交任务时附带的帧信息
+struct TaskMeta {
+    std::chrono::steady_clock::time_point capture_time = std::chrono::steady_clock::now();  // 采集时刻
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max(); // 截止时刻，max 表示不设截止
+    bool render = true;  // 是否在结果图上画框；只输出检测元数据时为 false，省掉画框和整帧拷贝
+    const RoiMask *roi = NULL;  // 本路流的感兴趣区域，为空表示整帧（由提交方持有，生命周期覆盖整个任务）
+
+    bool has_deadline() const { return deadline != std::chrono::steady_clock::time_point::max(); }
+};
+
+// 赶不上截止时间的帧如何处理
+enum DeadlineAction {
+    DEADLINE_SKIP = 0,  // 直接跳过，不写出
+    DEADLINE_DEGRADE    // 不做推理，沿用上一帧的检测结果
+};
+
+// worker 对任务的处理方式
+enum TaskVerdict {
+    TASK_RUN = 0,   // 正常推理
+    TASK_DROP,      // 丢弃
+    TASK_DEGRADE    // 降级：不占用NPU
+};
+
+// 截止时间统计快照
+struct DeadlineStats {
+    uint64_t with_deadline = 0;  // 已出结果的带截止时间的帧数，等于下面四项之和
+    uint64_t met = 0;            // 按时完成
+    uint64_t skipped = 0;        // 没有推理：赶不上、准入丢弃、帧龄超限或推理出错
+    uint64_t degraded = 0;       // 因赶不上而降级
+    uint64_t late = 0;           // 推理了但完成时已超时
+
+    uint64_t missed() const { return skipped + degraded + late; }
+};
+
+// 任务优先级：编号越小越重要，各级之间按权重公平分配 worker
+enum TaskPriority {
+    PRIORITY_LIVE = 0,  // 实时摄像头流，需要保证延迟
+    PRIORITY_NORMAL,    // 普通任务
+    PRIORITY_BULK,      // 离线回填任务，只吃空闲算力
+    PRIORITY_NUM
+};
+
+// 每个优先级的排队统计快照
+struct LaneStats {
+    uint64_t executed = 0;      // 已被 worker 取走的任务数
+    double avg_wait_ms = 0;     // 平均排队时间
+    double max_wait_ms = 0;     // 最长排队时间
+};
+
+// 线程池队列中的任务：记录入队时间用于计算帧龄
+struct PoolTask {
+    int index = 0;
+    TaskPriority priority = PRIORITY_NORMAL;
+    int stream_id = 0;
+    TaskMeta meta;
+    std::chrono::steady_clock::time_point submit_time;
+    // 参数：执行的 worker 编号、处理方式
+    std::packaged_task<ProcessResult(int, TaskVerdict)> job;
+};
+// 按 worker 编号创建该 worker 专属的推理引擎
+typedef std::function<InferenceEngine *(int worker_id)> EngineFactory;
+
 class ThreadPoll
 {
 public:
-    // 构造：加载模型、创建指定数量的线程
+    // 构造：加载模型、创建指定数量的线程（worker i 使用 NPU 核 i % 3 上的 Yolov5s）
     ThreadPoll(const char* model_path, int num_threads);
+    // 构造：由 factory 为每个 worker 创建推理引擎（如压测用的模拟引擎）
+    ThreadPoll(const EngineFactory &factory, int num_threads);
     // 析构：清理模型和工作线程
     ~ThreadPoll();
 
     // 提交异步推理任务（新的正确用法），返回 future 来获取结果
-    std::future<ProcessResult> submit_task_async(int index, cv::Mat img);
+    //   priority：优先级；stream_id：提交者编号，同优先级内按提交者轮转
+    std::future<ProcessResult> submit_task_async(int index, cv::Mat img,
+                                                 TaskPriority priority = PRIORITY_NORMAL, int stream_id = 0,
+                                                 const TaskMeta &meta = TaskMeta());
+
+    // 设置切块推理：开启后大分辨率帧切成重叠的块，各块作为独立任务分散到各个 worker（NPU 核）上
+    void set_tiling(const TileConfig &cfg);
+
+    // 设置任务队列的准入策略（过载时阻塞 / 丢最新 / 丢最旧 / 抽帧）
+    void set_admission(const AdmissionConfig &cfg);
+    // 设置赶不上截止时间时的处理方式
+    void set_deadline_action(DeadlineAction action);
+    DeadlineStats deadline_stats() const;
+    // 设置各优先级的调度权重（默认 live:normal:bulk = 8:4:1）
+    void set_priority_weight(TaskPriority priority, unsigned weight);
+    LaneStats lane_stats(TaskPriority priority) const;
+    // NPU 占用率：各任务 NPU 段（预处理完成到取回输出）耗时之和 / (运行时长 * min(worker 数, NPU 核数))
+    double npu_duty_cycle() const;
+    // 打印丢帧与截止时间统计
+    void print_stats() const;
 
 private:
     // 工作线程函数：不断从 tasks 队列里取 std::packaged_task 并执行
     void worker(int id);
 
-    // 初始化：创建 YOLO 实例 + 启动线程
-    void init(const char* model_path, int num_threads);
+    // 按准入策略把一组任务放进队列：整组一起接纳或一起丢弃（同一帧的各块不会只丢一部分）
+    void enqueue_group(std::vector<PoolTask> &group);
+    // 切块推理：每块一个任务，最后完成的块负责跨块合并并交付整帧结果
+    std::future<ProcessResult> submit_tiled_async(int index, cv::Mat img, const std::vector<cv::Rect> &regions,
+                                                  TaskPriority priority, int stream_id, const TaskMeta &meta);
+
+    // 根据帧龄与截止时间决定任务的处理方式（在 queue_mutex 保护下调用）
+    TaskVerdict judge_task(const PoolTask &task);
+    // 记录一次任务的端到端耗时（含画框、拷贝），更新截止时间判断用的服务时间估计
+    void record_service_time(std::chrono::steady_clock::duration d);
+    // 累计一次任务的 NPU 段耗时，单帧与切块两条路径口径相同
+    void record_npu_busy(const FrameTimestamps &ts);
+    // 一帧出结果时记一次截止时间统计（总数与 outcome 同时累加，各项之和始终等于总数）
+    void count_deadline(const TaskMeta &meta, std::atomic<uint64_t> &outcome);
+
+    // 初始化：创建推理引擎实例 + 启动线程
+    void init(const EngineFactory &factory, int num_threads);
 
 private:
     // 下面这两个是新逻辑用到的核心队列与锁/信号量
-    std::queue<std::packaged_task<ProcessResult()>> tasks;
-    std::mutex queue_mutex;
+    // 按优先级与提交者做加权公平调度的任务队列
+    FairQueue<PoolTask> tasks{PRIORITY_NUM};
+    mutable std::mutex queue_mutex;
     std::condition_variable condition;
+    std::condition_variable cond_not_full;  // ADMIT_BLOCK 策略下等待队列降到水位以下
+
+    TileConfig tiling;
+
+    // 任务队列的准入控制（在 queue_mutex 保护下使用）
+    AdmissionController admission;
+
+    // 截止时间调度
+    DeadlineAction deadline_action = DEADLINE_SKIP;
+    std::atomic<int64_t> est_service_us{0};  // 单帧推理耗时的滑动平均估计（微秒）
+    std::atomic<int64_t> busy_us{0};         // 所有任务累计 NPU 段耗时（微秒），只用于占用率
+    std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+    std::atomic<uint64_t> dl_with_deadline{0};
+    std::atomic<uint64_t> dl_met{0};
+    std::atomic<uint64_t> dl_skipped{0};
+    std::atomic<uint64_t> dl_degraded{0};
+    std::atomic<uint64_t> dl_late{0};
+
+    // 各优先级排队统计（在 queue_mutex 保护下更新）
+    uint64_t lane_executed[PRIORITY_NUM] = {0};
+    int64_t lane_wait_us[PRIORITY_NUM] = {0};
+    int64_t lane_max_wait_us[PRIORITY_NUM] = {0};
 
     // 线程池线程
     std::vector<std::thread> threads;
     std::atomic<bool> run_flag{true};
 
-    // 一个或多个 YOLO 模型实例，例如多线程使用
-    std::vector<std::shared_ptr<Yolov5s>> yolo_group;
+    // 每个 worker 一个推理引擎实例，避免多个线程共用一个 rknn 上下文
+    std::vector<std::shared_ptr<InferenceEngine>> yolo_group;
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,105 @@
+#include "tiling.h"
+
+#include <algorithm>
+
+// 一个方向上的块起点：步长 tile-overlap，最后一块贴齐边缘
+static std::vector<int> tile_starts(int length, int tile, int overlap)
+{
+    std::vector<int> starts;
+    if(length <= tile)
+    {
+        starts.push_back(0);
+        return starts;
+    }
+    int step = tile - overlap;
+    if(step <= 0)
+    {
+        step = tile;
+    }
+    for(int s = 0; ; s += step)
+    {
+        if(s + tile >= length)
+        {
+            starts.push_back(length - tile);
+            break;
+        }
+        starts.push_back(s);
+    }
+    return starts;
+}
+
+std::vector<cv::Rect> plan_tiles(int width, int height, int tile, int overlap)
+{
+    std::vector<cv::Rect> tiles;
+    if(width <= 0 || height <= 0 || tile <= 0)
+    {
+        return tiles;
+    }
+    std::vector<int> xs = tile_starts(width, tile, overlap);
+    std::vector<int> ys = tile_starts(height, tile, overlap);
+    for(size_t j = 0; j < ys.size(); j++)
+    {
+        for(size_t i = 0; i < xs.size(); i++)
+        {
+            tiles.push_back(cv::Rect(xs[i], ys[j], std::min(tile, width), std::min(tile, height)));
+        }
+    }
+    return tiles;
+}
+
+static int box_area(const box_p &b)
+{
+    return std::max(0, b.xmax - b.xmin) * std::max(0, b.ymax - b.ymin);
+}
+
+static int box_intersection(const box_p &a, const box_p &b)
+{
+    int w = std::min(a.xmax, b.xmax) - std::max(a.xmin, b.xmin);
+    int h = std::min(a.ymax, b.ymax) - std::max(a.ymin, b.ymin);
+    return (w > 0 && h > 0) ? w * h : 0;
+}
+
+static bool conf_greater(const detect_result_t &a, const detect_result_t &b)
+{
+    return a.box_conf > b.box_conf;
+}
+
+void merge_tile_detections(const std::vector<detect_result_group_t> &parts, float iou_threshold,
+                           float ios_threshold, detect_result_group_t &merged)
+{
+    std::vector<detect_result_t> all;
+    for(size_t p = 0; p < parts.size(); p++)
+    {
+        all.insert(all.end(), parts[p].begin(), parts[p].end());
+    }
+    std::stable_sort(all.begin(), all.end(), conf_greater);
+
+    merged.clear();
+    for(size_t i = 0; i < all.size() && merged.size() < OBJ_NUM_MAX_SIZE; i++)
+    {
+        const detect_result_t &cand = all[i];
+        int cand_area = box_area(cand.box);
+        bool suppressed = false;
+        for(size_t k = 0; k < merged.size() && !suppressed; k++)
+        {
+            const detect_result_t &kept = merged[k];
+            if(kept.class_id != cand.class_id)
+            {
+                continue;
+            }
+            int inter = box_intersection(kept.box, cand.box);
+            if(inter == 0)
+            {
+                continue;
+            }
+            int kept_area = box_area(kept.box);
+            float iou = (float)inter / (kept_area + cand_area - inter);
+            float ios = (float)inter / std::max(1, std::min(kept_area, cand_area));
+            suppressed = (iou > iou_threshold || ios > ios_threshold);
+        }
+        if(!suppressed)
+        {
+            merged.push_back(cand);
+        }
+    }
+}
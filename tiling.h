@@ -0,0 +1,29 @@
+#ifndef TILING_H
+#define TILING_H
+
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#include "post_process.h"
+
+// 切块推理参数
+struct TileConfig
+{
+    bool enabled;       // 是否切块推理
+    int tile_size;      // 块边长（原图像素），<=0 时取模型输入尺寸，即块内 1:1 不缩放
+    int overlap;        // 相邻块的重叠像素，保证跨块边界的目标至少完整落在一个块内
+    bool global_view;   // 额外对整帧缩放推理一次，兼顾被切开的大目标
+    int min_frame_side; // 帧的长边不超过该值时不切块（<=0 表示总是切）
+
+    TileConfig() : enabled(false), tile_size(0), overlap(64), global_view(true), min_frame_side(1280) {}
+};
+
+// 把 width x height 的帧切成相互重叠的 tile x tile 块，边缘块向内对齐不越界
+std::vector<cv::Rect> plan_tiles(int width, int height, int tile, int overlap);
+
+// 跨块合并：各块结果已映射到原图坐标，按类别做 NMS 去掉重叠区域的重复框。
+// 被切开的目标只剩一部分时与完整框的 IoU 偏小，因此同时用 交集/较小框面积 判断
+void merge_tile_detections(const std::vector<detect_result_group_t> &parts, float iou_threshold,
+                           float ios_threshold, detect_result_group_t &merged);
+
+#endif
@@ -0,0 +1,221 @@
+#include "trace.h"
+
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <signal.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <vector>
+
+// 一个事件：phase 'X' 为区间（带时长），'C' 为计数器
+struct TraceEvent {
+    const char *name;
+    int64_t ts;
+    int64_t dur;
+    int64_t arg;  // 'X' 时为帧号（<0 不输出），'C' 时为计数值
+    char phase;
+};
+
+// 每个线程一块缓冲：只有所属线程写 events[count]，再以 release 发布 count；写文件时读 count 之前的部分
+struct TraceBuffer {
+    int tid;
+    std::string thread_name;           // 在 g_mutex 保护下读写
+    std::vector<TraceEvent> events;
+    std::atomic<size_t> count;
+    std::atomic<uint64_t> dropped;
+
+    TraceBuffer(int tid_in, size_t capacity) : tid(tid_in), events(capacity), count(0), dropped(0) {}
+};
+
+static std::atomic<bool> g_enabled(false);
+static std::mutex g_mutex;
+static std::vector<TraceBuffer *> g_buffers;  // 线程退出后缓冲仍保留到写文件，不释放
+static std::string g_path;
+static size_t g_capacity = 1 << 16;
+static int64_t g_start_us = 0;
+static volatile sig_atomic_t g_signal_pending = 0;
+static thread_local TraceBuffer *t_buffer = NULL;
+
+int64_t trace_now_us()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void trace_enable(const std::string &path, size_t events_per_thread)
+{
+    std::unique_lock<std::mutex> lock(g_mutex);
+    g_path = path;
+    g_capacity = events_per_thread > 0 ? events_per_thread : 1;
+    g_start_us = trace_now_us();
+    g_enabled.store(true, std::memory_order_release);
+}
+
+bool trace_enabled()
+{
+    return g_enabled.load(std::memory_order_relaxed);
+}
+
+static TraceBuffer *local_buffer()
+{
+    if(t_buffer == NULL)
+    {
+        std::unique_lock<std::mutex> lock(g_mutex);
+        t_buffer = new TraceBuffer((int)g_buffers.size() + 1, g_capacity);
+        g_buffers.push_back(t_buffer);
+    }
+    return t_buffer;
+}
+
+static void append_event(const TraceEvent &ev)
+{
+    TraceBuffer *b = local_buffer();
+    size_t n = b->count.load(std::memory_order_relaxed);
+    if(n >= b->events.size())
+    {
+        b->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    b->events[n] = ev;
+    b->count.store(n + 1, std::memory_order_release);
+}
+
+void trace_set_thread_name(const std::string &name)
+{
+    if(!trace_enabled())
+    {
+        return;
+    }
+    TraceBuffer *b = local_buffer();
+    std::unique_lock<std::mutex> lock(g_mutex);
+    b->thread_name = name;
+}
+
+void trace_complete(const char *name, int64_t begin_us, int64_t end_us, int64_t frame)
+{
+    if(!trace_enabled())
+    {
+        return;
+    }
+    TraceEvent ev;
+    ev.name = name;
+    ev.ts = begin_us;
+    ev.dur = end_us - begin_us;
+    ev.arg = frame;
+    ev.phase = 'X';
+    append_event(ev);
+}
+
+void trace_counter(const char *name, int64_t value)
+{
+    if(!trace_enabled())
+    {
+        return;
+    }
+    TraceEvent ev;
+    ev.name = name;
+    ev.ts = trace_now_us();
+    ev.dur = 0;
+    ev.arg = value;
+    ev.phase = 'C';
+    append_event(ev);
+}
+
+static void write_json_string(FILE *fp, const char *s)
+{
+    fputc('"', fp);
+    for(; *s; s++)
+    {
+        if(*s == '"' || *s == '\\')
+        {
+            fputc('\\', fp);
+        }
+        fputc(*s, fp);
+    }
+    fputc('"', fp);
+}
+
+bool trace_flush()
+{
+    if(!trace_enabled())
+    {
+        return false;
+    }
+    std::unique_lock<std::mutex> lock(g_mutex);
+    FILE *fp = fopen(g_path.c_str(), "w");
+    if(fp == NULL)
+    {
+        std::cerr << "Fail to create trace file: " << g_path << "\n";
+        return false;
+    }
+
+    int pid = (int)getpid();
+    uint64_t total = 0, dropped = 0;
+    fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(fp, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":0,\"args\":{\"name\":\"rkproject\"}}", pid);
+    for(size_t i = 0; i < g_buffers.size(); i++)
+    {
+        const TraceBuffer *b = g_buffers[i];
+        if(!b->thread_name.empty())
+        {
+            fprintf(fp, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":", pid, b->tid);
+            write_json_string(fp, b->thread_name.c_str());
+            fputs("}}", fp);
+        }
+        size_t n = b->count.load(std::memory_order_acquire);
+        for(size_t k = 0; k < n; k++)
+        {
+            const TraceEvent &ev = b->events[k];
+            fputs(",\n{\"name\":", fp);
+            write_json_string(fp, ev.name);
+            if(ev.phase == 'X')
+            {
+                fprintf(fp, ",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%lld,\"dur\":%lld", pid, b->tid,
+                        (long long)(ev.ts - g_start_us), (long long)ev.dur);
+                if(ev.arg >= 0)
+                {
+                    fprintf(fp, ",\"args\":{\"frame\":%lld}", (long long)ev.arg);
+                }
+                fputc('}', fp);
+            }
+            else
+            {
+                fprintf(fp, ",\"ph\":\"C\",\"pid\":%d,\"tid\":%d,\"ts\":%lld,\"args\":{\"value\":%lld}}", pid, b->tid,
+                        (long long)(ev.ts - g_start_us), (long long)ev.arg);
+            }
+        }
+        total += n;
+        dropped += b->dropped.load(std::memory_order_relaxed);
+    }
+    fputs("\n]}\n", fp);
+    fclose(fp);
+
+    std::cout << "[Trace] 写出 " << total << " 个事件到 " << g_path;
+    if(dropped > 0)
+    {
+        std::cout << "，缓冲已满丢弃 " << dropped << " 个（可调大 --trace-buffer）";
+    }
+    std::cout << std::endl;
+    return true;
+}
+
+static void on_trace_signal(int)
+{
+    g_signal_pending = 1;
+}
+
+void trace_install_signal_handler()
+{
+    signal(SIGUSR1, on_trace_signal);
+}
+
+bool trace_poll_signal()
+{
+    if(!g_signal_pending)
+    {
+        return false;
+    }
+    g_signal_pending = 0;
+    return trace_flush();
+}
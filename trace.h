@@ -0,0 +1,60 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <stdint.h>
+#include <string>
+
+//-----------------------------------
+// 轻量级时间线追踪，输出 Chrome / Perfetto 可直接打开的 trace-event JSON
+//   每个线程一块定长缓冲，只有本线程写入（无锁），写满后丢弃后续事件并计数
+//   未开启时每个埋点只多一次原子读；开启后每个区间两次取时钟加一次写缓冲
+//   事件名必须是生命周期覆盖整个运行期的字符串（字面量或长期持有的 std::string）
+//-----------------------------------
+
+// 开启追踪：events_per_thread 为每个线程缓冲的事件数
+void trace_enable(const std::string &path, size_t events_per_thread = 1 << 16);
+bool trace_enabled();
+// 给当前线程起名，显示为时间线上的一行
+void trace_set_thread_name(const std::string &name);
+// 记录一个已经结束的区间（微秒，steady_clock）
+void trace_complete(const char *name, int64_t begin_us, int64_t end_us, int64_t frame = -1);
+// 记录一个计数器取值（如队列长度），时间线上显示为折线
+void trace_counter(const char *name, int64_t value);
+// 把目前为止记录的事件写到文件；可以多次调用，每次写出全部事件
+bool trace_flush();
+
+// 安装 SIGUSR1 处理：收到信号时只置标志，由主循环调用 trace_poll_signal 写文件（信号处理函数里不做 I/O）
+void trace_install_signal_handler();
+// 收到过 SIGUSR1 时写出一次，返回是否写了
+bool trace_poll_signal();
+
+int64_t trace_now_us();
+
+// RAII 区间：构造时取开始时间，析构时记录
+class TraceScope
+{
+public:
+    explicit TraceScope(const char *name_in, int64_t frame_in = -1)
+        : name(name_in), frame(frame_in), begin(trace_enabled() ? trace_now_us() : 0) {}
+    ~TraceScope()
+    {
+        if(begin != 0)
+        {
+            trace_complete(name, begin, trace_now_us(), frame);
+        }
+    }
+
+private:
+    const char *name;
+    int64_t frame;
+    int64_t begin;  // 0 表示构造时未开启追踪
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+// 在当前作用域内记录一个区间
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(name)
+#define TRACE_SCOPE_FRAME(name, frame) TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(name, frame)
+
+#endif
@@ -0,0 +1,413 @@
+#include "tracker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <string.h>
+
+float box_iou(const box_p &a, const box_p &b)
+{
+    float w = (float)(std::min(a.xmax, b.xmax) - std::max(a.xmin, b.xmin));
+    float h = (float)(std::min(a.ymax, b.ymax) - std::max(a.ymin, b.ymin));
+    if(w <= 0 || h <= 0)
+    {
+        return 0.0f;
+    }
+    float inter = w * h;
+    float area_a = (float)(a.xmax - a.xmin) * (a.ymax - a.ymin);
+    float area_b = (float)(b.xmax - b.xmin) * (b.ymax - b.ymin);
+    return inter / (area_a + area_b - inter);
+}
+
+//-----------------------------------
+// 匈牙利算法（O(n^2 m)，势能 + 增广路），要求 rows <= cols，否则转置后求解
+//-----------------------------------
+std::vector<int> hungarian_assign(const std::vector<double> &cost, int rows, int cols)
+{
+    std::vector<int> assign(rows, -1);
+    if(rows == 0 || cols == 0)
+    {
+        return assign;
+    }
+    if(rows > cols)
+    {
+        std::vector<double> t(cost.size());
+        for(int i = 0; i < rows; i++)
+            for(int j = 0; j < cols; j++)
+                t[j * rows + i] = cost[i * cols + j];
+        std::vector<int> col_assign = hungarian_assign(t, cols, rows);
+        for(int j = 0; j < cols; j++)
+        {
+            if(col_assign[j] >= 0) assign[col_assign[j]] = j;
+        }
+        return assign;
+    }
+
+    const double INF = std::numeric_limits<double>::max() / 4;
+    int n = rows, m = cols;
+    std::vector<double> u(n + 1, 0), v(m + 1, 0);
+    std::vector<int> p(m + 1, 0), way(m + 1, 0);
+    for(int i = 1; i <= n; i++)
+    {
+        p[0] = i;
+        int j0 = 0;
+        std::vector<double> minv(m + 1, INF);
+        std::vector<char> used(m + 1, 0);
+        do
+        {
+            used[j0] = 1;
+            int i0 = p[j0], j1 = 0;
+            double delta = INF;
+            for(int j = 1; j <= m; j++)
+            {
+                if(used[j]) continue;
+                double cur = cost[(i0 - 1) * m + (j - 1)] - u[i0] - v[j];
+                if(cur < minv[j]) { minv[j] = cur; way[j] = j0; }
+                if(minv[j] < delta) { delta = minv[j]; j1 = j; }
+            }
+            for(int j = 0; j <= m; j++)
+            {
+                if(used[j]) { u[p[j]] += delta; v[j] -= delta; }
+                else        { minv[j] -= delta; }
+            }
+            j0 = j1;
+        } while(p[j0] != 0);
+        do
+        {
+            int j1 = way[j0];
+            p[j0] = p[j1];
+            j0 = j1;
+        } while(j0 != 0);
+    }
+    for(int j = 1; j <= m; j++)
+    {
+        if(p[j] > 0) assign[p[j] - 1] = j - 1;
+    }
+    return assign;
+}
+
+//-----------------------------------
+// KalmanBoxTracker：匀速模型，参数与 SORT 一致
+//-----------------------------------
+static const double kObsNoise[4]  = {1, 1, 10, 10};
+static const double kProcNoise[7] = {1, 1, 1, 1, 0.01, 0.01, 0.0001};
+
+KalmanBoxTracker::KalmanBoxTracker(const box_p &box)
+{
+    memset(x, 0, sizeof(x));
+    memset(P, 0, sizeof(P));
+    double w = box.xmax - box.xmin, h = box.ymax - box.ymin;
+    x[0] = box.xmin + w / 2;
+    x[1] = box.ymin + h / 2;
+    x[2] = w * h;
+    x[3] = h > 0 ? w / h : 1;
+    // 速度未知，初始协方差取大
+    for(int i = 0; i < 4; i++) P[i][i] = 10;
+    for(int i = 4; i < 7; i++) P[i][i] = 10000;
+}
+
+void KalmanBoxTracker::predict()
+{
+    if(x[2] + x[6] <= 0)
+    {
+        x[6] = 0;
+    }
+    // x = F x，F 把速度加到位置/面积上
+    x[0] += x[4];
+    x[1] += x[5];
+    x[2] += x[6];
+
+    // P = F P F^T + Q：先 F P（行 i += 行 i+4），再 (F P) F^T（列 i += 列 i+4）
+    for(int i = 0; i < 3; i++)
+        for(int j = 0; j < 7; j++)
+            P[i][j] += P[i + 4][j];
+    for(int j = 0; j < 3; j++)
+        for(int i = 0; i < 7; i++)
+            P[i][j] += P[i][j + 4];
+    for(int i = 0; i < 7; i++)
+        P[i][i] += kProcNoise[i];
+}
+
+// 4x4 矩阵求逆（高斯-约旦消元），奇异时返回 false
+static bool invert4(const double a_in[4][4], double inv[4][4])
+{
+    double a[4][8];
+    for(int i = 0; i < 4; i++)
+    {
+        for(int j = 0; j < 4; j++)
+        {
+            a[i][j] = a_in[i][j];
+            a[i][j + 4] = (i == j) ? 1 : 0;
+        }
+    }
+    for(int c = 0; c < 4; c++)
+    {
+        int piv = c;
+        for(int r = c + 1; r < 4; r++)
+            if(fabs(a[r][c]) > fabs(a[piv][c])) piv = r;
+        if(fabs(a[piv][c]) < 1e-12)
+        {
+            return false;
+        }
+        if(piv != c)
+            for(int j = 0; j < 8; j++) std::swap(a[c][j], a[piv][j]);
+        double d = a[c][c];
+        for(int j = 0; j < 8; j++) a[c][j] /= d;
+        for(int r = 0; r < 4; r++)
+        {
+            if(r == c) continue;
+            double f = a[r][c];
+            for(int j = 0; j < 8; j++) a[r][j] -= f * a[c][j];
+        }
+    }
+    for(int i = 0; i < 4; i++)
+        for(int j = 0; j < 4; j++)
+            inv[i][j] = a[i][j + 4];
+    return true;
+}
+
+void KalmanBoxTracker::update(const box_p &box)
+{
+    double w = box.xmax - box.xmin, h = box.ymax - box.ymin;
+    double z[4] = {box.xmin + w / 2, box.ymin + h / 2, w * h, h > 0 ? w / h : 1};
+
+    // H 取状态前 4 维：S = P[0:4][0:4] + R，K = P[:, 0:4] S^-1
+    double S[4][4], Sinv[4][4];
+    for(int i = 0; i < 4; i++)
+        for(int j = 0; j < 4; j++)
+            S[i][j] = P[i][j] + (i == j ? kObsNoise[i] : 0);
+    if(!invert4(S, Sinv))
+    {
+        return;
+    }
+    double K[7][4];
+    for(int i = 0; i < 7; i++)
+    {
+        for(int j = 0; j < 4; j++)
+        {
+            double sum = 0;
+            for(int k = 0; k < 4; k++) sum += P[i][k] * Sinv[k][j];
+            K[i][j] = sum;
+        }
+    }
+    double y[4];
+    for(int i = 0; i < 4; i++) y[i] = z[i] - x[i];
+    for(int i = 0; i < 7; i++)
+        for(int j = 0; j < 4; j++)
+            x[i] += K[i][j] * y[j];
+
+    // P = (I - K H) P = P - K P[0:4][:]
+    double KP[7][7];
+    for(int i = 0; i < 7; i++)
+    {
+        for(int j = 0; j < 7; j++)
+        {
+            double sum = 0;
+            for(int k = 0; k < 4; k++) sum += K[i][k] * P[k][j];
+            KP[i][j] = sum;
+        }
+    }
+    for(int i = 0; i < 7; i++)
+        for(int j = 0; j < 7; j++)
+            P[i][j] -= KP[i][j];
+}
+
+box_p KalmanBoxTracker::state_box() const
+{
+    double s = std::max(x[2], 0.0);
+    double r = std::max(x[3], 1e-3);
+    double w = sqrt(s * r);
+    double h = w > 0 ? s / w : 0;
+    box_p b;
+    b.xmin = (int16_t)(x[0] - w / 2);
+    b.ymin = (int16_t)(x[1] - h / 2);
+    b.xmax = (int16_t)(x[0] + w / 2);
+    b.ymax = (int16_t)(x[1] + h / 2);
+    return b;
+}
+
+//-----------------------------------
+// MultiObjectTracker
+//-----------------------------------
+MultiObjectTracker::MultiObjectTracker(const TrackerConfig &cfg) : config(cfg), last_id(0), interval(1)
+{
+}
+
+uint16_t MultiObjectTracker::next_track_id()
+{
+    // 0 表示未跟踪，回绕时跳过
+    if(++last_id == 0)
+    {
+        last_id = 1;
+    }
+    return last_id;
+}
+
+void MultiObjectTracker::associate(const std::vector<int> &track_idx, const std::vector<int> &det_idx,
+                                   const detect_result_group_t &dets, const std::vector<box_p> &predicted,
+                                   std::vector<int> &track_match, std::vector<int> &det_match,
+                                   double &iou_sum, int &matched)
+{
+    int rows = (int)track_idx.size(), cols = (int)det_idx.size();
+    if(rows == 0 || cols == 0)
+    {
+        return;
+    }
+    std::vector<double> cost(rows * cols);
+    std::vector<float> iou(rows * cols);
+    for(int i = 0; i < rows; i++)
+    {
+        const Track &t = tracks[track_idx[i]];
+        for(int j = 0; j < cols; j++)
+        {
+            const detect_result_t &d = dets[det_idx[j]];
+            // 只在同类之间关联
+            float v = (d.class_id == t.class_id) ? box_iou(predicted[track_idx[i]], d.box) : 0.0f;
+            iou[i * cols + j] = v;
+            cost[i * cols + j] = 1.0 - v;
+        }
+    }
+    std::vector<int> assign = hungarian_assign(cost, rows, cols);
+    for(int i = 0; i < rows; i++)
+    {
+        int j = assign[i];
+        if(j < 0 || iou[i * cols + j] < config.iou_threshold)
+        {
+            continue;
+        }
+        track_match[track_idx[i]] = det_idx[j];
+        det_match[det_idx[j]] = track_idx[i];
+        iou_sum += iou[i * cols + j];
+        matched++;
+    }
+}
+
+void MultiObjectTracker::update(detect_result_group_t &dets)
+{
+    std::vector<box_p> predicted(tracks.size());
+    for(size_t i = 0; i < tracks.size(); i++)
+    {
+        tracks[i].kf.predict();
+        predicted[i] = tracks[i].kf.state_box();
+    }
+
+    std::vector<int> track_match(tracks.size(), -1);
+    std::vector<int> det_match(dets.size(), -1);
+    double iou_sum = 0;
+    int matched = 0;
+
+    // 第一阶段：所有轨迹 vs 高分框
+    std::vector<int> all_tracks, high_dets, low_dets;
+    for(size_t i = 0; i < tracks.size(); i++) all_tracks.push_back((int)i);
+    for(size_t j = 0; j < dets.size(); j++)
+    {
+        if(dets[j].box_conf >= config.high_threshold) high_dets.push_back((int)j);
+        else                                          low_dets.push_back((int)j);
+    }
+    associate(all_tracks, high_dets, dets, predicted, track_match, det_match, iou_sum, matched);
+
+    // 第二阶段：剩余轨迹 vs 低分框（被遮挡、模糊的目标分数往往偏低）
+    std::vector<int> rest_tracks;
+    for(size_t i = 0; i < tracks.size(); i++)
+    {
+        if(track_match[i] < 0) rest_tracks.push_back((int)i);
+    }
+    associate(rest_tracks, low_dets, dets, predicted, track_match, det_match, iou_sum, matched);
+
+    // 更新匹配上的轨迹
+    int unmatched_tracks = 0;
+    for(size_t i = 0; i < tracks.size(); i++)
+    {
+        Track &t = tracks[i];
+        if(track_match[i] >= 0)
+        {
+            const detect_result_t &d = dets[track_match[i]];
+            t.kf.update(d.box);
+            t.conf = d.box_conf;
+            t.hits++;
+            t.misses = 0;
+            dets[track_match[i]].track_id = t.id;
+        }
+        else
+        {
+            t.misses++;
+            unmatched_tracks++;
+        }
+    }
+
+    // 未匹配的框新建轨迹
+    int new_tracks = 0;
+    for(size_t j = 0; j < dets.size(); j++)
+    {
+        if(det_match[j] >= 0)
+        {
+            continue;
+        }
+        if(dets[j].box_conf >= config.new_track_threshold)
+        {
+            Track t(next_track_id(), dets[j]);
+            dets[j].track_id = t.id;
+            tracks.push_back(t);
+            new_tracks++;
+        }
+        else
+        {
+            dets[j].track_id = 0;
+        }
+    }
+
+    // 删除长时间未匹配的轨迹
+    size_t keep = 0;
+    for(size_t i = 0; i < tracks.size(); i++)
+    {
+        if(tracks[i].misses <= config.max_age)
+        {
+            tracks[keep++] = tracks[i];
+        }
+    }
+    tracks.erase(tracks.begin() + keep, tracks.end());
+
+    // 自适应检测间隔：所有目标都稳定关联、没有出现/消失时逐步放宽，否则立刻恢复逐帧检测；
+    // 没有轨迹时无从判断稳定与否，保持逐帧检测，新目标一出现就能检到
+    bool stable = (!tracks.empty() && new_tracks == 0 && unmatched_tracks == 0
+                   && (matched == 0 || iou_sum / matched >= config.stable_iou));
+    if(stable)
+    {
+        interval = std::min(interval + 1, std::max(1, config.max_interval));
+    }
+    else
+    {
+        interval = 1;
+    }
+}
+
+void MultiObjectTracker::step()
+{
+    for(size_t i = 0; i < tracks.size(); i++)
+    {
+        tracks[i].kf.predict();
+    }
+}
+
+void MultiObjectTracker::predict(detect_result_group_t &out)
+{
+    out.clear();
+    for(size_t i = 0; i < tracks.size(); i++)
+    {
+        Track &t = tracks[i];
+        t.kf.predict();
+        // 只输出最近一次检测时还匹配着的轨迹
+        if(t.misses > 0)
+        {
+            continue;
+        }
+        detect_result_t det;
+        det.class_id = t.class_id;
+        det.track_id = t.id;
+        det.box_conf = t.conf;
+        det.box = t.kf.state_box();
+        det.attr_id = 0;
+        det.attr_conf = 0;
+        out.push_back(det);
+    }
+}
@@ -0,0 +1,94 @@
+#ifndef TRACKER_H
+#define TRACKER_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "post_process.h"
+
+// 跟踪参数
+struct TrackerConfig
+{
+    bool enabled;
+    int max_interval;        // 自适应检测间隔的上限：最多每 N 帧做一次检测
+    float iou_threshold;     // 关联时 IoU 低于该值不匹配
+    float high_threshold;    // 高分框先与轨迹关联，剩余轨迹再与低分框关联（ByteTrack）
+    float new_track_threshold;  // 未匹配的框置信度达到该值时新建轨迹
+    int max_age;             // 连续多少个检测帧没匹配上就删除轨迹
+    float stable_iou;        // 预测框与检测框的平均 IoU 高于该值时认为跟踪稳定，放宽检测间隔
+
+    TrackerConfig()
+        : enabled(false), max_interval(4), iou_threshold(0.3f), high_threshold(0.6f),
+          new_track_threshold(0.5f), max_age(10), stable_iou(0.7f) {}
+};
+
+// 匈牙利算法：cost 为 rows x cols 的代价矩阵（按行存放），返回每行分到的列，-1 表示未分配
+std::vector<int> hungarian_assign(const std::vector<double> &cost, int rows, int cols);
+
+// 单个目标的卡尔曼滤波（SORT）：状态 [cx, cy, s(面积), r(宽高比), vx, vy, vs]，观测 [cx, cy, s, r]
+class KalmanBoxTracker
+{
+public:
+    KalmanBoxTracker(const box_p &box);
+
+    void predict();
+    void update(const box_p &box);
+    box_p state_box() const;
+
+private:
+    double x[7];
+    double P[7][7];
+};
+
+// 一条轨迹
+struct Track
+{
+    uint16_t id;
+    uint16_t class_id;
+    float conf;
+    KalmanBoxTracker kf;
+    int hits;        // 累计匹配次数
+    int misses;      // 连续未匹配的检测帧数
+
+    Track(uint16_t id_in, const detect_result_t &det)
+        : id(id_in), class_id(det.class_id), conf(det.box_conf), kf(det.box), hits(1), misses(0) {}
+};
+
+//-----------------------------------
+// 多目标跟踪（SORT + ByteTrack 两阶段关联）
+//   检测帧：卡尔曼预测 -> 匈牙利算法按 IoU 关联 -> 更新/新建/删除轨迹，每个框带上轨迹号
+//   跳过检测的帧：只做卡尔曼预测，输出各活跃轨迹的预测框
+//   按帧序调用（非线程安全），每路流一个实例
+//-----------------------------------
+class MultiObjectTracker
+{
+public:
+    explicit MultiObjectTracker(const TrackerConfig &cfg);
+
+    // 检测帧：用检测结果更新轨迹，并把轨迹号写回 dets
+    void update(detect_result_group_t &dets);
+    // 非检测帧：预测各活跃轨迹的位置，输出到 out
+    void predict(detect_result_group_t &out);
+    // 不输出的帧（被丢弃或缺失）：只把各轨迹的卡尔曼状态推进一帧，保证滤波按采集帧计步
+    void step();
+
+    // 当前建议的检测间隔（1 表示每帧检测）
+    int detect_interval() const { return interval; }
+    size_t active_tracks() const { return tracks.size(); }
+
+private:
+    // 在 track_idx 指定的轨迹与 det_idx 指定的框之间做一次匈牙利关联，匹配结果写入 track_match/det_match
+    void associate(const std::vector<int> &track_idx, const std::vector<int> &det_idx,
+                   const detect_result_group_t &dets, const std::vector<box_p> &predicted,
+                   std::vector<int> &track_match, std::vector<int> &det_match, double &iou_sum, int &matched);
+    uint16_t next_track_id();
+
+    TrackerConfig config;
+    std::vector<Track> tracks;
+    uint16_t last_id;
+    int interval;
+};
+
+float box_iou(const box_p &a, const box_p &b);
+
+#endif
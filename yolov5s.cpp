@@ -1,5 +1,10 @@
 ﻿#include "yolov5s.h"
 #include "post_process.h"
+#include "overlay_renderer.h"
+#include "trace.h"
+#include "npu_profiler.h"
+
+#include <atomic>
 
 
 // 静态函数，用于打印 rknn_tensor_attr 结构体的信息
@@ -13,18 +18,28 @@ static void print_tensor_attr(rknn_tensor_attr *attr)
         shape_str += "," + current_str;
     }
 
-    // // 打印张量的索引、名称、维度数、维度、大小和格式
-    // printf("index = %d, name = %s， n_dims = %d, dims = [%s], \nsize = %d, fmt = %s\n", 
-    //         attr->index, attr->name, attr->n_dims, shape_str.c_str(), attr->size, get_format_string(attr->fmt));
-    // printf("\n");
+    // 平时不打印，逐层分析时打印，便于对照报告中各层的输入输出形状
+    if(npu_profile_interval() > 0)
+    {
+        printf("index = %d, name = %s, n_dims = %d, dims = [%s], size = %d, fmt = %s, type = %s, qnt = %s\n",
+               attr->index, attr->name, attr->n_dims, shape_str.c_str(), attr->size, get_format_string(attr->fmt),
+               get_type_string(attr->type), get_qnt_type_string(attr->qnt_type));
+    }
 }
 
 Yolov5s::Yolov5s(const char* model_path, int npu_index)
 {
     int ret; 
+    run_count = 0;
+    keep_input = false;
     model_data = load_model(model_path, this->model_size);
-    /* 模型初始化加载到RKNN中 */
-    ret = rknn_init(&this->context, model_data, this->model_size , RKNN_FLAG_PRIOR_HIGH, NULL);
+    /* 模型初始化加载到RKNN中；逐层分析时要求运行库收集每层耗时（会略微拖慢每次推理） */
+    uint32_t flags = RKNN_FLAG_PRIOR_HIGH;
+    if(npu_profile_interval() > 0)
+    {
+        flags |= RKNN_FLAG_COLLECT_PERF_MASK;
+    }
+    ret = rknn_init(&this->context, model_data, this->model_size , flags, NULL);
     if (ret != 0)
     {  
         printf("rknn init failed! error code: %d\n", ret);
@@ -35,9 +50,9 @@ Yolov5s::Yolov5s(const char* model_path, int npu_index)
     }
 
     /* 对不同线程分配NPU，加速计算 */
-    if(npu_index %4 == 0)     {   ret = rknn_set_core_mask(this->context,RKNN_NPU_CORE_0);}
-    else if(npu_index %4 == 1){   ret = rknn_set_core_mask(this->context,RKNN_NPU_CORE_1);}
-    else                     {   ret = rknn_set_core_mask(this->context,RKNN_NPU_CORE_2);}
+    if(npu_index %4 == 0)     {   ret = rknn_set_core_mask(this->context,RKNN_NPU_CORE_0); npu_core = 0;}
+    else if(npu_index %4 == 1){   ret = rknn_set_core_mask(this->context,RKNN_NPU_CORE_1); npu_core = 1;}
+    else                     {   ret = rknn_set_core_mask(this->context,RKNN_NPU_CORE_2); npu_core = 2;}
     if (ret != 0){      printf("npu set failed! error code: %d\n", ret);} 
 
     /* 够查询获取到模型输入输出信息、逐层运行时间、模型推理的总时间、
@@ -135,155 +150,137 @@ unsigned char * Yolov5s::load_model(const char* model_path, unsigned int &model_
 
 int Yolov5s::inference_image(const Mat& orig_img, detect_result_group_t &result_group)
 {
-     int ret = 0;
+    return inference_region(orig_img, cv::Rect(0, 0, orig_img.cols, orig_img.rows), result_group);
+}
+
+int Yolov5s::inference_region(const Mat& orig_img, const cv::Rect& region_in, detect_result_group_t &result_group,
+                              const RoiMask *roi, FrameTimestamps *timestamps)
+{
+    int ret = 0;
+    result_group.clear();
 
     float nms_threshold       = NMS_THRESHOLD;
     float box_conf_threshold  = BOX_THRESHOLD;
 
+    if(orig_img.empty())
+    {
+        printf("错误：输入图像为空！\n");
+        return -1;
+    }
+    cv::Rect region = region_in & cv::Rect(0, 0, orig_img.cols, orig_img.rows);
+    if(region.width <= 0 || region.height <= 0)
+    {
+        return -1;
+    }
+
+    // 追踪开启时记录 RGA 预处理、NPU、后处理三段
+    int64_t trace_mark = trace_enabled() ? trace_now_us() : 0;
+
     Mat bkg;
     this->img_height = orig_img.rows; // 获取原始图像的高度
     this->img_width = orig_img.cols; // 获取原始图像的宽度
     this->img_channel = orig_img.channels(); // 获取原始图像的通道数
 
     // 检查图像尺寸是否为16的倍数，如果不是则进行填充
-    if(img_width % 16 != 0 || img_height % 16 != 0)
+    if(img_width % 16 != 0 || img_height % 16 != 0 || !orig_img.isContinuous())
     {
         int bkg_width = (img_width + 15) / 16 * 16;
         int bkg_height = (img_height + 15) / 16 * 16;
 
         bkg = Mat(bkg_height, bkg_width, CV_8UC3, cv::Scalar(0, 0, 0)); // 创建背景图像
         orig_img.copyTo(bkg(cv::Rect(0, 0, orig_img.cols, orig_img.rows))); // 将原始图像复制到背景图像中
-        cv::imwrite("img_bkg.jpg", bkg); // 保存背景图像
         this->img_width = bkg_width; // 更新图像宽度
         this->img_height = bkg_height; // 更新图像高度
     }
     else
     {
-        // 尺寸已经是 16 的倍数，不需要 padding
-        bkg = orig_img.clone(); // 创建 bkg，并复制原始图像内容 (深拷贝)
-        // 或者，如果你只是想避免 bkg 为空，也可以使用浅拷贝，但深拷贝更安全
-        // bkg = orig_img; // 浅拷贝，bkg 和 orig_img 共享数据，不推荐，可能引起意外修改
+        // 尺寸已经是 16 的倍数：RGA 只读源图，直接导入原图内存，不做拷贝（导入失败时下面再拷贝）
+        bkg = orig_img;
     }
-    //error
-    // this->img_height    = (orig_img.rows + 15) /16 * 16;
-    // this->img_width     = (orig_img.cols + 15) /16 * 16;
-    // this->img_channel   = orig_img.channels();
 
     int resize_height   = this->model_height;
     int resize_width    = this->model_width;
     int resize_channel  = this->model_channel;
 
-// 打印图像的原始尺寸和调整后的尺寸
-    // printf("Image Height: %d\n", img_height);
-    // printf("Image Width: %d\n", img_width);
-    // printf("Image Channels: %d\n", img_channel);
-
-    // printf("Resize Height: %d\n", resize_height);
-    // printf("Resize Width: %d\n", resize_width);
-    // printf("Resize Channels: %d\n", resize_channel);
-
- // 记录开始时间
-    auto start = std::chrono::high_resolution_clock::now();
-    auto end = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-
-    // //opencv
-    // Mat img_cvt;
-    // Mat img_resize;
-    // start       = std::chrono::high_resolution_clock::now();
-    // cv::cvtColor(orig_img, img_cvt, cv::COLOR_BGR2RGB);
-    // cv::resize(img_cvt, img_resize, Size(resize_height, resize_width), 0, 0, cv::INTER_LINEAR);
-    // end         = std::chrono::high_resolution_clock::now();
-    // duration    =std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-    // printf("opencv process time : %ld ms.\n", duration.count());
-    // cv::imwrite("img_cv_linear.jpg", img_resize);    
-
-    // rga进行图像处理
-    Mat img_rga;
-    Mat img_cvt;
-    start      = std::chrono::high_resolution_clock::now();
-    char *src_buf, *dst_buf, *src_cvt_buf;
-    rga_buffer_handle_t src_handle, dst_handle, src_cvt_handle;
+    // rga进行图像处理：裁剪 region + BGR 转 RGB + 缩放到模型尺寸，一次 RGA 调用完成
+    char *dst_buf;
+    rga_buffer_handle_t src_handle, dst_handle;
 
      // 分配内存
-    src_buf = (char *)malloc(img_height * img_width * img_channel);
-    src_cvt_buf = (char *)malloc(img_height * img_width * img_channel);
     dst_buf = (char *)malloc(resize_height * resize_width * resize_channel);
-
-    if (bkg.empty()) 
-    {
-        printf("错误：bkg Mat 对象为空，可能未正确初始化！\n");
-        // 可以选择直接返回错误，或者采取其他错误处理措施
-        return -1; // 返回错误代码，表示初始化失败
-    }
-    // 复制数据并初始化内存
-    memcpy(src_buf, bkg.data, img_height * img_width * img_channel);
-    memset(src_cvt_buf, 0x00, img_height * img_width * img_channel);
     memset(dst_buf, 0x00, resize_height * resize_width * resize_channel);
 
     // 导入缓冲区
-    src_handle = importbuffer_virtualaddr(src_buf, img_height * img_width * img_channel);
-    src_cvt_handle = importbuffer_virtualaddr(src_cvt_buf, img_height * img_width * img_channel);
+    src_handle = importbuffer_virtualaddr(bkg.data, img_height * img_width * img_channel);
+    if(src_handle == 0 && bkg.data == orig_img.data)
+    {
+        // 零拷贝导入失败（例如帧在只读的缓存文件映射上，驱动锁不住这些页）：拷贝到普通内存再导入
+        static std::atomic<bool> warned(false);
+        if(!warned.exchange(true))
+        {
+            printf("import va of source frame failed, fall back to copying frames.\n");
+        }
+        bkg = orig_img.clone();
+        src_handle = importbuffer_virtualaddr(bkg.data, img_height * img_width * img_channel);
+    }
     dst_handle = importbuffer_virtualaddr(dst_buf, resize_height * resize_width * resize_channel);
 
-    if(src_handle == 0 || src_cvt_handle == 0|| dst_handle == 0)
+    if(src_handle == 0 || dst_handle == 0)
     {
+        // 不能拿全零的输入去跑 NPU，那样这一帧会悄悄变成没有检测框
         printf("import va failed.\n");
+        if(src_handle)
+        {
+            releasebuffer_handle(src_handle);
+        }
+        if(dst_handle)
+        {
+            releasebuffer_handle(dst_handle);
+        }
+        free(dst_buf);
+        return -1;
     }
-    
+
     // 定义rga缓冲区
     rga_buffer_t src = wrapbuffer_handle(src_handle, img_width,img_height, RK_FORMAT_BGR_888);
-    rga_buffer_t src_cvt = wrapbuffer_handle(src_cvt_handle, img_width,img_height, RK_FORMAT_RGB_888);
     rga_buffer_t dst = wrapbuffer_handle(dst_handle, resize_width, resize_height, RK_FORMAT_RGB_888);
+    rga_buffer_t pat;
+    memset(&pat, 0, sizeof(pat));
+    im_rect src_rect = {region.x, region.y, region.width, region.height};
+    im_rect dst_rect = {0, 0, resize_width, resize_height};
+    im_rect pat_rect = {0, 0, 0, 0};
 
     // 检查图像格式
-    ret = imcheck(src, dst, {}, {});
+    ret = imcheck(src, dst, src_rect, dst_rect);
     if(ret != IM_STATUS_NOERROR)
     {
         printf("%d, imcheck error! %s\n", __LINE__,  imStrError((IM_STATUS)ret));
-        ret = -1;
-        // goto release_buffer;
     }
 
-    // 检查图像格式
-    ret = imcvtcolor(src, src_cvt, RK_FORMAT_BGR_888, RK_FORMAT_RGB_888);
-    if(ret == IM_STATUS_SUCCESS)
+    // 源与目标格式不同即做颜色转换，源矩形与目标矩形尺寸不同即做缩放
+    ret = improcess(src, dst, pat, src_rect, dst_rect, pat_rect, -1, NULL, NULL, IM_SYNC);
+    if(ret != IM_STATUS_SUCCESS)
     {
-        // printf("convert color OK!\n");
-    }   
-    else
+        printf("%d, crop/cvtColor/resize error! %s\n", __LINE__,  imStrError((IM_STATUS)ret));
+    }
+    if(timestamps) timestamps->mark(TS_PREPROCESS_END);
+    if(keep_input)
     {
-        printf("%d, cvtColor error! %s\n", __LINE__,  imStrError((IM_STATUS)ret));
-        ret = -1;
-        // goto release_buffer;
+        // dst_buf 推理后释放，这里深拷贝；只有采样帧才会走到
+        kept_input = Mat(resize_height, resize_width, CV_8UC3, dst_buf).clone();
     }
-
-    // 调整图像大小
-    ret = imresize(src_cvt, dst);
-    if(ret == IM_STATUS_SUCCESS)
+    else if(!kept_input.empty())
     {
-        // printf("resize color OK!\n");
+        kept_input.release();
     }
-    else
+    if(trace_mark)
     {
-        printf("%d, resize error! %s\n", __LINE__,  imStrError((IM_STATUS)ret));
-        ret = -1;
-        // goto release_buffer;
+        int64_t now = trace_now_us();
+        trace_complete("rga_preprocess", trace_mark, now);
+        trace_mark = now;
     }
-    
-    // 记录结束时间并计算处理时间
-    end         = std::chrono::high_resolution_clock::now();
-    duration    =std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-    // printf("rga process time : %ld ms.\n", duration.count());
-    // 记录结束时间并计算处理时间
-    img_cvt = Mat(img_height, img_width, CV_8UC3, src_cvt_buf);
-    cv::imwrite("img_rga_cvt.jpg", img_cvt);
-    img_rga = Mat(resize_height, resize_width, CV_8UC3, dst_buf);
-    cv::imwrite("img_rga_rsz.jpg", img_rga);
 
      // 推理
-    start = std::chrono::high_resolution_clock::now();
-    //////printf("set inputs...\n");
     int inputs_num = num_tensors.n_input;
     rknn_input inputs[inputs_num];
     memset(inputs, 0, sizeof(inputs));
@@ -294,10 +291,10 @@ int Yolov5s::inference_image(const Mat& orig_img, detect_result_group_t &result_
     inputs[0].fmt = RKNN_TENSOR_NHWC;
     inputs[0].buf = dst_buf;
 
-    // 设置模型输入
+    // 设置模型输入（逐层分析从这里开始计主机侧时间：输入拷贝 + 运行 + 取输出）
+    int64_t host_begin = stage_now_us();
     rknn_inputs_set(context, inputs_num, inputs);
 
-       ////printf("set outputs");
     int outputs_num = num_tensors.n_output;
     rknn_output outputs[outputs_num];
     memset(outputs, 0, sizeof(outputs));
@@ -305,97 +302,94 @@ int Yolov5s::inference_image(const Mat& orig_img, detect_result_group_t &result_
     {
         outputs[i].want_float = 0;
     }
-    ////printf("model inferencing...\n");
     ret = rknn_run(context, NULL);
-    if (ret == 0)
+    if (ret != 0)
     {
-        //printf("model inferencing OK!\n");
+        printf("rknn_run failed! error code: %d\n", ret);
     }
 
     // 获取模型输出
     rknn_outputs_get(context, outputs_num, outputs, NULL);
-    end = std::chrono::high_resolution_clock::now();
-    duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-    //printf("model inferencing time : %ld ms.\n", duration.count());
+    if(timestamps) timestamps->mark(TS_NPU_END);
+    int profile_every = npu_profile_interval();
+    if(profile_every > 0 && ++run_count % profile_every == 0)
+    {
+        int64_t host_us = stage_now_us() - host_begin;
+        rknn_perf_detail detail;
+        rknn_perf_run run;
+        memset(&detail, 0, sizeof(detail));
+        memset(&run, 0, sizeof(run));
+        if(rknn_query(context, RKNN_QUERY_PERF_DETAIL, &detail, sizeof(detail)) != 0)
+        {
+            detail.perf_data = NULL;
+        }
+        rknn_query(context, RKNN_QUERY_PERF_RUN, &run, sizeof(run));
+        NpuProfiler::instance().record(npu_core, detail.perf_data, detail.data_len, run.run_duration, host_us);
+    }
+    if(trace_mark)
+    {
+        int64_t now = trace_now_us();
+        trace_complete("rknn_run", trace_mark, now);
+        trace_mark = now;
+    }
 
-    // postprocess  640 / 960
-    float scale_w = (float)model_width / img_width;
-    float scale_h = (float)model_height / img_height;
+    // postprocess：模型坐标 / scale 映射回 region 内的坐标
+    float scale_w = (float)model_width / region.width;
+    float scale_h = (float)model_height / region.height;
 
     vector<int32_t> qnt_zps;
     vector<float> qnt_scales;
 
     for (int i = 0; i < outputs_num; i++)
     {
-        //printf("第%d个output的zp和scale分别是：",i);
         qnt_zps.emplace_back(output_attrs[i].zp);
         qnt_scales.emplace_back(output_attrs[i].scale);
-        // printf("%d,%f\n",output_attrs[i].zp,output_attrs[i].scale);
     }
 
     //进行后处理操作
-    int debug = post_process((int8_t *)outputs[0].buf, (int8_t *)outputs[1].buf, (int8_t *)outputs[2].buf, 
-                model_height, model_width, box_conf_threshold, nms_threshold,
-                 scale_w, scale_h, qnt_zps, qnt_scales,result_group);
+    post_process((int8_t *)outputs[0].buf, (int8_t *)outputs[1].buf, (int8_t *)outputs[2].buf,
+                 model_height, model_width, box_conf_threshold, nms_threshold,
+                 scale_w, scale_h, qnt_zps, qnt_scales,result_group, roi, region.x, region.y);
+    rknn_outputs_release(context, outputs_num, outputs);
 
+    // region 内坐标平移回原图坐标
+    if(region.x != 0 || region.y != 0)
+    {
+        for(size_t i = 0; i < result_group.size(); i++)
+        {
+            result_group[i].box.xmin += region.x;
+            result_group[i].box.ymin += region.y;
+            result_group[i].box.xmax += region.x;
+            result_group[i].box.ymax += region.y;
+        }
+    }
+    if(timestamps) timestamps->mark(TS_POSTPROCESS_END);
+    if(trace_mark)
+    {
+        trace_complete("postprocess", trace_mark, trace_now_us());
+    }
 
-    draw_result(orig_img,result_group);
-
+    // 画框交给调用方决定（只输出检测元数据时不需要画）
 
     ret = 0;
-// release_buffer:
-    //free
     // 释放资源
     if(src_handle)
     {
         releasebuffer_handle(src_handle);
     }
-    if(src_cvt_handle)
-    {
-        releasebuffer_handle(src_cvt_handle);
-    }
     if(dst_handle)
-    
     {
         releasebuffer_handle(dst_handle);
     }
-    free(src_buf);
     free(dst_buf);
-    free(src_cvt_buf);
 
     return ret;
 }
  
 int Yolov5s::draw_result(const cv::Mat &orig_img, detect_result_group_t& result_group)
 {
-    for(int i = 0; i < result_group.box_count; i++)
-    {
-        int xmin = result_group.result[i].box.xmin;
-        int ymin = result_group.result[i].box.ymin;
-        int xmax = result_group.result[i].box.xmax;
-        int ymax = result_group.result[i].box.ymax;
-
-        cv::rectangle(orig_img, cv::Point(xmin, ymin), cv::Point(xmax, ymax), cv::Scalar(255, 0, 0, 255), 3);
-
-        std::stringstream ss;
-        ss << std::fixed << std::setprecision(2) // 设置固定小数点表示法，保留两位小数
-            << result_group.result[i].label << ":"
-            << result_group.result[i].box_conf*100 << " %";
-        std::string img_label = ss.str();
-        
-        cv::putText(
-                        orig_img,                    // 要添加文字的图像
-                        img_label,                   // 要添加的文字内容
-                        cv::Point(xmin, ymin-15),       // 文字左下角的坐标 (x, y)
-                        FONT_HERSHEY_SIMPLEX,        // 字体类型 (见下文)
-                        0.8,                           // 字体缩放比例 (相对于原始字体大小)
-                        cv::Scalar(0, 0, 255),            // 文字颜色 (BGR 格式)
-                        1,           // 文字线条粗细
-                        cv::LINE_8,   // 线条类型 (见下文)
-                        false // 如果为 true，则原点在左上角
-                    );
-        
-    }
-    
-    return 0;
+    // 每个线程一个渲染器：框一次 RGA 调用画完，标签从字形图集拼好后整帧混合一次
+    static thread_local OverlayRenderer renderer;
+    TRACE_SCOPE("overlay");
+    return renderer.draw(orig_img, result_group);
 }
@@ -15,6 +15,8 @@
 #include "rga.h"
 
 #include "post_process.h"
+#include "stage_timing.h"
+#include "inference_engine.h"
 
 // #include "3rdparty/rga/RK3588/include/im2d_version.h"
 // #include "3rdparty/rga/RV110X/include/im2d_type.h"
@@ -22,7 +24,7 @@
 
 using namespace std;
 using namespace cv;
-class Yolov5s
+class Yolov5s : public InferenceEngine
 {
 private:
     rknn_context context;  // 关键点：此处必须与 rknn_api.h 中的定义一致
@@ -38,6 +40,12 @@ private:
     unsigned char *model_data;
     unsigned char * load_model(const char* model_path, unsigned int &model_size);
 
+    int npu_core;         // 本实例绑定的 NPU 核
+    uint64_t run_count;   // 推理次数，逐层分析按它每 N 次采样一次
+
+    bool keep_input;      // 为调试转储保留下一次推理的模型输入
+    cv::Mat kept_input;
+
 public:
 
     Yolov5s(const char* model_path, int npu_index);
@@ -56,7 +64,18 @@ public:
 
     //模型推理函数
     int inference_image(const Mat &origin_img, detect_result_group_t &result_group);
-    int draw_result(const cv::Mat &orig_img, detect_result_group_t &group);
+    // 只对原图中 region 区域推理（裁剪后缩放到模型尺寸），结果坐标映射回原图
+    //   roi 非空时只保留中心落在感兴趣区域内的框（在 NMS 之前过滤）
+    //   timestamps 非空时记录预处理、NPU、后处理各自的完成时刻
+    int inference_region(const Mat &origin_img, const cv::Rect &region, detect_result_group_t &result_group,
+                         const RoiMask *roi = NULL, FrameTimestamps *timestamps = NULL) override;
+    int input_width() const override { return model_width; }
+    int input_height() const override { return model_height; }
+    // 调试转储：开启后下一次推理把 RGA 处理后的模型输入（RGB，模型尺寸）拷贝一份保留
+    void set_keep_input(bool keep) override { keep_input = keep; }
+    const cv::Mat &last_input() const override { return kept_input; }
+    // 画框不依赖模型状态，声明为静态以便没有模型实例的线程（如聚合线程）使用
+    static int draw_result(const cv::Mat &orig_img, detect_result_group_t &group);
 
 };
 